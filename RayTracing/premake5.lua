@@ -46,4 +46,7 @@ project "RayTracing"
       defines { "WL_DIST" }
       runtime "Release"
       optimize "On"
-      symbols "Off"
\ No newline at end of file
+      symbols "Off"
+
+   filter "options:profile"
+      defines { "RT_PROFILE=1" }
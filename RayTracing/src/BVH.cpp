@@ -0,0 +1,274 @@
+﻿#include "BVH.h"
+
+#include <chrono>
+#include <algorithm>
+
+namespace {
+
+	constexpr uint32_t BinCount = 16;
+
+	float ElapsedMillis(std::chrono::high_resolution_clock::time_point start)
+	{
+		auto now = std::chrono::high_resolution_clock::now();
+		return std::chrono::duration<float, std::milli>(now - start).count();
+	}
+
+	struct Bin
+	{
+		AABB bounds;
+		uint32_t count = 0;
+	};
+
+}
+
+void BVH::Build(const std::vector<AABB>& primBounds, uint32_t maxLeafSize)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+
+	// 丢弃旧数据 (也可能是外部内存的引用)，不必先复制
+	m_Nodes = Buffer<BVHNode>();
+	m_PrimIndices = Buffer<uint32_t>();
+	m_Parents.clear();
+	std::vector<BVHNode>& nodes = m_Nodes.Edit();
+	std::vector<uint32_t>& primIndices = m_PrimIndices.Edit();
+	primIndices.resize(primBounds.size());
+	if (primBounds.empty())
+	{
+		m_BuildTime = ElapsedMillis(start);
+		return;
+	}
+
+	std::vector<glm::vec3> centroids(primBounds.size());
+	for (uint32_t i = 0; i < primBounds.size(); i++)
+	{
+		primIndices[i] = i;
+		centroids[i] = primBounds[i].Center();
+	}
+
+	// 最多 2N - 1 个节点，左右子节点成对分配
+	nodes.reserve(primBounds.size() * 2);
+	nodes.emplace_back();
+	nodes[0].leftFirst = 0;
+	nodes[0].count = (uint32_t)primBounds.size();
+	UpdateNodeBounds(0, primBounds);
+	Subdivide(0, primBounds, centroids, maxLeafSize);
+	nodes.shrink_to_fit();
+
+	m_BuildTime = ElapsedMillis(start);
+}
+
+void BVH::Refit(const std::vector<AABB>& primBounds)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+
+	// 子节点索引总是大于父节点，倒序即自底向上
+	std::vector<BVHNode>& nodes = m_Nodes.Edit();
+	for (int32_t i = (int32_t)nodes.size() - 1; i >= 0; i--)
+	{
+		BVHNode& node = nodes[i];
+		if (node.IsLeaf())
+		{
+			UpdateNodeBounds(i, primBounds);
+			continue;
+		}
+		const BVHNode& left = nodes[node.leftFirst];
+		const BVHNode& right = nodes[node.leftFirst + 1];
+		node.boundsMin = glm::min(left.boundsMin, right.boundsMin);
+		node.boundsMax = glm::max(left.boundsMax, right.boundsMax);
+	}
+
+	m_RefitTime = ElapsedMillis(start);
+}
+
+void BVH::RefitPrimitives(const std::vector<uint32_t>& dirtyPrims, const std::vector<AABB>& primBounds)
+{
+	if (m_Nodes.empty() || dirtyPrims.empty())
+		return;
+	BuildRefitIndex();
+
+	// 每条路径约 log2(n) 个节点，总量接近节点数时整体 Refit 更快
+	uint32_t pathLength = 1;
+	while ((1u << pathLength) < m_Nodes.size())
+		pathLength++;
+	if (dirtyPrims.size() * pathLength >= m_Nodes.size())
+	{
+		Refit(primBounds);
+		return;
+	}
+
+	auto start = std::chrono::high_resolution_clock::now();
+
+	std::vector<BVHNode>& nodes = m_Nodes.Edit();
+	for (uint32_t prim : dirtyPrims)
+	{
+		uint32_t nodeIndex = m_PrimLeaves[prim];
+		UpdateNodeBounds(nodeIndex, primBounds);
+		while (nodeIndex != 0)
+		{
+			nodeIndex = m_Parents[nodeIndex];
+			BVHNode& node = nodes[nodeIndex];
+			const BVHNode& left = nodes[node.leftFirst];
+			const BVHNode& right = nodes[node.leftFirst + 1];
+			glm::vec3 boundsMin = glm::min(left.boundsMin, right.boundsMin);
+			glm::vec3 boundsMax = glm::max(left.boundsMax, right.boundsMax);
+			// 这一层没变，更上层也不会变
+			if (boundsMin == node.boundsMin && boundsMax == node.boundsMax)
+				break;
+			node.boundsMin = boundsMin;
+			node.boundsMax = boundsMax;
+		}
+	}
+
+	m_RefitTime = ElapsedMillis(start);
+}
+
+void BVH::BuildRefitIndex()
+{
+	if (m_Parents.size() == m_Nodes.size())
+		return;
+
+	const uint32_t* primIndices = m_PrimIndices.data();
+	m_Parents.assign(m_Nodes.size(), 0);
+	m_PrimLeaves.assign(m_PrimIndices.size(), 0);
+	m_PrimSlots.assign(m_PrimIndices.size(), 0);
+	for (uint32_t i = 0; i < (uint32_t)m_Nodes.size(); i++)
+	{
+		const BVHNode& node = m_Nodes[i];
+		if (!node.IsLeaf())
+		{
+			m_Parents[node.leftFirst] = i;
+			m_Parents[node.leftFirst + 1] = i;
+			continue;
+		}
+		for (uint32_t slot = node.leftFirst; slot < node.leftFirst + node.count; slot++)
+		{
+			m_PrimLeaves[primIndices[slot]] = i;
+			m_PrimSlots[primIndices[slot]] = slot;
+		}
+	}
+}
+
+void BVH::UpdateNodeBounds(uint32_t nodeIndex, const std::vector<AABB>& primBounds)
+{
+	BVHNode& node = m_Nodes.Edit()[nodeIndex];
+	const uint32_t* primIndices = m_PrimIndices.data();
+	AABB bounds;
+	for (uint32_t i = 0; i < node.count; i++)
+		bounds.Grow(primBounds[primIndices[node.leftFirst + i]]);
+	node.boundsMin = bounds.min;
+	node.boundsMax = bounds.max;
+}
+
+void BVH::Subdivide(uint32_t rootIndex, const std::vector<AABB>& primBounds, const std::vector<glm::vec3>& centroids, uint32_t maxLeafSize)
+{
+	std::vector<BVHNode>& nodes = m_Nodes.Edit();
+	std::vector<uint32_t>& primIndices = m_PrimIndices.Edit();
+
+	struct Task { uint32_t nodeIndex, depth; };
+	std::vector<Task> tasks;
+	tasks.push_back({ rootIndex, 0 });
+
+	while (!tasks.empty())
+	{
+		Task task = tasks.back();
+		tasks.pop_back();
+
+		uint32_t first = nodes[task.nodeIndex].leftFirst;
+		uint32_t count = nodes[task.nodeIndex].count;
+		if (count <= maxLeafSize || task.depth >= BVH::MaxDepth)
+			continue;
+
+		// 质心包围盒决定分桶范围
+		AABB centroidBounds;
+		for (uint32_t i = 0; i < count; i++)
+			centroidBounds.Grow(centroids[primIndices[first + i]]);
+
+		// 三个轴上分桶求 SAH 最小代价
+		float bestCost = FLT_MAX;
+		int bestAxis = -1;
+		uint32_t bestSplit = 0;
+		for (int axis = 0; axis < 3; axis++)
+		{
+			float extentMin = centroidBounds.min[axis];
+			float extentMax = centroidBounds.max[axis];
+			if (extentMax <= extentMin)
+				continue;
+
+			Bin bins[BinCount];
+			float scale = BinCount / (extentMax - extentMin);
+			for (uint32_t i = 0; i < count; i++)
+			{
+				uint32_t prim = primIndices[first + i];
+				uint32_t b = std::min(BinCount - 1, (uint32_t)((centroids[prim][axis] - extentMin) * scale));
+				bins[b].count++;
+				bins[b].bounds.Grow(primBounds[prim]);
+			}
+
+			float leftArea[BinCount - 1], rightArea[BinCount - 1];
+			uint32_t leftCount[BinCount - 1], rightCount[BinCount - 1];
+			AABB leftBox, rightBox;
+			uint32_t leftSum = 0, rightSum = 0;
+			for (uint32_t i = 0; i < BinCount - 1; i++)
+			{
+				leftSum += bins[i].count;
+				leftCount[i] = leftSum;
+				leftBox.Grow(bins[i].bounds);
+				leftArea[i] = leftBox.Area();
+
+				rightSum += bins[BinCount - 1 - i].count;
+				rightCount[BinCount - 2 - i] = rightSum;
+				rightBox.Grow(bins[BinCount - 1 - i].bounds);
+				rightArea[BinCount - 2 - i] = rightBox.Area();
+			}
+
+			for (uint32_t i = 0; i < BinCount - 1; i++)
+			{
+				if (leftCount[i] == 0 || rightCount[i] == 0)
+					continue;
+				float cost = leftCount[i] * leftArea[i] + rightCount[i] * rightArea[i];
+				if (cost < bestCost)
+				{
+					bestCost = cost;
+					bestAxis = axis;
+					bestSplit = i;
+				}
+			}
+		}
+
+		BVHNode& node = nodes[task.nodeIndex];
+		float nodeArea = AABB{ node.boundsMin, node.boundsMax }.Area();
+		float leafCost = count * nodeArea;
+		if (bestAxis < 0 || bestCost >= leafCost)
+			continue;
+
+		// 按分桶划分图元
+		float extentMin = centroidBounds.min[bestAxis];
+		float scale = BinCount / (centroidBounds.max[bestAxis] - extentMin);
+		uint32_t* begin = primIndices.data() + first;
+		uint32_t* mid = std::partition(begin, begin + count, [&](uint32_t prim)
+			{
+				uint32_t b = std::min(BinCount - 1, (uint32_t)((centroids[prim][bestAxis] - extentMin) * scale));
+				return b <= bestSplit;
+			});
+		uint32_t leftCount = (uint32_t)(mid - begin);
+		if (leftCount == 0 || leftCount == count)
+			continue;
+
+		uint32_t leftIndex = (uint32_t)nodes.size();
+		nodes.emplace_back();
+		nodes.emplace_back();
+
+		nodes[leftIndex].leftFirst = first;
+		nodes[leftIndex].count = leftCount;
+		nodes[leftIndex + 1].leftFirst = first + leftCount;
+		nodes[leftIndex + 1].count = count - leftCount;
+		UpdateNodeBounds(leftIndex, primBounds);
+		UpdateNodeBounds(leftIndex + 1, primBounds);
+
+		nodes[task.nodeIndex].leftFirst = leftIndex;
+		nodes[task.nodeIndex].count = 0;
+
+		tasks.push_back({ leftIndex + 1, task.depth + 1 });
+		tasks.push_back({ leftIndex, task.depth + 1 });
+	}
+}
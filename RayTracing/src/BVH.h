@@ -0,0 +1,195 @@
+﻿#pragma once
+
+#include "Buffer.h"
+#include "Profiler.h"
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <cfloat>
+#include <cstdint>
+
+struct AABB
+{
+	glm::vec3 min{ FLT_MAX };
+	glm::vec3 max{ -FLT_MAX };
+
+	void Grow(const glm::vec3& p) { min = glm::min(min, p); max = glm::max(max, p); }
+	void Grow(const AABB& b) { min = glm::min(min, b.min); max = glm::max(max, b.max); }
+
+	glm::vec3 Center() const { return (min + max) * 0.5f; }
+
+	float Area() const
+	{
+		glm::vec3 e = max - min;
+		if (e.x < 0.0f) return 0.0f;
+		return 2.0f * (e.x * e.y + e.y * e.z + e.z * e.x);
+	}
+};
+
+// 32 字节，两个节点正好一条缓存行
+struct BVHNode
+{
+	glm::vec3 boundsMin;
+	uint32_t leftFirst = 0; // 内部节点: 左子节点 (右子节点 = leftFirst + 1)；叶子: 第一个图元
+	glm::vec3 boundsMax;
+	uint32_t count = 0;     // 0 表示内部节点
+
+	bool IsLeaf() const { return count > 0; }
+};
+
+class BVH
+{
+public:
+	static constexpr uint32_t MaxDepth = 48; // 遍历栈深度 64，留出余量
+
+	// SAH 分桶构建，primBounds 按图元索引排列；图元数不超过 maxLeafSize 的节点直接成为叶子
+	void Build(const std::vector<AABB>& primBounds, uint32_t maxLeafSize = 4);
+	// 拓扑不变，只自底向上更新包围盒
+	void Refit(const std::vector<AABB>& primBounds);
+	// 只更新 dirtyPrims 所在叶子到根的路径，每个图元 O(log n)；脏图元很多时退化为整体 Refit
+	void RefitPrimitives(const std::vector<uint32_t>& dirtyPrims, const std::vector<AABB>& primBounds);
+
+	bool IsEmpty() const { return m_Nodes.empty(); }
+	uint32_t GetNodeCount() const { return (uint32_t)m_Nodes.size(); }
+	float GetBuildTime() const { return m_BuildTime; }
+	float GetRefitTime() const { return m_RefitTime; }
+
+	const Buffer<BVHNode>& GetNodes() const { return m_Nodes; }
+	const Buffer<uint32_t>& GetPrimitiveIndices() const { return m_PrimIndices; }
+	// 建立父节点、图元所在叶子和位置的索引，拓扑不变时只建一次；RefitPrimitives 会自动调用
+	void BuildRefitIndex();
+	// 图元在 GetPrimitiveIndices() 中的位置 (即按 BVH 顺序排列的 SoA 下标)，BuildRefitIndex 之后有效
+	uint32_t GetPrimitiveSlot(uint32_t prim) const { return m_PrimSlots[prim]; }
+
+	// 直接使用外部内存中已经构建好的节点和图元顺序 (例如 mmap 的场景文件)，Refit 前会先复制
+	void SetExternalData(const BVHNode* nodes, uint32_t nodeCount, const uint32_t* primIndices, uint32_t primCount)
+	{
+		m_Nodes.SetView(nodes, nodeCount);
+		m_PrimIndices.SetView(primIndices, primCount);
+		m_Parents.clear();
+	}
+
+	// 叶子回调参数为 (first, count, tMax)，对应 GetPrimitiveIndices() 中的一段
+
+	// 最近交点遍历：leafFn 命中更近的图元时缩小 tMax 并返回 true
+	template<typename LeafFn>
+	bool Traverse(const glm::vec3& origin, const glm::vec3& direction, float& tMax, LeafFn&& leafFn) const;
+
+	// 任意交点遍历 (阴影): leafFn 返回 true 即提前退出
+	template<typename LeafFn>
+	bool TraverseAny(const glm::vec3& origin, const glm::vec3& direction, float tMax, LeafFn&& leafFn) const;
+
+private:
+	static float IntersectAABB(const glm::vec3& origin, const glm::vec3& invDir,
+		const glm::vec3& bmin, const glm::vec3& bmax, float tMax)
+	{
+		glm::vec3 t0 = (bmin - origin) * invDir;
+		glm::vec3 t1 = (bmax - origin) * invDir;
+		glm::vec3 tNear = glm::min(t0, t1);
+		glm::vec3 tFar = glm::max(t0, t1);
+		float tEnter = glm::max(glm::max(tNear.x, tNear.y), glm::max(tNear.z, 0.0f));
+		float tExit = glm::min(glm::min(tFar.x, tFar.y), glm::min(tFar.z, tMax));
+		return tEnter <= tExit ? tEnter : FLT_MAX;
+	}
+
+	void UpdateNodeBounds(uint32_t nodeIndex, const std::vector<AABB>& primBounds);
+	void Subdivide(uint32_t nodeIndex, const std::vector<AABB>& primBounds, const std::vector<glm::vec3>& centroids, uint32_t maxLeafSize);
+
+private:
+	Buffer<BVHNode> m_Nodes;
+	Buffer<uint32_t> m_PrimIndices;
+
+	// 局部 Refit 用，第一次需要时才建立
+	std::vector<uint32_t> m_Parents;    // 按节点
+	std::vector<uint32_t> m_PrimLeaves; // 按图元：所在叶子
+	std::vector<uint32_t> m_PrimSlots;  // 按图元：在 m_PrimIndices 中的位置
+
+	float m_BuildTime = 0.0f;
+	float m_RefitTime = 0.0f;
+};
+
+template<typename LeafFn>
+bool BVH::Traverse(const glm::vec3& origin, const glm::vec3& direction, float& tMax, LeafFn&& leafFn) const
+{
+	if (m_Nodes.empty())
+		return false;
+
+	const BVHNode* nodes = m_Nodes.data();
+	glm::vec3 invDir = 1.0f / direction;
+	if (IntersectAABB(origin, invDir, nodes[0].boundsMin, nodes[0].boundsMax, tMax) == FLT_MAX)
+		return false;
+
+	bool hit = false;
+	uint32_t stack[64];
+	uint32_t stackPtr = 0;
+	uint32_t nodeIndex = 0;
+	while (true)
+	{
+		RT_PROFILE_COUNT(TraversalSteps, 1);
+		const BVHNode& node = nodes[nodeIndex];
+		if (node.IsLeaf())
+		{
+			hit |= leafFn(node.leftFirst, node.count, tMax);
+
+			if (stackPtr == 0)
+				break;
+			nodeIndex = stack[--stackPtr];
+			continue;
+		}
+
+		// 先访问较近的子节点，远的入栈
+		uint32_t nearIndex = node.leftFirst;
+		uint32_t farIndex = node.leftFirst + 1;
+		float nearDist = IntersectAABB(origin, invDir, nodes[nearIndex].boundsMin, nodes[nearIndex].boundsMax, tMax);
+		float farDist = IntersectAABB(origin, invDir, nodes[farIndex].boundsMin, nodes[farIndex].boundsMax, tMax);
+		if (nearDist > farDist)
+		{
+			std::swap(nearDist, farDist);
+			std::swap(nearIndex, farIndex);
+		}
+
+		if (nearDist == FLT_MAX)
+		{
+			if (stackPtr == 0)
+				break;
+			nodeIndex = stack[--stackPtr];
+		}
+		else
+		{
+			nodeIndex = nearIndex;
+			if (farDist != FLT_MAX)
+				stack[stackPtr++] = farIndex;
+		}
+	}
+	return hit;
+}
+
+template<typename LeafFn>
+bool BVH::TraverseAny(const glm::vec3& origin, const glm::vec3& direction, float tMax, LeafFn&& leafFn) const
+{
+	if (m_Nodes.empty())
+		return false;
+
+	const BVHNode* nodes = m_Nodes.data();
+	glm::vec3 invDir = 1.0f / direction;
+	uint32_t stack[64];
+	uint32_t stackPtr = 0;
+	stack[stackPtr++] = 0;
+	while (stackPtr > 0)
+	{
+		RT_PROFILE_COUNT(TraversalSteps, 1);
+		const BVHNode& node = nodes[stack[--stackPtr]];
+		if (IntersectAABB(origin, invDir, node.boundsMin, node.boundsMax, tMax) == FLT_MAX)
+			continue;
+
+		if (node.IsLeaf())
+		{
+			if (leafFn(node.leftFirst, node.count, tMax))
+				return true;
+			continue;
+		}
+		stack[stackPtr++] = node.leftFirst + 1;
+		stack[stackPtr++] = node.leftFirst;
+	}
+	return false;
+}
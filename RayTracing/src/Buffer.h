@@ -0,0 +1,48 @@
+﻿#pragma once
+
+#include <vector>
+#include <cstddef>
+
+// 只读访问的连续数组：自己持有数据 (std::vector)，或者直接引用外部内存 (例如 mmap 的场景文件)
+// 引用外部内存时不复制，第一次 Edit() 时才复制成自己持有的数据
+template<typename T>
+class Buffer
+{
+public:
+	Buffer() = default;
+	Buffer(std::vector<T> values) : m_Storage(std::move(values)) {}
+
+	size_t size() const { return m_View ? m_ViewSize : m_Storage.size(); }
+	bool empty() const { return size() == 0; }
+	const T* data() const { return m_View ? m_View : m_Storage.data(); }
+	const T* begin() const { return data(); }
+	const T* end() const { return data() + size(); }
+	const T& operator[](size_t index) const { return data()[index]; }
+
+	// 修改前调用；外部内存先复制一份
+	std::vector<T>& Edit()
+	{
+		if (m_View)
+		{
+			m_Storage.assign(m_View, m_View + m_ViewSize);
+			m_View = nullptr;
+			m_ViewSize = 0;
+		}
+		return m_Storage;
+	}
+
+	// data 的生命周期由调用方保证
+	void SetView(const T* data, size_t size)
+	{
+		m_Storage = std::vector<T>();
+		m_View = data;
+		m_ViewSize = size;
+	}
+
+	bool IsView() const { return m_View != nullptr; }
+
+private:
+	std::vector<T> m_Storage;
+	const T* m_View = nullptr;
+	size_t m_ViewSize = 0;
+};
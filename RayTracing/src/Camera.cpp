@@ -1,34 +1,53 @@
-#include "Camera.h"
+﻿#include "Camera.h"
 
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/quaternion.hpp>
 #include <glm/gtx/quaternion.hpp>
 
-#include "Walnut/Input/Input.h"
-
-using namespace Walnut;
-
 Camera::Camera(float verticalFOV, float near, float far)
 	: m_VertialFOV(verticalFOV), m_Near(near), m_Far(far)
 {
 	m_ForwardDirection = glm::vec3(0, 0, -1);
 	m_Position = glm::vec3(0, 0, 5);
-	m_LastMousePosition = Input::GetMousePosition();
+	RecalculateView();
+}
+
+void Camera::SetInputSource(InputSource* input)
+{
+	m_Input = input;
+	if (m_Input)
+		m_LastMousePosition = m_Input->GetMousePosition();
+}
+
+void Camera::SetPosition(const glm::vec3& position)
+{
+	m_Position = position;
+	RecalculateView();
+}
+
+void Camera::SetDirection(const glm::vec3& direction)
+{
+	m_ForwardDirection = glm::normalize(direction);
+	RecalculateView();
+	RecalculateRayBasis();
 }
 
-void Camera::OnUpdate(float ts)
+bool Camera::OnUpdate(float ts)
 {
-	glm::vec2 mousePos = Input::GetMousePosition();
+	if (!m_Input)
+		return false;
+
+	glm::vec2 mousePos = m_Input->GetMousePosition();
 	glm::vec2 delta = (mousePos - m_LastMousePosition) * 0.002f;
 	m_LastMousePosition = mousePos;
 
-	if (!Input::IsMouseButtonDown(MouseButton::Right))
+	if (!m_Input->IsLookActive())
 	{
-		Input::SetCursorMode(CursorMode::Normal);
-		return;
+		m_Input->SetCursorLocked(false);
+		return false;
 	}
 
-	Input::SetCursorMode(CursorMode::Locked);
+	m_Input->SetCursorLocked(true);
 
 	bool moved = false;
 	
@@ -37,32 +56,32 @@ void Camera::OnUpdate(float ts)
 
 	float speed = 2.0f;
 
-	if (Input::IsKeyDown(KeyCode::W))
+	if (m_Input->IsKeyDown(CameraKey::Forward))
 	{
 		m_Position += ts * speed * m_ForwardDirection;
 		moved = true;
 	}
-	if (Input::IsKeyDown(KeyCode::S))
+	if (m_Input->IsKeyDown(CameraKey::Backward))
 	{
 		m_Position -= ts * speed * m_ForwardDirection;
 		moved = true;
 	}
-	if (Input::IsKeyDown(KeyCode::A))
+	if (m_Input->IsKeyDown(CameraKey::Left))
 	{
 		m_Position -= ts * speed * rightDircetion;
 		moved = true;
 	}
-	if (Input::IsKeyDown(KeyCode::D))
+	if (m_Input->IsKeyDown(CameraKey::Right))
 	{
 		m_Position += ts * speed * rightDircetion;
 		moved = true;
 	}
-	if (Input::IsKeyDown(KeyCode::Q))
+	if (m_Input->IsKeyDown(CameraKey::Down))
 	{
 		m_Position -= ts * speed * upDirection;
 		moved = true;
 	}
-	if (Input::IsKeyDown(KeyCode::E))
+	if (m_Input->IsKeyDown(CameraKey::Up))
 	{
 		m_Position += ts * speed * upDirection;
 		moved = true;
@@ -82,8 +101,19 @@ void Camera::OnUpdate(float ts)
 	if (moved)
 	{
 		RecalculateView();
-		RecalculateRayDirections();
+		RecalculateRayBasis();
 	}
+
+	return moved;
+}
+
+void Camera::SetVerticalFOV(float verticalFOV)
+{
+	m_VertialFOV = verticalFOV;
+	if (m_ViewportWidth == 0 || m_ViewportHeight == 0)
+		return;
+	RecalculateProjection();
+	RecalculateRayBasis();
 }
 
 void Camera::OnResize(uint32_t width, uint32_t height)
@@ -94,7 +124,7 @@ void Camera::OnResize(uint32_t width, uint32_t height)
 	m_ViewportHeight = height;
 
 	RecalculateProjection();
-	RecalculateRayDirections();
+	RecalculateRayBasis();
 }
 
 void Camera::RecalculateProjection()
@@ -113,19 +143,17 @@ void Camera::RecalculateView()
 	m_InverseView = glm::inverse(m_View);
 }
 
-void Camera::RecalculateRayDirections()
+void Camera::RecalculateRayBasis()
 {
-	m_RayDirections.resize(m_ViewportWidth * m_ViewportHeight);
+	if (m_ViewportWidth == 0 || m_ViewportHeight == 0)
+		return;
 
-	for (uint32_t y = 0; y < m_ViewportHeight; y++)
-	{
-		for (uint32_t x = 0; x < m_ViewportWidth; x++)
-		{
-			glm::vec2 coord = { (float)x / (float)m_ViewportWidth, (float)y / (float)m_ViewportHeight };
-			coord = coord * 2.0f - 1.0f;
-			glm::vec4 target = m_InverseProjection * glm::vec4(coord.x, coord.y, 1, 1);
-			glm::vec3 rayDirection = glm::vec3(m_InverseView * glm::vec4(glm::normalize(glm::vec3(target) / target.w), 0));
-			m_RayDirections[x + y * m_ViewportWidth] = rayDirection;
-		}
-	}
+	// 与 lookAt 相同的基向量，按视场角和宽高比缩放
+	float tanHalfFOV = glm::tan(glm::radians(m_VertialFOV) * 0.5f);
+	float aspect = (float)m_ViewportWidth / (float)m_ViewportHeight;
+	glm::vec3 right = glm::normalize(glm::cross(m_ForwardDirection, glm::vec3(0, 1, 0)));
+	glm::vec3 up = glm::cross(right, m_ForwardDirection);
+	m_RayRight = right * (tanHalfFOV * aspect);
+	m_RayUp = up * tanHalfFOV;
+	m_InvViewportSize = glm::vec2(1.0f / (float)m_ViewportWidth, 1.0f / (float)m_ViewportHeight);
 }
@@ -1,16 +1,22 @@
-#pragma once
+﻿#pragma once
+
+#include "InputSource.h"
 
 #include <glm/glm.hpp>
-#include <vector>
 
 class Camera
 {
 public:
 	Camera(float verticalFOV, float near, float far);
 	
-	void OnUpdate(float ts);
+	bool OnUpdate(float ts);
 	void OnResize(uint32_t width, uint32_t height);
 
+	void SetInputSource(InputSource* input);
+	void SetPosition(const glm::vec3& position);
+	void SetDirection(const glm::vec3& direction);
+	void SetVerticalFOV(float verticalFOV);
+
 	const glm::mat4& GetProjection() const { return m_Projection; }
 	const glm::mat4& GetView() const { return m_View; }
 	const glm::mat4& GetInverseProjection() const { return m_InverseProjection; }
@@ -18,13 +24,20 @@ public:
 
 	const glm::vec3& GetPosition() const { return m_Position; }
 	const glm::vec3& GetDirection() const { return m_ForwardDirection; }
+	float GetVerticalFOV() const { return m_VertialFOV; }
 
-	const std::vector<glm::vec3>& GetRayDirections() const { return m_RayDirections; }
+	// 像素坐标 (x, y) 处的主光线方向，小数部分是像素内的偏移；每次由相机基向量算出，不缓存逐像素方向
+	glm::vec3 GetRayDirection(float x, float y) const
+	{
+		float u = x * m_InvViewportSize.x * 2.0f - 1.0f;
+		float v = y * m_InvViewportSize.y * 2.0f - 1.0f;
+		return glm::normalize(m_ForwardDirection + u * m_RayRight + v * m_RayUp);
+	}
 
 private:
 	void RecalculateProjection();
 	void RecalculateView();
-	void RecalculateRayDirections();
+	void RecalculateRayBasis();
 
 private:
 	glm::mat4 m_Projection{ 1.0f };
@@ -38,8 +51,12 @@ private:
 
 	glm::vec3 m_Position{ 0.0f,0.0f,0.0f };
 	glm::vec3 m_ForwardDirection{ 0.0f,0.0f,0.0f };
-	std::vector<glm::vec3> m_RayDirections;
+	// 近平面 (距离 1) 上半宽、半高对应的右、上向量
+	glm::vec3 m_RayRight{ 0.0f,0.0f,0.0f };
+	glm::vec3 m_RayUp{ 0.0f,0.0f,0.0f };
+	glm::vec2 m_InvViewportSize{ 0.0f,0.0f };
 
+	InputSource* m_Input = nullptr;
 	glm::vec2 m_LastMousePosition{ 0.0f,0.0f };
 	uint32_t m_ViewportWidth = 0, m_ViewportHeight = 0;
 };
\ No newline at end of file
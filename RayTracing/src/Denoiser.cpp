@@ -0,0 +1,502 @@
+﻿#include "Denoiser.h"
+#include "SphereSoA.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64)
+	#define RT_X64 1
+	#include <immintrin.h>
+	#if defined(_MSC_VER)
+		#define RT_TARGET(x)
+	#else
+		#define RT_TARGET(x) __attribute__((target(x)))
+	#endif
+#else
+	#define RT_X64 0
+#endif
+
+namespace {
+
+	// 最大采样间隔 2^(MaxIterations - 1) 的两倍，按 AVX2 宽度对齐
+	constexpr uint32_t Pad = 2u << (Denoiser::MaxIterations - 1);
+	constexpr float Epsilon = 1e-4f;
+	constexpr float LuminanceR = 0.2126f, LuminanceG = 0.7152f, LuminanceB = 0.0722f;
+	// B3 样条核，下标为 |偏移|
+	constexpr float Kernel[3] = { 3.0f / 8.0f, 1.0f / 4.0f, 1.0f / 16.0f };
+	// 2^f, f ∈ [0, 1) 的多项式系数
+	constexpr float Exp2C1 = 0.693147182f, Exp2C2 = 0.240226507f, Exp2C3 = 0.0555041087f;
+	constexpr float Exp2C4 = 0.00961812911f, Exp2C5 = 0.00133335581f, Exp2C6 = 0.000154035304f;
+
+	struct Tap
+	{
+		int dx, dy;     // 已乘以采样间隔
+		float weight;   // 核权重
+		float distance; // 到中心的像素距离
+	};
+
+	// 一次迭代，指针都指向第 0 行第 0 个像素 (跳过左侧 Pad)
+	struct FilterContext
+	{
+		uint32_t width, height, stride;
+		const float* normalX;
+		const float* normalY;
+		const float* normalZ;
+		const float* depth;
+		const float* depthGradient;
+		const float* albedoR;
+		const float* albedoG;
+		const float* albedoB;
+		const float* r;
+		const float* g;
+		const float* b;
+		const float* variance;
+		float* outR;
+		float* outG;
+		float* outB;
+		float* outVariance;
+		glm::vec4* output; // 最后一次迭代直接写结果
+		float colorSigma, depthSigma, invAlbedoSigma;
+		Tap taps[24];
+	};
+
+	float Luminance(float r, float g, float b)
+	{
+		return r * LuminanceR + g * LuminanceG + b * LuminanceB;
+	}
+
+	// exp(-x)，x >= 0；用 2^t = 2^floor(t) * 2^frac(t) 近似，相对误差约 1e-5
+	float ExpNegScalar(float x)
+	{
+		float t = x * -1.44269504f;
+		t = t > -126.0f ? t : -126.0f; // NaN 也取 -126，和 _mm256_max_ps 一致
+		float i = std::floor(t);
+		float f = t - i;
+		float p = 1.0f + f * (Exp2C1 + f * (Exp2C2 + f * (Exp2C3 + f * (Exp2C4 + f * (Exp2C5 + f * Exp2C6)))));
+		int32_t bits = ((int32_t)i + 127) << 23;
+		float scale;
+		memcpy(&scale, &bits, sizeof(scale));
+		return p * scale;
+	}
+
+	// 法线夹角权重 max(0, n·n')^128
+	float NormalWeightScalar(float d)
+	{
+		d = std::max(d, 0.0f);
+		for (int i = 0; i < 7; i++)
+			d *= d;
+		return d;
+	}
+
+	void FilterPixelScalar(const FilterContext& c, uint32_t y, uint32_t x)
+	{
+		ptrdiff_t i = (ptrdiff_t)y * c.stride + x;
+
+		// 中心像素的方差先做 3x3 高斯模糊，降低估计噪声
+		float varianceSum = 0.0f, rowWeightSum = 0.0f;
+		for (int dy = -1; dy <= 1; dy++)
+		{
+			int yq = (int)y + dy;
+			if (yq < 0 || yq >= (int)c.height)
+				continue;
+			float rowWeight = dy == 0 ? 0.5f : 0.25f;
+			const float* row = c.variance + (ptrdiff_t)yq * c.stride + x;
+			varianceSum += rowWeight * (0.25f * row[-1] + 0.5f * row[0] + 0.25f * row[1]);
+			rowWeightSum += rowWeight;
+		}
+		float variance = std::max(varianceSum / rowWeightSum, 0.0f);
+
+		float r = c.r[i], g = c.g[i], b = c.b[i];
+		float luminance = Luminance(r, g, b);
+		float invColor = 1.0f / (c.colorSigma * std::sqrt(variance) + Epsilon);
+		float depthScale = c.depthSigma * c.depthGradient[i];
+		float nx = c.normalX[i], ny = c.normalY[i], nz = c.normalZ[i];
+		float z = c.depth[i];
+		float ar = c.albedoR[i], ag = c.albedoG[i], ab = c.albedoB[i];
+
+		float centerWeight = Kernel[0] * Kernel[0];
+		float weightSum = centerWeight;
+		float sumR = r * centerWeight, sumG = g * centerWeight, sumB = b * centerWeight;
+		float sumVariance = c.variance[i] * centerWeight * centerWeight;
+		for (const Tap& tap : c.taps)
+		{
+			int yq = (int)y + tap.dy;
+			if (yq < 0 || yq >= (int)c.height)
+				continue;
+			ptrdiff_t q = (ptrdiff_t)yq * c.stride + (ptrdiff_t)x + tap.dx;
+
+			float normalWeight = NormalWeightScalar(nx * c.normalX[q] + ny * c.normalY[q] + nz * c.normalZ[q]);
+			float qr = c.r[q], qg = c.g[q], qb = c.b[q];
+			float exponent = std::abs(z - c.depth[q]) / (depthScale * tap.distance + Epsilon)
+				+ std::abs(luminance - Luminance(qr, qg, qb)) * invColor
+				+ (std::abs(ar - c.albedoR[q]) + std::abs(ag - c.albedoG[q]) + std::abs(ab - c.albedoB[q])) * c.invAlbedoSigma;
+			float weight = tap.weight * normalWeight * ExpNegScalar(exponent);
+
+			weightSum += weight;
+			sumR += weight * qr;
+			sumG += weight * qg;
+			sumB += weight * qb;
+			sumVariance += weight * weight * c.variance[q];
+		}
+
+		float invWeightSum = 1.0f / weightSum;
+		c.outR[i] = sumR * invWeightSum;
+		c.outG[i] = sumG * invWeightSum;
+		c.outB[i] = sumB * invWeightSum;
+		c.outVariance[i] = sumVariance * invWeightSum * invWeightSum;
+		if (c.output)
+			c.output[(size_t)y * c.width + x] = glm::vec4(c.outR[i], c.outG[i], c.outB[i], 1.0f);
+	}
+
+	void FilterTileScalar(const FilterContext& c, const Tile& tile)
+	{
+		for (uint32_t y = tile.y0; y < tile.y1; y++)
+			for (uint32_t x = tile.x0; x < tile.x1; x++)
+				FilterPixelScalar(c, y, x);
+	}
+
+#if RT_X64
+
+	RT_TARGET("avx2,fma")
+	__m256 AbsAVX2(__m256 v)
+	{
+		return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), v);
+	}
+
+	RT_TARGET("avx2,fma")
+	__m256 LuminanceAVX2(__m256 r, __m256 g, __m256 b)
+	{
+		return _mm256_fmadd_ps(b, _mm256_set1_ps(LuminanceB),
+			_mm256_fmadd_ps(g, _mm256_set1_ps(LuminanceG), _mm256_mul_ps(r, _mm256_set1_ps(LuminanceR))));
+	}
+
+	RT_TARGET("avx2,fma")
+	__m256 ExpNegAVX2(__m256 x)
+	{
+		__m256 t = _mm256_max_ps(_mm256_mul_ps(x, _mm256_set1_ps(-1.44269504f)), _mm256_set1_ps(-126.0f));
+		__m256 i = _mm256_floor_ps(t);
+		__m256 f = _mm256_sub_ps(t, i);
+		__m256 p = _mm256_fmadd_ps(f, _mm256_set1_ps(Exp2C6), _mm256_set1_ps(Exp2C5));
+		p = _mm256_fmadd_ps(f, p, _mm256_set1_ps(Exp2C4));
+		p = _mm256_fmadd_ps(f, p, _mm256_set1_ps(Exp2C3));
+		p = _mm256_fmadd_ps(f, p, _mm256_set1_ps(Exp2C2));
+		p = _mm256_fmadd_ps(f, p, _mm256_set1_ps(Exp2C1));
+		p = _mm256_fmadd_ps(f, p, _mm256_set1_ps(1.0f));
+		__m256i bits = _mm256_slli_epi32(_mm256_add_epi32(_mm256_cvtps_epi32(i), _mm256_set1_epi32(127)), 23);
+		return _mm256_mul_ps(p, _mm256_castsi256_ps(bits));
+	}
+
+	// 与 FilterPixelScalar 相同，一次 8 个相邻像素
+	RT_TARGET("avx2,fma")
+	void FilterGroupAVX2(const FilterContext& c, uint32_t y, uint32_t x)
+	{
+		ptrdiff_t i = (ptrdiff_t)y * c.stride + x;
+
+		__m256 varianceSum = _mm256_setzero_ps();
+		float rowWeightSum = 0.0f;
+		for (int dy = -1; dy <= 1; dy++)
+		{
+			int yq = (int)y + dy;
+			if (yq < 0 || yq >= (int)c.height)
+				continue;
+			float rowWeight = dy == 0 ? 0.5f : 0.25f;
+			const float* row = c.variance + (ptrdiff_t)yq * c.stride + x;
+			__m256 blurred = _mm256_fmadd_ps(_mm256_loadu_ps(row - 1), _mm256_set1_ps(0.25f),
+				_mm256_fmadd_ps(_mm256_loadu_ps(row), _mm256_set1_ps(0.5f),
+					_mm256_mul_ps(_mm256_loadu_ps(row + 1), _mm256_set1_ps(0.25f))));
+			varianceSum = _mm256_fmadd_ps(blurred, _mm256_set1_ps(rowWeight), varianceSum);
+			rowWeightSum += rowWeight;
+		}
+		__m256 variance = _mm256_max_ps(_mm256_div_ps(varianceSum, _mm256_set1_ps(rowWeightSum)), _mm256_setzero_ps());
+
+		__m256 r = _mm256_loadu_ps(c.r + i), g = _mm256_loadu_ps(c.g + i), b = _mm256_loadu_ps(c.b + i);
+		__m256 luminance = LuminanceAVX2(r, g, b);
+		__m256 invColor = _mm256_div_ps(_mm256_set1_ps(1.0f),
+			_mm256_fmadd_ps(_mm256_set1_ps(c.colorSigma), _mm256_sqrt_ps(variance), _mm256_set1_ps(Epsilon)));
+		__m256 depthScale = _mm256_mul_ps(_mm256_set1_ps(c.depthSigma), _mm256_loadu_ps(c.depthGradient + i));
+		__m256 nx = _mm256_loadu_ps(c.normalX + i), ny = _mm256_loadu_ps(c.normalY + i), nz = _mm256_loadu_ps(c.normalZ + i);
+		__m256 z = _mm256_loadu_ps(c.depth + i);
+		__m256 ar = _mm256_loadu_ps(c.albedoR + i), ag = _mm256_loadu_ps(c.albedoG + i), ab = _mm256_loadu_ps(c.albedoB + i);
+		__m256 invAlbedo = _mm256_set1_ps(c.invAlbedoSigma);
+
+		__m256 centerWeight = _mm256_set1_ps(Kernel[0] * Kernel[0]);
+		__m256 weightSum = centerWeight;
+		__m256 sumR = _mm256_mul_ps(r, centerWeight), sumG = _mm256_mul_ps(g, centerWeight), sumB = _mm256_mul_ps(b, centerWeight);
+		__m256 sumVariance = _mm256_mul_ps(_mm256_loadu_ps(c.variance + i), _mm256_mul_ps(centerWeight, centerWeight));
+		for (const Tap& tap : c.taps)
+		{
+			int yq = (int)y + tap.dy;
+			if (yq < 0 || yq >= (int)c.height)
+				continue;
+			ptrdiff_t q = (ptrdiff_t)yq * c.stride + (ptrdiff_t)x + tap.dx;
+
+			__m256 d = _mm256_fmadd_ps(nz, _mm256_loadu_ps(c.normalZ + q),
+				_mm256_fmadd_ps(ny, _mm256_loadu_ps(c.normalY + q), _mm256_mul_ps(nx, _mm256_loadu_ps(c.normalX + q))));
+			d = _mm256_max_ps(d, _mm256_setzero_ps());
+			for (int k = 0; k < 7; k++)
+				d = _mm256_mul_ps(d, d);
+
+			__m256 qr = _mm256_loadu_ps(c.r + q), qg = _mm256_loadu_ps(c.g + q), qb = _mm256_loadu_ps(c.b + q);
+			// 权重不需要精确的除法，近似倒数足够
+			__m256 depthTerm = _mm256_mul_ps(AbsAVX2(_mm256_sub_ps(z, _mm256_loadu_ps(c.depth + q))),
+				_mm256_rcp_ps(_mm256_fmadd_ps(depthScale, _mm256_set1_ps(tap.distance), _mm256_set1_ps(Epsilon))));
+			__m256 colorTerm = _mm256_mul_ps(AbsAVX2(_mm256_sub_ps(luminance, LuminanceAVX2(qr, qg, qb))), invColor);
+			__m256 albedoDiff = _mm256_add_ps(
+				_mm256_add_ps(AbsAVX2(_mm256_sub_ps(ar, _mm256_loadu_ps(c.albedoR + q))),
+					AbsAVX2(_mm256_sub_ps(ag, _mm256_loadu_ps(c.albedoG + q)))),
+				AbsAVX2(_mm256_sub_ps(ab, _mm256_loadu_ps(c.albedoB + q))));
+			__m256 exponent = _mm256_fmadd_ps(albedoDiff, invAlbedo, _mm256_add_ps(depthTerm, colorTerm));
+			__m256 weight = _mm256_mul_ps(_mm256_mul_ps(_mm256_set1_ps(tap.weight), d), ExpNegAVX2(exponent));
+
+			weightSum = _mm256_add_ps(weightSum, weight);
+			sumR = _mm256_fmadd_ps(weight, qr, sumR);
+			sumG = _mm256_fmadd_ps(weight, qg, sumG);
+			sumB = _mm256_fmadd_ps(weight, qb, sumB);
+			sumVariance = _mm256_fmadd_ps(_mm256_mul_ps(weight, weight), _mm256_loadu_ps(c.variance + q), sumVariance);
+		}
+
+		__m256 invWeightSum = _mm256_div_ps(_mm256_set1_ps(1.0f), weightSum);
+		__m256 outR = _mm256_mul_ps(sumR, invWeightSum);
+		__m256 outG = _mm256_mul_ps(sumG, invWeightSum);
+		__m256 outB = _mm256_mul_ps(sumB, invWeightSum);
+		_mm256_storeu_ps(c.outR + i, outR);
+		_mm256_storeu_ps(c.outG + i, outG);
+		_mm256_storeu_ps(c.outB + i, outB);
+		_mm256_storeu_ps(c.outVariance + i, _mm256_mul_ps(sumVariance, _mm256_mul_ps(invWeightSum, invWeightSum)));
+		if (c.output)
+		{
+			glm::vec4* out = c.output + (size_t)y * c.width + x;
+			for (uint32_t lane = 0; lane < 8; lane++)
+				out[lane] = glm::vec4(c.outR[i + lane], c.outG[i + lane], c.outB[i + lane], 1.0f);
+		}
+	}
+
+	RT_TARGET("avx2,fma")
+	void FilterTileAVX2(const FilterContext& c, const Tile& tile)
+	{
+		for (uint32_t y = tile.y0; y < tile.y1; y++)
+		{
+			uint32_t x = tile.x0;
+			for (; x + 8 <= tile.x1; x += 8)
+				FilterGroupAVX2(c, y, x);
+			for (; x < tile.x1; x++)
+				FilterPixelScalar(c, y, x);
+		}
+	}
+
+#endif
+
+	// 每个任务处理若干整行：把行号当作 tile 的 x 交给调度器。
+	// 大间隔的采样点在方形 tile 里很分散，整行处理时相邻像素共用缓存行，预取也更有效
+	template<typename Func>
+	void RunRows(TileScheduler& scheduler, uint32_t width, uint32_t height, const Func& func)
+	{
+		scheduler.Run(height, 1,
+			[&](const Tile& band, uint32_t)
+			{
+				func(Tile{ 0, band.x0, width, band.x1 });
+			});
+	}
+
+	using FilterTileFunc = void(*)(const FilterContext&, const Tile&);
+
+	FilterTileFunc SelectFilterTile()
+	{
+	#if RT_X64
+		if (SphereSoA::GetSIMDLevel() >= SIMDLevel::AVX2)
+			return FilterTileAVX2;
+	#endif
+		return FilterTileScalar;
+	}
+
+}
+
+void Denoiser::Resize(uint32_t width, uint32_t height)
+{
+	if (width == m_Width && height == m_Height)
+		return;
+	m_Width = width;
+	m_Height = height;
+	m_Stride = width + 2 * Pad;
+
+	// 两侧的 Pad 保持为零，之后只写图像内的像素
+	size_t size = (size_t)m_Stride * height;
+	for (int i = 0; i < 2; i++)
+	{
+		m_ColorR[i].assign(size, 0.0f);
+		m_ColorG[i].assign(size, 0.0f);
+		m_ColorB[i].assign(size, 0.0f);
+		m_Variance[i].assign(size, 0.0f);
+	}
+	for (std::vector<float>* plane : { &m_NormalX, &m_NormalY, &m_NormalZ, &m_Depth, &m_DepthGradient,
+		&m_AlbedoR, &m_AlbedoG, &m_AlbedoB })
+		plane->assign(size, 0.0f);
+}
+
+void Denoiser::Denoise(const DenoiseInput& input, glm::vec4* output, TileScheduler& scheduler)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+	Resize(input.width, input.height);
+	uint32_t width = m_Width, height = m_Height, stride = m_Stride;
+
+	// 载入均值，法线归一化
+	RunRows(scheduler, width, height,
+		[&](const Tile& tile)
+		{
+			for (uint32_t y = tile.y0; y < tile.y1; y++)
+			{
+				for (uint32_t x = tile.x0; x < tile.x1; x++)
+				{
+					size_t p = (size_t)y * width + x;
+					size_t i = (size_t)y * stride + Pad + x;
+					const glm::vec4& color = input.color[p];
+					float invWeight = color.w > 0.0f ? 1.0f / color.w : 0.0f;
+					m_ColorR[0][i] = color.r * invWeight;
+					m_ColorG[0][i] = color.g * invWeight;
+					m_ColorB[0][i] = color.b * invWeight;
+					m_Variance[0][i] = input.variance ? input.variance[p] : -1.0f;
+
+					glm::vec4 albedoDepth = input.albedoDepth[p] * invWeight;
+					m_AlbedoR[i] = albedoDepth.r;
+					m_AlbedoG[i] = albedoDepth.g;
+					m_AlbedoB[i] = albedoDepth.b;
+					m_Depth[i] = albedoDepth.a;
+
+					// 轮廓上的像素混合了命中和未命中的样本，法线变短
+					glm::vec3 normal = glm::vec3(input.normal[p]);
+					float length = glm::length(normal);
+					normal = length > 1e-3f ? normal / length : glm::vec3(0.0f);
+					m_NormalX[i] = normal.x;
+					m_NormalY[i] = normal.y;
+					m_NormalZ[i] = normal.z;
+				}
+			}
+		});
+
+	// 深度梯度取两侧中较小的差，跨轮廓时不被另一个物体放大；
+	// 样本太少的像素用 5x5 邻域内同一表面的亮度方差代替
+	RunRows(scheduler, width, height,
+		[&](const Tile& tile)
+		{
+			auto normalDot = [&](size_t a, size_t b)
+			{
+				return m_NormalX[a] * m_NormalX[b] + m_NormalY[a] * m_NormalY[b] + m_NormalZ[a] * m_NormalZ[b];
+			};
+			auto depthDifference = [&](size_t i, size_t q)
+			{
+				return normalDot(q, q) > 0.0f ? std::abs(m_Depth[i] - m_Depth[q]) : FLT_MAX;
+			};
+
+			for (uint32_t y = tile.y0; y < tile.y1; y++)
+			{
+				for (uint32_t x = tile.x0; x < tile.x1; x++)
+				{
+					size_t i = (size_t)y * stride + Pad + x;
+					float gx = std::min(depthDifference(i, i - 1), depthDifference(i, i + 1));
+					float gy = std::min(y > 0 ? depthDifference(i, i - stride) : FLT_MAX,
+						y + 1 < height ? depthDifference(i, i + stride) : FLT_MAX);
+					m_DepthGradient[i] = std::max(gx == FLT_MAX ? 0.0f : gx, gy == FLT_MAX ? 0.0f : gy);
+
+					if (m_Variance[0][i] >= 0.0f)
+						continue;
+					float sum = 0.0f, sumSquares = 0.0f, count = 0.0f;
+					if (normalDot(i, i) > 0.0f)
+					{
+						for (int dy = -2; dy <= 2; dy++)
+						{
+							int yq = (int)y + dy;
+							if (yq < 0 || yq >= (int)height)
+								continue;
+							for (int dx = -2; dx <= 2; dx++)
+							{
+								size_t q = (size_t)yq * stride + Pad + x + dx;
+								if (normalDot(i, q) < 0.8f)
+									continue;
+								float luminance = Luminance(m_ColorR[0][q], m_ColorG[0][q], m_ColorB[0][q]);
+								sum += luminance;
+								sumSquares += luminance * luminance;
+								count++;
+							}
+						}
+					}
+					float mean = count > 0.0f ? sum / count : 0.0f;
+					m_Variance[0][i] = count > 0.0f ? std::max(sumSquares / count - mean * mean, 0.0f) : 0.0f;
+				}
+			}
+		});
+
+	uint32_t iterations = std::min(m_Iterations, MaxIterations);
+	if (iterations == 0)
+	{
+		for (uint32_t y = 0; y < height; y++)
+		{
+			for (uint32_t x = 0; x < width; x++)
+			{
+				size_t i = (size_t)y * stride + Pad + x;
+				output[(size_t)y * width + x] = glm::vec4(m_ColorR[0][i], m_ColorG[0][i], m_ColorB[0][i], 1.0f);
+			}
+		}
+		m_DenoiseTime = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+		return;
+	}
+
+	static const FilterTileFunc filterTile = SelectFilterTile();
+
+	FilterContext context;
+	context.width = width;
+	context.height = height;
+	context.stride = stride;
+	context.normalX = m_NormalX.data() + Pad;
+	context.normalY = m_NormalY.data() + Pad;
+	context.normalZ = m_NormalZ.data() + Pad;
+	context.depth = m_Depth.data() + Pad;
+	context.depthGradient = m_DepthGradient.data() + Pad;
+	context.albedoR = m_AlbedoR.data() + Pad;
+	context.albedoG = m_AlbedoG.data() + Pad;
+	context.albedoB = m_AlbedoB.data() + Pad;
+	context.colorSigma = m_ColorSigma;
+	context.depthSigma = m_DepthSigma;
+	context.invAlbedoSigma = 1.0f / std::max(m_AlbedoSigma, Epsilon);
+
+	for (uint32_t iteration = 0; iteration < iterations; iteration++)
+	{
+		uint32_t in = iteration & 1, out = in ^ 1;
+		context.r = m_ColorR[in].data() + Pad;
+		context.g = m_ColorG[in].data() + Pad;
+		context.b = m_ColorB[in].data() + Pad;
+		context.variance = m_Variance[in].data() + Pad;
+		context.outR = m_ColorR[out].data() + Pad;
+		context.outG = m_ColorG[out].data() + Pad;
+		context.outB = m_ColorB[out].data() + Pad;
+		context.outVariance = m_Variance[out].data() + Pad;
+		context.output = iteration + 1 == iterations ? output : nullptr;
+
+		int step = 1 << iteration;
+		uint32_t tapCount = 0;
+		for (int dy = -2; dy <= 2; dy++)
+		{
+			for (int dx = -2; dx <= 2; dx++)
+			{
+				if (dx == 0 && dy == 0)
+					continue;
+				Tap& tap = context.taps[tapCount++];
+				tap.dx = dx * step;
+				tap.dy = dy * step;
+				tap.weight = Kernel[std::abs(dx)] * Kernel[std::abs(dy)];
+				tap.distance = (float)step * std::sqrt((float)(dx * dx + dy * dy));
+			}
+		}
+
+		RunRows(scheduler, width, height,
+			[&](const Tile& tile)
+			{
+				filterTile(context, tile);
+			});
+	}
+
+	m_DenoiseTime = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
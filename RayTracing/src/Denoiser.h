@@ -0,0 +1,54 @@
+﻿#pragma once
+
+#include "TileScheduler.h"
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstdint>
+
+// 降噪的输入，均为 width * height 个像素
+struct DenoiseInput
+{
+	uint32_t width = 0, height = 0;
+	const glm::vec4* color = nullptr;       // 累积缓冲，rgb / w 为像素均值
+	const glm::vec4* albedoDepth = nullptr; // 第一次命中的反照率 (rgb) 和距离 (a)，与 color 同权重累积
+	const glm::vec4* normal = nullptr;      // 第一次命中的法线，同上；未命中为零
+	const float* variance = nullptr;        // 像素均值的亮度方差，负数表示样本太少，改用邻域估计
+};
+
+// 降噪参数，只影响显示，调整后不必重新累积
+struct DenoiseSettings
+{
+	uint32_t m_Iterations = 5;   // 不超过 Denoiser::MaxIterations
+	float m_ColorSigma = 4.0f;   // 亮度差相对标准差的容忍度
+	float m_DepthSigma = 1.0f;   // 距离差相对局部梯度的容忍度
+	float m_AlbedoSigma = 0.1f;  // 反照率各通道差之和的容忍度
+};
+
+// 边缘保持的 à-trous 小波滤波 (SVGF 的空间部分，不做时域重投影)
+// 5x5 B3 样条核，第 i 次迭代的采样间隔为 2^i；权重由法线、深度、反照率和按方差缩放的亮度差决定，
+// 方差按权重平方随迭代传播。每个阶段按 tile 并行，行内 AVX2 一次处理 8 个像素
+class Denoiser : public DenoiseSettings
+{
+public:
+	static constexpr uint32_t MaxIterations = 6;
+
+	// output 为 width * height 个像素，alpha 为 1
+	void Denoise(const DenoiseInput& input, glm::vec4* output, TileScheduler& scheduler);
+
+	float GetDenoiseTime() const { return m_DenoiseTime; }
+	void ApplySettings(const DenoiseSettings& settings) { static_cast<DenoiseSettings&>(*this) = settings; }
+
+private:
+	void Resize(uint32_t width, uint32_t height);
+
+private:
+	// 每行左右各留 Pad 个像素，越界的采样点法线为零，权重自然为零
+	uint32_t m_Width = 0, m_Height = 0, m_Stride = 0;
+	std::vector<float> m_ColorR[2], m_ColorG[2], m_ColorB[2], m_Variance[2]; // 迭代之间交替读写
+	std::vector<float> m_NormalX, m_NormalY, m_NormalZ;
+	std::vector<float> m_Depth, m_DepthGradient;
+	std::vector<float> m_AlbedoR, m_AlbedoG, m_AlbedoB;
+
+	float m_DenoiseTime = 0.0f;
+};
@@ -0,0 +1,97 @@
+﻿#include "FrameBudget.h"
+
+#include <algorithm>
+#include <cmath>
+
+FrameBudget::Plan FrameBudget::PlanFrame(uint32_t viewportWidth, uint32_t viewportHeight, uint32_t maxSamplesPerPixel,
+	bool interacting, bool shadingOnly, bool restart)
+{
+	maxSamplesPerPixel = std::max(maxSamplesPerPixel, 1u);
+	bool sameViewport = viewportWidth == m_ViewportWidth && viewportHeight == m_ViewportHeight
+		&& maxSamplesPerPixel == m_MaxSamplesPerPixel;
+	m_ViewportWidth = viewportWidth;
+	m_ViewportHeight = viewportHeight;
+	m_MaxSamplesPerPixel = maxSamplesPerPixel;
+
+	if (!m_Enabled || viewportWidth == 0 || viewportHeight == 0)
+	{
+		m_Refining = false;
+		m_ShadingOnly = false;
+		m_Plan = MakePlan(viewportWidth, viewportHeight, 1.0f, maxSamplesPerPixel);
+		return m_Plan;
+	}
+
+	// 静止累积期间改变样本数或分辨率都会打断累积
+	if (!interacting && m_Refining && !restart && sameViewport)
+		return m_Plan;
+
+	float pixelCount = (float)viewportWidth * (float)viewportHeight;
+	if (interacting && shadingOnly)
+	{
+		// 改变分辨率会重置累积并使缓存的主光线交点失效，只改着色时宁可超出预算也保持全分辨率；
+		// 每像素样本数也是缓存的一部分，只在这段交互的第一帧选定，之后沿用，
+		// 否则读缓存省下的耗时会抬高样本数，反过来又让缓存重建
+		m_Refining = false;
+		if (m_ShadingOnly && sameViewport)
+			return m_Plan;
+		m_ShadingOnly = true;
+		uint32_t samples = 1;
+		if (m_SampleCost > 0.0f)
+			samples = (uint32_t)std::clamp(m_TargetFrameTime / (m_SampleCost * pixelCount), 1.0f, (float)maxSamplesPerPixel);
+		m_Plan = MakePlan(viewportWidth, viewportHeight, 1.0f, samples);
+		return m_Plan;
+	}
+	m_ShadingOnly = false;
+	if (!interacting)
+	{
+		// 全分辨率，预算不足 1 spp 时也不再降低，靠多帧累积
+		uint32_t samples = maxSamplesPerPixel;
+		if (m_SampleCost > 0.0f)
+			samples = (uint32_t)std::clamp(m_TargetFrameTime / (m_SampleCost * pixelCount), 1.0f, (float)maxSamplesPerPixel);
+		m_Refining = true;
+		m_Plan = MakePlan(viewportWidth, viewportHeight, 1.0f, samples);
+		return m_Plan;
+	}
+
+	// 交互中：还没有测量时从最低配置开始
+	m_Refining = false;
+	if (m_SampleCost <= 0.0f)
+	{
+		m_Plan = MakePlan(viewportWidth, viewportHeight, m_MinScale, 1);
+		return m_Plan;
+	}
+
+	float budget = m_TargetFrameTime / m_SampleCost; // 本帧能负担的像素样本数
+	uint32_t samples = (uint32_t)std::clamp(budget / pixelCount, 1.0f, (float)maxSamplesPerPixel);
+	float scale = std::clamp(std::sqrt(budget / (pixelCount * samples)), m_MinScale, 1.0f);
+	scale = std::max(m_MinScale, std::floor(scale / ScaleStep) * ScaleStep);
+
+	// 当前分辨率预计耗时落在目标的 [0.75, 1.05] 倍之间时保持不变
+	if (sameViewport && samples == m_Plan.samplesPerPixel && scale != m_Plan.scale)
+	{
+		float predicted = m_SampleCost * (float)m_Plan.width * (float)m_Plan.height * samples;
+		if (predicted >= 0.75f * m_TargetFrameTime && predicted <= 1.05f * m_TargetFrameTime)
+			scale = m_Plan.scale;
+	}
+	m_Plan = MakePlan(viewportWidth, viewportHeight, scale, samples);
+	return m_Plan;
+}
+
+void FrameBudget::OnFrameRendered(float frameTime)
+{
+	float samples = (float)m_Plan.width * (float)m_Plan.height * (float)m_Plan.samplesPerPixel;
+	if (samples <= 0.0f)
+		return;
+	float cost = frameTime / samples;
+	m_SampleCost = m_SampleCost > 0.0f ? m_SampleCost * 0.5f + cost * 0.5f : cost;
+}
+
+FrameBudget::Plan FrameBudget::MakePlan(uint32_t viewportWidth, uint32_t viewportHeight, float scale, uint32_t samplesPerPixel) const
+{
+	Plan plan;
+	plan.scale = scale;
+	plan.width = std::max(1u, (uint32_t)std::lround(viewportWidth * scale));
+	plan.height = std::max(1u, (uint32_t)std::lround(viewportHeight * scale));
+	plan.samplesPerPixel = samplesPerPixel;
+	return plan;
+}
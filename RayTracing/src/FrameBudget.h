@@ -0,0 +1,44 @@
+﻿#pragma once
+
+#include <cstdint>
+
+// 交互时的帧时间预算：根据上一帧的耗时估计单个样本的代价，
+// 相机移动或几何编辑期间先降低每像素样本数、再降低内部分辨率，使一帧不超过目标时间；
+// 只改着色时保持视口分辨率，样本数在这段交互开始时选定后不再变化，不打断主光线交点缓存；
+// 停下后恢复视口分辨率，每帧样本数按预算选定并在整个累积过程中保持不变
+class FrameBudget
+{
+public:
+	struct Plan
+	{
+		uint32_t width = 0, height = 0; // 内部渲染分辨率，显示时拉伸到视口
+		uint32_t samplesPerPixel = 1;
+		float scale = 1.0f;
+	};
+
+	// restart 表示累积将从头开始 (上一帧之后重置过)，静止时只在此时重新分配预算；
+	// shadingOnly 表示交互中只改了材质、光源或渲染参数，主光线交点不变
+	Plan PlanFrame(uint32_t viewportWidth, uint32_t viewportHeight, uint32_t maxSamplesPerPixel, bool interacting,
+		bool shadingOnly, bool restart);
+	// 渲染完成后报告按 PlanFrame 结果渲染的耗时
+	void OnFrameRendered(float frameTime);
+
+	float GetSampleCost() const { return m_SampleCost; }
+
+public:
+	bool m_Enabled = true;
+	float m_TargetFrameTime = 33.3f; // 毫秒
+	float m_MinScale = 0.25f;        // 内部分辨率相对视口的下限
+
+private:
+	Plan MakePlan(uint32_t viewportWidth, uint32_t viewportHeight, float scale, uint32_t samplesPerPixel) const;
+
+private:
+	static constexpr float ScaleStep = 1.0f / 16.0f; // 分辨率按台阶变化，避免每帧重建图像
+
+	float m_SampleCost = 0.0f; // 每个像素样本的毫秒数，指数平均；0 表示还没有测量
+	Plan m_Plan;
+	uint32_t m_ViewportWidth = 0, m_ViewportHeight = 0, m_MaxSamplesPerPixel = 0;
+	bool m_Refining = false; // 静止累积中，沿用 m_Plan
+	bool m_ShadingOnly = false; // 只改着色的交互中，沿用 m_Plan
+};
@@ -0,0 +1,13 @@
+﻿#pragma once
+
+#include <cstdint>
+
+// 渲染结果的去向 (窗口纹理、文件等)，Renderer 不关心具体实现
+class ImageSink
+{
+public:
+	virtual ~ImageSink() = default;
+
+	virtual void OnResize(uint32_t width, uint32_t height) = 0;
+	virtual void SetData(const uint32_t* rgba) = 0;
+};
@@ -0,0 +1,223 @@
+﻿#include "ImageWriter.h"
+
+#include <fstream>
+#include <vector>
+#include <cstring>
+#include <algorithm>
+#include <cctype>
+
+namespace {
+
+	void PutU32BE(std::vector<uint8_t>& out, uint32_t v)
+	{
+		out.push_back((uint8_t)(v >> 24));
+		out.push_back((uint8_t)(v >> 16));
+		out.push_back((uint8_t)(v >> 8));
+		out.push_back((uint8_t)v);
+	}
+
+	template<typename T>
+	void PutLE(std::vector<uint8_t>& out, T v)
+	{
+		uint8_t bytes[sizeof(T)];
+		memcpy(bytes, &v, sizeof(T));
+		out.insert(out.end(), bytes, bytes + sizeof(T));
+	}
+
+	void PutString(std::vector<uint8_t>& out, const char* s)
+	{
+		out.insert(out.end(), s, s + strlen(s) + 1);
+	}
+
+	uint32_t Crc32(const uint8_t* data, size_t size, uint32_t crc = 0)
+	{
+		static uint32_t table[256] = {};
+		if (table[1] == 0)
+		{
+			for (uint32_t i = 0; i < 256; i++)
+			{
+				uint32_t c = i;
+				for (int k = 0; k < 8; k++)
+					c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+				table[i] = c;
+			}
+		}
+		crc = ~crc;
+		for (size_t i = 0; i < size; i++)
+			crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+		return ~crc;
+	}
+
+	void PutPNGChunk(std::vector<uint8_t>& out, const char* type, const std::vector<uint8_t>& data)
+	{
+		PutU32BE(out, (uint32_t)data.size());
+		size_t typeOffset = out.size();
+		out.insert(out.end(), type, type + 4);
+		out.insert(out.end(), data.begin(), data.end());
+		PutU32BE(out, Crc32(out.data() + typeOffset, data.size() + 4));
+	}
+
+	bool WriteFile(const std::string& path, const void* data, size_t size)
+	{
+		std::ofstream file(path, std::ios::binary);
+		if (!file)
+			return false;
+		file.write((const char*)data, size);
+		return (bool)file;
+	}
+
+	bool EndsWith(const std::string& s, const char* suffix)
+	{
+		size_t n = strlen(suffix);
+		if (s.size() < n)
+			return false;
+		std::string tail = s.substr(s.size() - n);
+		std::transform(tail.begin(), tail.end(), tail.begin(), [](char c) { return (char)tolower(c); });
+		return tail == suffix;
+	}
+
+}
+
+namespace ImageWriter {
+
+	bool WritePPM(const std::string& path, uint32_t width, uint32_t height, const uint32_t* rgba)
+	{
+		std::string header = "P6\n" + std::to_string(width) + " " + std::to_string(height) + "\n255\n";
+		std::vector<uint8_t> out(header.begin(), header.end());
+		out.reserve(out.size() + (size_t)width * height * 3);
+		for (uint32_t y = height; y-- > 0;)
+		{
+			for (uint32_t x = 0; x < width; x++)
+			{
+				uint32_t c = rgba[x + y * width];
+				out.push_back((uint8_t)c);
+				out.push_back((uint8_t)(c >> 8));
+				out.push_back((uint8_t)(c >> 16));
+			}
+		}
+		return WriteFile(path, out.data(), out.size());
+	}
+
+	bool WritePNG(const std::string& path, uint32_t width, uint32_t height, const uint32_t* rgba)
+	{
+		// 每行: 过滤类型 0 + RGBA
+		size_t rowSize = (size_t)width * 4 + 1;
+		std::vector<uint8_t> raw(rowSize * height);
+		for (uint32_t y = 0; y < height; y++)
+		{
+			uint8_t* row = raw.data() + rowSize * y;
+			row[0] = 0;
+			memcpy(row + 1, rgba + (size_t)(height - 1 - y) * width, (size_t)width * 4);
+		}
+
+		// zlib 流，只用不压缩的 stored 块
+		std::vector<uint8_t> zlib = { 0x78, 0x01 };
+		size_t offset = 0;
+		do
+		{
+			uint16_t blockSize = (uint16_t)std::min<size_t>(65535, raw.size() - offset);
+			bool last = offset + blockSize == raw.size();
+			zlib.push_back(last ? 1 : 0);
+			PutLE<uint16_t>(zlib, blockSize);
+			PutLE<uint16_t>(zlib, (uint16_t)~blockSize);
+			zlib.insert(zlib.end(), raw.begin() + offset, raw.begin() + offset + blockSize);
+			offset += blockSize;
+		} while (offset < raw.size());
+
+		uint32_t a = 1, b = 0;
+		for (uint8_t v : raw)
+		{
+			a = (a + v) % 65521;
+			b = (b + a) % 65521;
+		}
+		PutU32BE(zlib, (b << 16) | a);
+
+		std::vector<uint8_t> ihdr;
+		PutU32BE(ihdr, width);
+		PutU32BE(ihdr, height);
+		ihdr.insert(ihdr.end(), { 8, 6, 0, 0, 0 }); // 8 位 RGBA
+
+		std::vector<uint8_t> out = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+		PutPNGChunk(out, "IHDR", ihdr);
+		PutPNGChunk(out, "IDAT", zlib);
+		PutPNGChunk(out, "IEND", {});
+		return WriteFile(path, out.data(), out.size());
+	}
+
+	bool WriteEXR(const std::string& path, uint32_t width, uint32_t height, const glm::vec4* hdr)
+	{
+		// 单部分扫描线、无压缩、FLOAT 通道
+		std::vector<uint8_t> out;
+		PutLE<uint32_t>(out, 20000630);
+		PutLE<uint32_t>(out, 2);
+
+		auto attribute = [&out](const char* name, const char* type, uint32_t size)
+			{
+				PutString(out, name);
+				PutString(out, type);
+				PutLE<uint32_t>(out, size);
+			};
+
+		// 通道按字母序
+		const char* channels[] = { "B", "G", "R" };
+		attribute("channels", "chlist", 3 * (2 + 16) + 1);
+		for (const char* channel : channels)
+		{
+			PutString(out, channel);
+			PutLE<int32_t>(out, 2); // FLOAT
+			PutLE<uint32_t>(out, 0);
+			PutLE<int32_t>(out, 1);
+			PutLE<int32_t>(out, 1);
+		}
+		out.push_back(0);
+
+		attribute("compression", "compression", 1);
+		out.push_back(0);
+		for (const char* window : { "dataWindow", "displayWindow" })
+		{
+			attribute(window, "box2i", 16);
+			PutLE<int32_t>(out, 0);
+			PutLE<int32_t>(out, 0);
+			PutLE<int32_t>(out, (int32_t)width - 1);
+			PutLE<int32_t>(out, (int32_t)height - 1);
+		}
+		attribute("lineOrder", "lineOrder", 1);
+		out.push_back(0);
+		attribute("pixelAspectRatio", "float", 4);
+		PutLE<float>(out, 1.0f);
+		attribute("screenWindowCenter", "v2f", 8);
+		PutLE<float>(out, 0.0f);
+		PutLE<float>(out, 0.0f);
+		attribute("screenWindowWidth", "float", 4);
+		PutLE<float>(out, 1.0f);
+		out.push_back(0);
+
+		uint32_t lineSize = width * 3 * sizeof(float);
+		uint64_t lineOffset = out.size() + (uint64_t)height * sizeof(uint64_t);
+		for (uint32_t y = 0; y < height; y++)
+			PutLE<uint64_t>(out, lineOffset + (uint64_t)y * (8 + lineSize));
+
+		for (uint32_t y = 0; y < height; y++)
+		{
+			PutLE<int32_t>(out, (int32_t)y);
+			PutLE<uint32_t>(out, lineSize);
+			const glm::vec4* row = hdr + (size_t)(height - 1 - y) * width;
+			for (int c = 2; c >= 0; c--)
+			{
+				for (uint32_t x = 0; x < width; x++)
+					PutLE<float>(out, row[x][c]);
+			}
+		}
+		return WriteFile(path, out.data(), out.size());
+	}
+
+	bool Write(const std::string& path, uint32_t width, uint32_t height, const uint32_t* rgba, const glm::vec4* hdr)
+	{
+		if (EndsWith(path, ".png"))
+			return WritePNG(path, width, height, rgba);
+		if (EndsWith(path, ".exr"))
+			return WriteEXR(path, width, height, hdr);
+		return WritePPM(path, width, height, rgba);
+	}
+
+}
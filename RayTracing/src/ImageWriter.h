@@ -0,0 +1,17 @@
+﻿#pragma once
+
+#include <glm/glm.hpp>
+#include <string>
+#include <cstdint>
+
+// 渲染结果第 0 行在底部，写文件时翻转为自上而下
+namespace ImageWriter {
+
+	bool WritePPM(const std::string& path, uint32_t width, uint32_t height, const uint32_t* rgba);
+	bool WritePNG(const std::string& path, uint32_t width, uint32_t height, const uint32_t* rgba);
+	bool WriteEXR(const std::string& path, uint32_t width, uint32_t height, const glm::vec4* hdr);
+
+	// 按扩展名 (.ppm/.png/.exr) 选择格式
+	bool Write(const std::string& path, uint32_t width, uint32_t height, const uint32_t* rgba, const glm::vec4* hdr);
+
+}
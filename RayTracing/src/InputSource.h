@@ -0,0 +1,20 @@
+﻿#pragma once
+
+#include <glm/glm.hpp>
+
+enum class CameraKey
+{
+	Forward, Backward, Left, Right, Down, Up
+};
+
+// 相机控制所需的输入，无窗口时不设置即可
+class InputSource
+{
+public:
+	virtual ~InputSource() = default;
+
+	virtual glm::vec2 GetMousePosition() const = 0;
+	virtual bool IsLookActive() const = 0;
+	virtual bool IsKeyDown(CameraKey key) const = 0;
+	virtual void SetCursorLocked(bool locked) = 0;
+};
@@ -0,0 +1,211 @@
+﻿#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+// 最小的 JSON 读取器，场景文件和基准结果共用；只支持 ASCII 范围的 \u 转义
+
+struct JsonValue
+{
+	enum class Type { Null, Bool, Number, String, Array, Object };
+
+	Type type = Type::Null;
+	bool boolean = false;
+	double number = 0.0;
+	std::string string;
+	std::vector<JsonValue> array;
+	std::vector<std::pair<std::string, JsonValue>> object;
+
+	const JsonValue* Find(const char* key) const
+	{
+		for (const auto& member : object)
+			if (member.first == key)
+				return &member.second;
+		return nullptr;
+	}
+
+	float GetFloat(const char* key, float fallback) const
+	{
+		const JsonValue* value = Find(key);
+		return value && value->type == Type::Number ? (float)value->number : fallback;
+	}
+
+	glm::vec3 GetVec3(const char* key, const glm::vec3& fallback) const
+	{
+		const JsonValue* value = Find(key);
+		if (!value || value->type != Type::Array || value->array.size() != 3)
+			return fallback;
+		return { (float)value->array[0].number, (float)value->array[1].number, (float)value->array[2].number };
+	}
+};
+
+class JsonParser
+{
+public:
+	JsonParser(const char* begin, const char* end) : m_P(begin), m_End(end) {}
+
+	bool Parse(JsonValue& value)
+	{
+		if (!ParseValue(value, 0))
+			return false;
+		SkipWhitespace();
+		return m_P == m_End;
+	}
+
+private:
+	static constexpr int MaxDepth = 64;
+
+	void SkipWhitespace()
+	{
+		while (m_P < m_End && isspace((unsigned char)*m_P))
+			m_P++;
+	}
+
+	bool Consume(char c)
+	{
+		SkipWhitespace();
+		if (m_P < m_End && *m_P == c)
+		{
+			m_P++;
+			return true;
+		}
+		return false;
+	}
+
+	bool ParseLiteral(const char* literal)
+	{
+		size_t length = strlen(literal);
+		if ((size_t)(m_End - m_P) < length || memcmp(m_P, literal, length) != 0)
+			return false;
+		m_P += length;
+		return true;
+	}
+
+	bool ParseString(std::string& out)
+	{
+		if (!Consume('"'))
+			return false;
+		out.clear();
+		while (m_P < m_End && *m_P != '"')
+		{
+			char c = *m_P++;
+			if (c != '\\')
+			{
+				out += c;
+				continue;
+			}
+			if (m_P >= m_End)
+				return false;
+			switch (char e = *m_P++)
+			{
+			case 'n': out += '\n'; break;
+			case 't': out += '\t'; break;
+			case 'r': out += '\r'; break;
+			case 'b': out += '\b'; break;
+			case 'f': out += '\f'; break;
+			case 'u':
+			{
+				// 只需要支持 ASCII 范围，其余替换为 '?'
+				if (m_End - m_P < 4)
+					return false;
+				unsigned code = (unsigned)strtoul(std::string(m_P, m_P + 4).c_str(), nullptr, 16);
+				out += code < 0x80 ? (char)code : '?';
+				m_P += 4;
+				break;
+			}
+			default: out += e; break;
+			}
+		}
+		return Consume('"');
+	}
+
+	bool ParseValue(JsonValue& value, int depth)
+	{
+		if (depth > MaxDepth)
+			return false;
+		SkipWhitespace();
+		if (m_P >= m_End)
+			return false;
+
+		switch (*m_P)
+		{
+		case '{':
+			m_P++;
+			value.type = JsonValue::Type::Object;
+			if (Consume('}'))
+				return true;
+			do
+			{
+				std::pair<std::string, JsonValue> member;
+				if (!ParseString(member.first) || !Consume(':') || !ParseValue(member.second, depth + 1))
+					return false;
+				value.object.push_back(std::move(member));
+			} while (Consume(','));
+			return Consume('}');
+		case '[':
+			m_P++;
+			value.type = JsonValue::Type::Array;
+			if (Consume(']'))
+				return true;
+			do
+			{
+				value.array.emplace_back();
+				if (!ParseValue(value.array.back(), depth + 1))
+					return false;
+			} while (Consume(','));
+			return Consume(']');
+		case '"':
+			value.type = JsonValue::Type::String;
+			return ParseString(value.string);
+		case 't':
+			value.type = JsonValue::Type::Bool;
+			value.boolean = true;
+			return ParseLiteral("true");
+		case 'f':
+			value.type = JsonValue::Type::Bool;
+			return ParseLiteral("false");
+		case 'n':
+			return ParseLiteral("null");
+		default:
+		{
+			// strtod 需要以 0 结尾的字符串，数字不会太长
+			char buffer[64];
+			size_t length = 0;
+			while (m_P + length < m_End && length < sizeof(buffer) - 1 && strchr("+-0123456789.eE", m_P[length]))
+				length++;
+			memcpy(buffer, m_P, length);
+			buffer[length] = '\0';
+			char* numberEnd;
+			value.number = strtod(buffer, &numberEnd);
+			if (numberEnd == buffer)
+				return false;
+			value.type = JsonValue::Type::Number;
+			m_P += numberEnd - buffer;
+			return true;
+		}
+		}
+	}
+
+private:
+	const char* m_P;
+	const char* m_End;
+};
+
+// 写出 JSON 字符串时转义引号和反斜杠
+inline std::string EscapeJSON(const std::string& text)
+{
+	std::string out;
+	for (char c : text)
+	{
+		if (c == '"' || c == '\\')
+			out += '\\';
+		out += c;
+	}
+	return out;
+}
@@ -0,0 +1,146 @@
+﻿#include "LightTree.h"
+#include "Scene.h"
+
+#include <algorithm>
+
+void LightTree::Build(const std::vector<PointLight>& lights)
+{
+	std::vector<AABB> bounds(lights.size());
+	for (size_t i = 0; i < lights.size(); i++)
+		bounds[i] = lights[i].GetBounds();
+
+	// 每个叶子一盏灯，选灯的概率完全由重要性决定
+	m_BVH.Build(bounds, 1);
+
+	const Buffer<uint32_t>& order = m_BVH.GetPrimitiveIndices();
+	m_Lights.resize(lights.size());
+	for (size_t i = 0; i < order.size(); i++)
+	{
+		const PointLight& light = lights[order[i]];
+		m_Lights[i] = { light.position, light.GetPower(), order[i], light.range };
+	}
+
+	// 子节点索引总是大于父节点，倒序即自底向上
+	const Buffer<BVHNode>& nodes = m_BVH.GetNodes();
+	m_NodeData.resize(nodes.size());
+	for (int32_t i = (int32_t)nodes.size() - 1; i >= 0; i--)
+	{
+		const BVHNode& node = nodes[i];
+		NodeData& data = m_NodeData[i];
+		AABB positionBounds;
+		data.power = 0.0f;
+		data.range = 0.0f;
+		if (node.IsLeaf())
+		{
+			for (uint32_t j = node.leftFirst; j < node.leftFirst + node.count; j++)
+			{
+				positionBounds.Grow(m_Lights[j].position);
+				data.power += m_Lights[j].power;
+				data.range = std::max(data.range, m_Lights[j].range);
+			}
+		}
+		else
+		{
+			for (uint32_t child = node.leftFirst; child <= node.leftFirst + 1; child++)
+			{
+				const NodeData& childData = m_NodeData[child];
+				positionBounds.Grow(AABB{ childData.boundsMin, childData.boundsMax });
+				data.power += childData.power;
+				data.range = std::max(data.range, childData.range);
+			}
+		}
+		data.boundsMin = positionBounds.min;
+		data.boundsMax = positionBounds.max;
+	}
+}
+
+float LightTree::NodeImportance(const NodeData& node, const glm::vec3& position, const glm::vec3& normal) const
+{
+	glm::vec3 center = (node.boundsMin + node.boundsMax) * 0.5f;
+	glm::vec3 halfExtent = (node.boundsMax - node.boundsMin) * 0.5f;
+	glm::vec3 toCenter = center - position;
+
+	// 整个节点都在切平面以下
+	if (glm::dot(normal, toCenter) + glm::dot(glm::abs(normal), halfExtent) <= 0.0f)
+		return 0.0f;
+
+	// 最近的灯也超出了最大作用范围
+	glm::vec3 closest = glm::clamp(position, node.boundsMin, node.boundsMax) - position;
+	if (glm::dot(closest, closest) >= node.range * node.range)
+		return 0.0f;
+
+	// 着色点在节点内部时按节点尺寸估计距离，避免近处的节点独占概率
+	float distance2 = std::max(glm::dot(toCenter, toCenter), glm::dot(halfExtent, halfExtent));
+	return node.power / std::max(distance2, 1e-4f);
+}
+
+float LightTree::LightImportance(const LightData& light, const glm::vec3& position, const glm::vec3& normal) const
+{
+	glm::vec3 toLight = light.position - position;
+	float distance = glm::length(toLight);
+	float NdotL = distance > 0.0f ? glm::dot(normal, toLight) / distance : 1.0f;
+	if (NdotL <= 0.0f)
+		return 0.0f;
+	return light.power * PointLight::Attenuation(distance, light.range) * NdotL;
+}
+
+LightSample LightTree::Sample(const glm::vec3& position, const glm::vec3& normal, float u) const
+{
+	LightSample sample;
+	if (m_Lights.empty())
+		return sample;
+
+	const Buffer<BVHNode>& nodes = m_BVH.GetNodes();
+	float pdf = 1.0f;
+	uint32_t nodeIndex = 0;
+	if (NodeImportance(m_NodeData[0], position, normal) <= 0.0f)
+		return sample;
+
+	// 每层按两个子节点的重要性二选一，u 重新映射到 [0, 1) 继续使用
+	while (!nodes[nodeIndex].IsLeaf())
+	{
+		uint32_t left = nodes[nodeIndex].leftFirst;
+		float leftImportance = NodeImportance(m_NodeData[left], position, normal);
+		float rightImportance = NodeImportance(m_NodeData[left + 1], position, normal);
+		float total = leftImportance + rightImportance;
+		if (total <= 0.0f)
+			return sample;
+
+		float leftProbability = leftImportance / total;
+		if (u < leftProbability)
+		{
+			u = u / leftProbability;
+			pdf *= leftProbability;
+			nodeIndex = left;
+		}
+		else
+		{
+			u = (u - leftProbability) / (1.0f - leftProbability);
+			pdf *= 1.0f - leftProbability;
+			nodeIndex = left + 1;
+		}
+		u = std::min(u, 0.99999994f);
+	}
+
+	// 位置重合的灯可能落在同一个叶子里，在叶子内按各自的贡献选
+	const BVHNode& leaf = nodes[nodeIndex];
+	float total = 0.0f;
+	for (uint32_t i = leaf.leftFirst; i < leaf.leftFirst + leaf.count; i++)
+		total += LightImportance(m_Lights[i], position, normal);
+	if (total <= 0.0f)
+		return sample;
+
+	float target = u * total;
+	for (uint32_t i = leaf.leftFirst; i < leaf.leftFirst + leaf.count; i++)
+	{
+		float importance = LightImportance(m_Lights[i], position, normal);
+		if (importance <= 0.0f)
+			continue;
+		sample.lightIndex = m_Lights[i].index;
+		sample.pdf = pdf * importance / total;
+		if (target < importance)
+			break;
+		target -= importance;
+	}
+	return sample;
+}
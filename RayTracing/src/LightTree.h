@@ -0,0 +1,55 @@
+﻿#pragma once
+
+#include "BVH.h"
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstdint>
+
+struct PointLight;
+
+struct LightSample
+{
+	uint32_t lightIndex = 0; // Scene::pointLights 下标
+	float pdf = 0.0f;        // 0 表示附近没有能照亮着色点的灯
+};
+
+// 点光源的层次结构，按估计贡献自顶向下随机选灯，每个着色点的代价为 O(log n)
+// 拓扑来自 BVH (图元为灯的作用范围)，每个节点另外记录灯位置的包围盒、总功率和最大范围
+class LightTree
+{
+public:
+	void Build(const std::vector<PointLight>& lights);
+
+	bool IsEmpty() const { return m_Lights.empty(); }
+	uint32_t GetLightCount() const { return (uint32_t)m_Lights.size(); }
+	float GetBuildTime() const { return m_BVH.GetBuildTime(); }
+
+	// u 在 [0, 1) 均匀分布；只考虑法线 normal 一侧、作用范围覆盖 position 的灯
+	LightSample Sample(const glm::vec3& position, const glm::vec3& normal, float u) const;
+
+private:
+	struct LightData
+	{
+		glm::vec3 position;
+		float power;
+		uint32_t index;
+		float range;
+	};
+
+	struct NodeData
+	{
+		glm::vec3 boundsMin; // 灯位置的包围盒，不含范围
+		float power = 0.0f;
+		glm::vec3 boundsMax;
+		float range = 0.0f;  // 子树中最大的作用范围
+	};
+
+	float NodeImportance(const NodeData& node, const glm::vec3& position, const glm::vec3& normal) const;
+	float LightImportance(const LightData& light, const glm::vec3& position, const glm::vec3& normal) const;
+
+private:
+	BVH m_BVH;
+	std::vector<NodeData> m_NodeData;  // 与 BVH 节点一一对应
+	std::vector<LightData> m_Lights;   // 按 BVH 图元顺序
+};
@@ -0,0 +1,30 @@
+﻿#pragma once
+
+#include <string>
+#include <cstddef>
+
+// 只读内存映射整个文件，析构时解除映射
+class MappedFile
+{
+public:
+	MappedFile() = default;
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	bool Open(const std::string& path);
+	void Close();
+
+	bool IsOpen() const { return m_Data != nullptr; }
+	const char* GetData() const { return m_Data; }
+	size_t GetSize() const { return m_Size; }
+
+private:
+	const char* m_Data = nullptr;
+	size_t m_Size = 0;
+#if defined(_WIN32)
+	void* m_File = nullptr;
+	void* m_Mapping = nullptr;
+#endif
+};
@@ -0,0 +1,751 @@
+﻿#include "MeshLoader.h"
+#include "MappedFile.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstring>
+#include <thread>
+
+namespace {
+
+	// ---- 文本解析，全部基于 [p, end) 指针，不做分配 ----
+
+	bool IsBlank(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+	const char* SkipBlanks(const char* p, const char* end)
+	{
+		while (p < end && IsBlank(*p))
+			p++;
+		return p;
+	}
+
+	const char* SkipToken(const char* p, const char* end)
+	{
+		while (p < end && !IsBlank(*p) && *p != '\n')
+			p++;
+		return p;
+	}
+
+	// 返回下一行行首
+	const char* NextLine(const char* p, const char* end)
+	{
+		const char* newline = (const char*)memchr(p, '\n', end - p);
+		return newline ? newline + 1 : end;
+	}
+
+	bool ParseInt(const char*& p, const char* end, int64_t& value)
+	{
+		bool negative = false;
+		if (p < end && (*p == '-' || *p == '+'))
+			negative = *p++ == '-';
+		if (p >= end || !isdigit((unsigned char)*p))
+			return false;
+		int64_t result = 0;
+		while (p < end && isdigit((unsigned char)*p))
+			result = result * 10 + (*p++ - '0');
+		value = negative ? -result : result;
+		return true;
+	}
+
+	bool ParseFloat(const char*& p, const char* end, float& value)
+	{
+		static const double powers[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+			1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+		bool negative = false;
+		if (p < end && (*p == '-' || *p == '+'))
+			negative = *p++ == '-';
+
+		// 尾数最多取 19 位有效数字，对 float 足够
+		uint64_t mantissa = 0;
+		int digits = 0, exponent = 0;
+		bool any = false;
+		for (; p < end && isdigit((unsigned char)*p); p++, any = true)
+		{
+			if (digits < 19) { mantissa = mantissa * 10 + (*p - '0'); if (mantissa) digits++; }
+			else exponent++;
+		}
+		if (p < end && *p == '.')
+		{
+			for (p++; p < end && isdigit((unsigned char)*p); p++, any = true)
+			{
+				if (digits < 19) { mantissa = mantissa * 10 + (*p - '0'); if (mantissa) digits++; exponent--; }
+			}
+		}
+		if (!any)
+			return false;
+		if (p < end && (*p == 'e' || *p == 'E'))
+		{
+			const char* save = p++;
+			int64_t e;
+			if (ParseInt(p, end, e))
+				exponent += (int)std::max<int64_t>(-400, std::min<int64_t>(400, e));
+			else
+				p = save;
+		}
+
+		double result = (double)mantissa;
+		while (exponent > 22) { result *= 1e22; exponent -= 22; }
+		while (exponent < -22) { result /= 1e22; exponent += 22; }
+		result = exponent >= 0 ? result * powers[exponent] : result / powers[-exponent];
+		value = (float)(negative ? -result : result);
+		return true;
+	}
+
+	// ---- 并行分块 ----
+
+	uint32_t GetChunkCount(size_t size)
+	{
+		// 每块至少 1MB，小文件单线程
+		size_t bySize = std::max<size_t>(1, size >> 20);
+		return (uint32_t)std::min<size_t>(bySize, std::max(1u, std::thread::hardware_concurrency()));
+	}
+
+	// 把 [begin, end) 切成 chunkCount 段，边界对齐到行首；返回 chunkCount + 1 个边界
+	std::vector<const char*> SplitLines(const char* begin, const char* end, uint32_t chunkCount)
+	{
+		std::vector<const char*> bounds(chunkCount + 1);
+		bounds[0] = begin;
+		bounds[chunkCount] = end;
+		size_t size = end - begin;
+		for (uint32_t i = 1; i < chunkCount; i++)
+		{
+			const char* p = begin + size * i / chunkCount;
+			p = std::max(p, bounds[i - 1]);
+			bounds[i] = (p == begin || p[-1] == '\n') ? p : NextLine(p, end);
+		}
+		return bounds;
+	}
+
+	template<typename Fn>
+	void ParallelFor(uint32_t count, Fn&& fn)
+	{
+		std::vector<std::thread> threads;
+		for (uint32_t i = 1; i < count; i++)
+			threads.emplace_back([&fn, i] { fn(i); });
+		if (count > 0)
+			fn(0);
+		for (std::thread& thread : threads)
+			thread.join();
+	}
+
+	template<typename T>
+	std::vector<T> ExclusivePrefixSum(const std::vector<T>& counts)
+	{
+		std::vector<T> offsets(counts.size() + 1, 0);
+		for (size_t i = 0; i < counts.size(); i++)
+			offsets[i + 1] = offsets[i] + counts[i];
+		return offsets;
+	}
+
+	// ---- OBJ ----
+
+	enum class ObjLine { Other, Vertex, Face };
+
+	ObjLine ClassifyObjLine(const char*& p, const char* end)
+	{
+		p = SkipBlanks(p, end);
+		if (end - p >= 2 && p[0] == 'v' && IsBlank(p[1])) { p += 2; return ObjLine::Vertex; }
+		if (end - p >= 2 && p[0] == 'f' && IsBlank(p[1])) { p += 2; return ObjLine::Face; }
+		return ObjLine::Other;
+	}
+
+	// 面的顶点数，形如 "1 2 3" / "1/1 2/2 3/3" / "1//1 ..."
+	uint32_t CountFaceVertices(const char* p, const char* end)
+	{
+		uint32_t count = 0;
+		while (true)
+		{
+			p = SkipBlanks(p, end);
+			if (p >= end || *p == '\n' || *p == '#')
+				return count;
+			count++;
+			p = SkipToken(p, end);
+		}
+	}
+
+}
+
+namespace MeshLoader {
+
+	bool LoadOBJ(const std::string& path, MeshData& mesh)
+	{
+		MappedFile file;
+		if (!file.Open(path))
+			return false;
+		const char* begin = file.GetData();
+		const char* end = begin + file.GetSize();
+
+		uint32_t chunkCount = GetChunkCount(file.GetSize());
+		std::vector<const char*> bounds = SplitLines(begin, end, chunkCount);
+
+		// 第一遍：统计每块的顶点数和三角形数
+		std::vector<uint64_t> vertexCounts(chunkCount, 0), triangleCounts(chunkCount, 0);
+		ParallelFor(chunkCount, [&](uint32_t chunk)
+			{
+				for (const char* line = bounds[chunk]; line < bounds[chunk + 1]; line = NextLine(line, end))
+				{
+					const char* p = line;
+					ObjLine type = ClassifyObjLine(p, end);
+					if (type == ObjLine::Vertex)
+						vertexCounts[chunk]++;
+					else if (type == ObjLine::Face)
+						triangleCounts[chunk] += std::max(3u, CountFaceVertices(p, end)) - 2;
+				}
+			});
+
+		std::vector<uint64_t> vertexOffsets = ExclusivePrefixSum(vertexCounts);
+		std::vector<uint64_t> triangleOffsets = ExclusivePrefixSum(triangleCounts);
+		if (vertexOffsets.back() > UINT32_MAX || triangleOffsets.back() * 3 > UINT32_MAX)
+			return false;
+		mesh.positions.resize(vertexOffsets.back());
+		mesh.indices.resize(triangleOffsets.back() * 3);
+
+		// 第二遍：各块写入自己的区间；负索引相对于当前已出现的顶点数
+		std::atomic<bool> ok(true);
+		ParallelFor(chunkCount, [&](uint32_t chunk)
+			{
+				uint64_t vertex = vertexOffsets[chunk];
+				uint64_t index = triangleOffsets[chunk] * 3;
+				for (const char* line = bounds[chunk]; line < bounds[chunk + 1] && ok; line = NextLine(line, end))
+				{
+					const char* p = line;
+					ObjLine type = ClassifyObjLine(p, end);
+					if (type == ObjLine::Vertex)
+					{
+						glm::vec3& position = mesh.positions[vertex++];
+						for (int axis = 0; axis < 3; axis++)
+						{
+							p = SkipBlanks(p, end);
+							if (!ParseFloat(p, end, position[axis]))
+								ok = false;
+						}
+					}
+					else if (type == ObjLine::Face)
+					{
+						uint32_t faceVertexCount = CountFaceVertices(p, end);
+						if (faceVertexCount < 3)
+						{
+							ok = false;
+							break;
+						}
+
+						uint32_t first = 0, previous = 0;
+						for (uint32_t i = 0; i < faceVertexCount; i++)
+						{
+							p = SkipBlanks(p, end);
+							int64_t value = 0;
+							if (!ParseInt(p, end, value) || value == 0)
+							{
+								ok = false;
+								break;
+							}
+							p = SkipToken(p, end); // 跳过 /vt/vn
+
+							int64_t resolved = value > 0 ? value - 1 : (int64_t)vertex + value;
+							if (resolved < 0 || resolved >= (int64_t)mesh.positions.size())
+							{
+								ok = false;
+								break;
+							}
+
+							uint32_t current = (uint32_t)resolved;
+							if (i == 0)
+								first = current;
+							else if (i >= 2)
+							{
+								mesh.indices[index++] = first;
+								mesh.indices[index++] = previous;
+								mesh.indices[index++] = current;
+							}
+							previous = current;
+						}
+					}
+				}
+			});
+
+		if (!ok)
+		{
+			mesh = MeshData();
+			return false;
+		}
+		return true;
+	}
+
+}
+
+namespace {
+
+	// ---- PLY ----
+
+	enum class PlyType { Invalid, Int8, UInt8, Int16, UInt16, Int32, UInt32, Float32, Float64 };
+
+	PlyType ParsePlyType(const std::string& name)
+	{
+		if (name == "char" || name == "int8") return PlyType::Int8;
+		if (name == "uchar" || name == "uint8") return PlyType::UInt8;
+		if (name == "short" || name == "int16") return PlyType::Int16;
+		if (name == "ushort" || name == "uint16") return PlyType::UInt16;
+		if (name == "int" || name == "int32") return PlyType::Int32;
+		if (name == "uint" || name == "uint32") return PlyType::UInt32;
+		if (name == "float" || name == "float32") return PlyType::Float32;
+		if (name == "double" || name == "float64") return PlyType::Float64;
+		return PlyType::Invalid;
+	}
+
+	uint32_t PlyTypeSize(PlyType type)
+	{
+		switch (type)
+		{
+		case PlyType::Int8: case PlyType::UInt8: return 1;
+		case PlyType::Int16: case PlyType::UInt16: return 2;
+		case PlyType::Int32: case PlyType::UInt32: case PlyType::Float32: return 4;
+		case PlyType::Float64: return 8;
+		default: return 0;
+		}
+	}
+
+	double ReadPlyValue(const char* p, PlyType type, bool bigEndian)
+	{
+		uint8_t bytes[8];
+		uint32_t size = PlyTypeSize(type);
+		memcpy(bytes, p, size);
+		if (bigEndian)
+			std::reverse(bytes, bytes + size);
+
+		switch (type)
+		{
+		case PlyType::Int8: { int8_t v; memcpy(&v, bytes, 1); return v; }
+		case PlyType::UInt8: return bytes[0];
+		case PlyType::Int16: { int16_t v; memcpy(&v, bytes, 2); return v; }
+		case PlyType::UInt16: { uint16_t v; memcpy(&v, bytes, 2); return v; }
+		case PlyType::Int32: { int32_t v; memcpy(&v, bytes, 4); return v; }
+		case PlyType::UInt32: { uint32_t v; memcpy(&v, bytes, 4); return v; }
+		case PlyType::Float32: { float v; memcpy(&v, bytes, 4); return v; }
+		case PlyType::Float64: { double v; memcpy(&v, bytes, 8); return v; }
+		default: return 0.0;
+		}
+	}
+
+	struct PlyProperty
+	{
+		std::string name;
+		PlyType type = PlyType::Invalid;      // 列表时为元素类型
+		PlyType countType = PlyType::Invalid; // 非 Invalid 表示列表
+		bool IsList() const { return countType != PlyType::Invalid; }
+	};
+
+	struct PlyElement
+	{
+		std::string name;
+		uint64_t count = 0;
+		std::vector<PlyProperty> properties;
+
+		// 全部为标量属性时的二进制记录长度，含列表时为 0
+		uint32_t GetStride() const
+		{
+			uint32_t stride = 0;
+			for (const PlyProperty& property : properties)
+			{
+				if (property.IsList())
+					return 0;
+				stride += PlyTypeSize(property.type);
+			}
+			return stride;
+		}
+
+		int FindProperty(const char* propertyName) const
+		{
+			for (size_t i = 0; i < properties.size(); i++)
+				if (properties[i].name == propertyName)
+					return (int)i;
+			return -1;
+		}
+	};
+
+	enum class PlyFormat { Ascii, BinaryLittleEndian, BinaryBigEndian };
+
+	struct PlyHeader
+	{
+		PlyFormat format = PlyFormat::Ascii;
+		std::vector<PlyElement> elements;
+		const char* body = nullptr;
+	};
+
+	// 头部很短，按行切成单词即可
+	bool ParsePlyHeader(const char* begin, const char* end, PlyHeader& header)
+	{
+		const char* line = begin;
+		bool first = true;
+		while (line < end)
+		{
+			const char* next = NextLine(line, end);
+			std::vector<std::string> words;
+			for (const char* p = SkipBlanks(line, next); p < next && *p != '\n'; p = SkipBlanks(p, next))
+			{
+				const char* tokenEnd = SkipToken(p, next);
+				words.emplace_back(p, tokenEnd);
+				p = tokenEnd;
+			}
+			line = next;
+
+			if (first)
+			{
+				if (words.size() != 1 || words[0] != "ply")
+					return false;
+				first = false;
+				continue;
+			}
+			if (words.empty() || words[0] == "comment" || words[0] == "obj_info")
+				continue;
+
+			if (words[0] == "format" && words.size() >= 2)
+			{
+				if (words[1] == "ascii") header.format = PlyFormat::Ascii;
+				else if (words[1] == "binary_little_endian") header.format = PlyFormat::BinaryLittleEndian;
+				else if (words[1] == "binary_big_endian") header.format = PlyFormat::BinaryBigEndian;
+				else return false;
+			}
+			else if (words[0] == "element" && words.size() >= 3)
+			{
+				PlyElement element;
+				element.name = words[1];
+				element.count = strtoull(words[2].c_str(), nullptr, 10);
+				header.elements.push_back(element);
+			}
+			else if (words[0] == "property" && !header.elements.empty())
+			{
+				PlyProperty property;
+				if (words.size() >= 5 && words[1] == "list")
+				{
+					property.countType = ParsePlyType(words[2]);
+					property.type = ParsePlyType(words[3]);
+					property.name = words[4];
+					if (property.countType == PlyType::Invalid)
+						return false;
+				}
+				else if (words.size() >= 3)
+				{
+					property.type = ParsePlyType(words[1]);
+					property.name = words[2];
+				}
+				if (property.type == PlyType::Invalid)
+					return false;
+				header.elements.back().properties.push_back(property);
+			}
+			else if (words[0] == "end_header")
+			{
+				header.body = line;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// 列表长度和顶点下标可能存成有符号或浮点类型，负数和超出 uint32_t 的值在转换前拒绝
+	bool ReadPlyIndex(const char* p, PlyType type, bool bigEndian, uint32_t& value)
+	{
+		double raw = ReadPlyValue(p, type, bigEndian);
+		if (!(raw >= 0.0 && raw <= (double)UINT32_MAX))
+			return false;
+		value = (uint32_t)raw;
+		return true;
+	}
+
+	// 多边形按扇形拆成三角形
+	bool AppendFace(MeshData& mesh, const uint32_t* faceIndices, uint32_t faceVertexCount)
+	{
+		for (uint32_t i = 0; i < faceVertexCount; i++)
+			if (faceIndices[i] >= mesh.positions.size())
+				return false;
+		for (uint32_t i = 2; i < faceVertexCount; i++)
+		{
+			mesh.indices.push_back(faceIndices[0]);
+			mesh.indices.push_back(faceIndices[i - 1]);
+			mesh.indices.push_back(faceIndices[i]);
+		}
+		return true;
+	}
+
+	bool LoadPLYBinary(const PlyHeader& header, const char* end, MeshData& mesh)
+	{
+		bool bigEndian = header.format == PlyFormat::BinaryBigEndian;
+		const char* p = header.body;
+		for (const PlyElement& element : header.elements)
+		{
+			uint32_t stride = element.GetStride();
+			if (element.name == "vertex")
+			{
+				// 定长记录，按顶点区间并行读取
+				int axes[3] = { element.FindProperty("x"), element.FindProperty("y"), element.FindProperty("z") };
+				if (stride == 0 || axes[0] < 0 || axes[1] < 0 || axes[2] < 0 || (uint64_t)(end - p) / stride < element.count)
+					return false;
+
+				uint32_t offsets[3];
+				PlyType types[3];
+				for (int axis = 0; axis < 3; axis++)
+				{
+					offsets[axis] = 0;
+					for (int i = 0; i < axes[axis]; i++)
+						offsets[axis] += PlyTypeSize(element.properties[i].type);
+					types[axis] = element.properties[axes[axis]].type;
+				}
+
+				mesh.positions.resize(element.count);
+				uint32_t chunkCount = GetChunkCount(element.count * stride);
+				const char* vertexData = p;
+				ParallelFor(chunkCount, [&](uint32_t chunk)
+					{
+						uint64_t first = element.count * chunk / chunkCount;
+						uint64_t last = element.count * (chunk + 1) / chunkCount;
+						for (uint64_t v = first; v < last; v++)
+						{
+							const char* record = vertexData + v * stride;
+							for (int axis = 0; axis < 3; axis++)
+								mesh.positions[v][axis] = (float)ReadPlyValue(record + offsets[axis], types[axis], bigEndian);
+						}
+					});
+				p += element.count * stride;
+			}
+			else if (element.name == "face")
+			{
+				// 变长记录，顺序扫描；每个面至少有一个字节的顶点数，count 不会超过剩余字节数
+				if ((uint64_t)(end - p) < element.count)
+					return false;
+				mesh.indices.reserve(element.count * 3);
+				uint32_t faceIndices[256];
+				for (uint64_t f = 0; f < element.count; f++)
+				{
+					bool added = false;
+					for (const PlyProperty& property : element.properties)
+					{
+						if (!property.IsList())
+						{
+							uint32_t size = PlyTypeSize(property.type);
+							if ((uint64_t)(end - p) < size)
+								return false;
+							p += size;
+							continue;
+						}
+						uint32_t countSize = PlyTypeSize(property.countType), itemSize = PlyTypeSize(property.type);
+						if ((uint64_t)(end - p) < countSize)
+							return false;
+						uint32_t itemCount = 0;
+						if (!ReadPlyIndex(p, property.countType, bigEndian, itemCount))
+							return false;
+						p += countSize;
+						if ((uint64_t)(end - p) < (uint64_t)itemCount * itemSize)
+							return false;
+
+						if (!added && (property.name == "vertex_indices" || property.name == "vertex_index"))
+						{
+							if (itemCount < 3 || itemCount > 256)
+								return false;
+							for (uint32_t i = 0; i < itemCount; i++)
+								if (!ReadPlyIndex(p + i * itemSize, property.type, bigEndian, faceIndices[i]))
+									return false;
+							if (!AppendFace(mesh, faceIndices, itemCount))
+								return false;
+							added = true;
+						}
+						p += itemCount * itemSize;
+					}
+				}
+			}
+			else
+			{
+				if (stride != 0)
+				{
+					if ((uint64_t)(end - p) / stride < element.count)
+						return false;
+					p += element.count * stride;
+				}
+				else if (element.count > 0)
+					return !mesh.indices.empty(); // 无法跳过的变长元素，只有在面之后才可以忽略
+			}
+		}
+		return true;
+	}
+
+	bool LoadPLYAscii(const PlyHeader& header, const char* end, MeshData& mesh)
+	{
+		// 元素按顺序逐行排列：先找到顶点和面所在的行区间
+		uint64_t vertexLine = 0, faceLine = 0, line = 0;
+		const PlyElement* vertexElement = nullptr;
+		const PlyElement* faceElement = nullptr;
+		for (const PlyElement& element : header.elements)
+		{
+			if (element.name == "vertex") { vertexElement = &element; vertexLine = line; }
+			else if (element.name == "face") { faceElement = &element; faceLine = line; }
+			line += element.count;
+		}
+		if (!vertexElement)
+			return false;
+
+		int axes[3] = { vertexElement->FindProperty("x"), vertexElement->FindProperty("y"), vertexElement->FindProperty("z") };
+		if (axes[0] < 0 || axes[1] < 0 || axes[2] < 0 || vertexElement->GetStride() == 0)
+			return false;
+		int faceList = -1;
+		if (faceElement)
+		{
+			faceList = faceElement->FindProperty("vertex_indices");
+			if (faceList < 0)
+				faceList = faceElement->FindProperty("vertex_index");
+			if (faceList < 0 || !faceElement->properties[faceList].IsList())
+				return false;
+		}
+
+		uint32_t chunkCount = GetChunkCount(end - header.body);
+		std::vector<const char*> bounds = SplitLines(header.body, end, chunkCount);
+
+		// 跳到面记录中的索引列表，返回列表长度
+		auto seekFaceList = [&](const char*& p) -> int64_t
+			{
+				for (int i = 0; i <= faceList; i++)
+				{
+					const PlyProperty& property = faceElement->properties[i];
+					p = SkipBlanks(p, end);
+					if (!property.IsList())
+					{
+						p = SkipToken(p, end);
+						continue;
+					}
+					int64_t itemCount = 0;
+					if (!ParseInt(p, end, itemCount))
+						return -1;
+					if (i == faceList)
+						return itemCount;
+					for (int64_t k = 0; k < itemCount; k++)
+						p = SkipToken(SkipBlanks(p, end), end);
+				}
+				return -1;
+			};
+
+		// 第一遍：每块的行数；第二遍：每块的三角形数；第三遍：写入
+		std::vector<uint64_t> lineCounts(chunkCount, 0), triangleCounts(chunkCount, 0);
+		ParallelFor(chunkCount, [&](uint32_t chunk)
+			{
+				for (const char* p = bounds[chunk]; p < bounds[chunk + 1]; p = NextLine(p, end))
+					lineCounts[chunk]++;
+			});
+		std::vector<uint64_t> lineOffsets = ExclusivePrefixSum(lineCounts);
+		if (lineOffsets.back() < vertexLine + vertexElement->count)
+			return false;
+
+		ParallelFor(chunkCount, [&](uint32_t chunk)
+			{
+				if (!faceElement)
+					return;
+				uint64_t lineIndex = lineOffsets[chunk];
+				for (const char* p = bounds[chunk]; p < bounds[chunk + 1]; p = NextLine(p, end), lineIndex++)
+				{
+					if (lineIndex < faceLine || lineIndex >= faceLine + faceElement->count)
+						continue;
+					const char* q = p;
+					int64_t itemCount = seekFaceList(q);
+					if (itemCount >= 3)
+						triangleCounts[chunk] += itemCount - 2;
+				}
+			});
+		std::vector<uint64_t> triangleOffsets = ExclusivePrefixSum(triangleCounts);
+
+		mesh.positions.resize(vertexElement->count);
+		mesh.indices.resize(triangleOffsets.back() * 3);
+		std::atomic<bool> ok(true);
+		ParallelFor(chunkCount, [&](uint32_t chunk)
+			{
+				uint64_t lineIndex = lineOffsets[chunk];
+				uint64_t index = triangleOffsets[chunk] * 3;
+				for (const char* p = bounds[chunk]; p < bounds[chunk + 1] && ok; p = NextLine(p, end), lineIndex++)
+				{
+					if (lineIndex >= vertexLine && lineIndex < vertexLine + vertexElement->count)
+					{
+						glm::vec3& position = mesh.positions[lineIndex - vertexLine];
+						const char* q = p;
+						for (int i = 0, axis = 0; i < (int)vertexElement->properties.size() && axis < 3; i++)
+						{
+							q = SkipBlanks(q, end);
+							int target = i == axes[0] ? 0 : i == axes[1] ? 1 : i == axes[2] ? 2 : -1;
+							if (target < 0)
+								q = SkipToken(q, end);
+							else if (ParseFloat(q, end, position[target]))
+								axis++;
+							else
+								ok = false;
+						}
+					}
+					else if (faceElement && lineIndex >= faceLine && lineIndex < faceLine + faceElement->count)
+					{
+						const char* q = p;
+						int64_t itemCount = seekFaceList(q);
+						if (itemCount < 3)
+						{
+							ok = false;
+							break;
+						}
+						int64_t first = 0, previous = 0;
+						for (int64_t i = 0; i < itemCount; i++)
+						{
+							q = SkipBlanks(q, end);
+							int64_t current = 0;
+							if (!ParseInt(q, end, current) || current < 0 || current >= (int64_t)mesh.positions.size())
+							{
+								ok = false;
+								break;
+							}
+							if (i == 0)
+								first = current;
+							else if (i >= 2)
+							{
+								mesh.indices[index++] = (uint32_t)first;
+								mesh.indices[index++] = (uint32_t)previous;
+								mesh.indices[index++] = (uint32_t)current;
+							}
+							previous = current;
+						}
+					}
+				}
+			});
+		return ok;
+	}
+
+}
+
+namespace MeshLoader {
+
+	bool LoadPLY(const std::string& path, MeshData& mesh)
+	{
+		MappedFile file;
+		if (!file.Open(path))
+			return false;
+		const char* begin = file.GetData();
+		const char* end = begin + file.GetSize();
+
+		PlyHeader header;
+		if (!ParsePlyHeader(begin, end, header))
+			return false;
+
+		mesh = MeshData();
+		bool ok = header.format == PlyFormat::Ascii
+			? LoadPLYAscii(header, end, mesh)
+			: LoadPLYBinary(header, end, mesh);
+		if (!ok)
+			mesh = MeshData();
+		return ok;
+	}
+
+	bool Load(const std::string& path, MeshData& mesh)
+	{
+		std::string extension = path.substr(path.find_last_of('.') + 1);
+		std::transform(extension.begin(), extension.end(), extension.begin(),
+			[](unsigned char c) { return (char)std::tolower(c); });
+
+		if (extension == "obj")
+			return LoadOBJ(path, mesh);
+		if (extension == "ply")
+			return LoadPLY(path, mesh);
+		return false;
+	}
+
+}
@@ -0,0 +1,25 @@
+﻿#pragma once
+
+#include <glm/glm.hpp>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+struct MeshData
+{
+	std::vector<glm::vec3> positions;
+	std::vector<uint32_t> indices; // 每三个一个三角形，多边形按扇形拆分
+};
+
+// 内存映射文件后按行分块并行解析，解析过程中不为单行分配内存
+// 只读取位置和面，法线、纹理坐标和材质分组被忽略
+namespace MeshLoader {
+
+	bool LoadOBJ(const std::string& path, MeshData& mesh);
+	// ascii / binary_little_endian / binary_big_endian
+	bool LoadPLY(const std::string& path, MeshData& mesh);
+
+	// 按扩展名 (.obj/.ply) 选择格式
+	bool Load(const std::string& path, MeshData& mesh);
+
+}
@@ -0,0 +1,132 @@
+﻿#include "Profiler.h"
+
+#include <algorithm>
+#include <cstdio>
+
+thread_local Profiler::ThreadData* Profiler::s_CurrentThread = nullptr;
+
+const char* Profiler::GetCounterName(ProfileCounter counter)
+{
+	switch (counter)
+	{
+	case ProfileCounter::SphereTests: return "Sphere tests";
+	case ProfileCounter::TriangleTests: return "Triangle tests";
+	case ProfileCounter::TraversalSteps: return "BVH nodes visited";
+	default: return "?";
+	}
+}
+
+const char* Profiler::GetStageName(ProfileStage stage)
+{
+	switch (stage)
+	{
+	case ProfileStage::Intersect: return "Intersect";
+	case ProfileStage::Shade: return "Shade";
+	case ProfileStage::Shadow: return "Shadow rays";
+	case ProfileStage::Sky: return "Sky";
+	case ProfileStage::Accumulate: return "Accumulate";
+	case ProfileStage::Denoise: return "Denoise";
+	case ProfileStage::Upload: return "Upload";
+	default: return "?";
+	}
+}
+
+void Profiler::BeginFrame(uint32_t threadCount)
+{
+	if (m_Threads.size() < threadCount)
+		m_Threads.resize(threadCount);
+	m_ThreadCount = threadCount;
+	bool capturing = IsCapturing();
+	for (uint32_t i = 0; i < threadCount; i++)
+	{
+		ThreadData& thread = m_Threads[i];
+		std::fill(std::begin(thread.counters), std::end(thread.counters), 0);
+		std::fill(std::begin(thread.stageTicks), std::end(thread.stageTicks), 0);
+		thread.events.clear();
+		thread.capturing = capturing;
+	}
+	BindThread(&m_Threads[0]);
+	m_FrameStartTime = std::chrono::steady_clock::now();
+	m_FrameStartTicks = Now();
+}
+
+void Profiler::EndFrame()
+{
+	uint64_t endTicks = Now();
+	auto endTime = std::chrono::steady_clock::now();
+	double frameMs = std::chrono::duration<double, std::milli>(endTime - m_FrameStartTime).count();
+	if (endTicks > m_FrameStartTicks)
+		m_MsPerTick = frameMs / (double)(endTicks - m_FrameStartTicks);
+
+	// 所有 tile 已经完成，其他线程不会再写
+	m_FrameStats = ProfileFrameStats();
+	m_FrameStats.frameMs = frameMs;
+	for (uint32_t i = 0; i < m_ThreadCount; i++)
+	{
+		const ThreadData& thread = m_Threads[i];
+		for (size_t c = 0; c < (size_t)ProfileCounter::Count; c++)
+			m_FrameStats.counters[c] += thread.counters[c];
+		for (size_t s = 0; s < (size_t)ProfileStage::Count; s++)
+			m_FrameStats.stageMs[s] += TicksToMs(thread.stageTicks[s]);
+	}
+	BindThread(nullptr);
+
+	if (!IsCapturing())
+		return;
+	double frameStartUs = std::chrono::duration<double, std::micro>(m_FrameStartTime - m_CaptureStartTime).count();
+	double usPerTick = m_MsPerTick * 1000.0;
+	m_CapturedEvents.push_back({ "Frame", 0, frameStartUs, frameMs * 1000.0, 0, 0, -1, 0.0 });
+	for (uint32_t i = 0; i < m_ThreadCount; i++)
+	{
+		for (const TraceEvent& event : m_Threads[i].events)
+		{
+			double startUs = frameStartUs + (double)(int64_t)(event.start - m_FrameStartTicks) * usPerTick;
+			m_CapturedEvents.push_back({ event.name, i, startUs, (double)(event.end - event.start) * usPerTick,
+				event.arg0, event.arg1, -1, 0.0 });
+		}
+	}
+	for (size_t s = 0; s < (size_t)ProfileStage::Count; s++)
+		m_CapturedEvents.push_back({ GetStageName((ProfileStage)s), 0, frameStartUs, 0.0, 0, 0, (int)s, m_FrameStats.stageMs[s] });
+	m_CaptureFramesLeft--;
+}
+
+void Profiler::StartCapture(uint32_t frameCount)
+{
+	m_CapturedEvents.clear();
+	m_CaptureFramesLeft = frameCount;
+	m_CaptureStartTime = std::chrono::steady_clock::now();
+}
+
+bool Profiler::WriteTrace(const std::string& path) const
+{
+	FILE* file = fopen(path.c_str(), "w");
+	if (!file)
+		return false;
+
+	fprintf(file, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+	uint32_t threadCount = 0;
+	for (const CapturedEvent& event : m_CapturedEvents)
+		threadCount = std::max(threadCount, event.thread + 1);
+	for (uint32_t i = 0; i < threadCount; i++)
+		fprintf(file, "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 0, \"tid\": %u, \"args\": {\"name\": \"worker %u\"}},\n", i, i);
+
+	for (size_t i = 0; i < m_CapturedEvents.size(); i++)
+	{
+		const CapturedEvent& event = m_CapturedEvents[i];
+		if (event.counter >= 0)
+		{
+			// 每个阶段一条计数器曲线，值为该帧所有线程的耗时之和
+			fprintf(file, "{\"name\": \"%s\", \"ph\": \"C\", \"pid\": 0, \"ts\": %.3f, \"args\": {\"ms\": %.4f}}",
+				event.name, event.startUs, event.value);
+		}
+		else
+		{
+			fprintf(file, "{\"name\": \"%s\", \"ph\": \"X\", \"pid\": 0, \"tid\": %u, \"ts\": %.3f, \"dur\": %.3f, "
+				"\"args\": {\"x\": %u, \"y\": %u}}", event.name, event.thread, event.startUs, event.durationUs, event.arg0, event.arg1);
+		}
+		fprintf(file, i + 1 < m_CapturedEvents.size() ? ",\n" : "\n");
+	}
+	fprintf(file, "]}\n");
+	fclose(file);
+	return true;
+}
@@ -0,0 +1,180 @@
+﻿#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#if defined(_MSC_VER) && defined(_M_X64)
+	#include <intrin.h>
+#elif defined(__x86_64__)
+	#include <x86intrin.h>
+#endif
+
+// 渲染器的计数器和分阶段计时，编译期开关：定义 RT_PROFILE=1 (premake --profile) 时才生效，
+// 否则下面的宏全部展开为空，热路径上不留任何代码。
+// 每个线程写自己的 ThreadData (各占缓存行)，帧末 tile 全部完成后由调用 Render 的线程汇总，不需要加锁
+#ifndef RT_PROFILE
+	#define RT_PROFILE 0
+#endif
+
+enum class ProfileCounter : uint32_t
+{
+	SphereTests,    // 球体求交次数
+	TriangleTests,  // 三角形求交次数
+	TraversalSteps, // BVH 访问的节点数
+	Count
+};
+
+// 互不嵌套的阶段，时间为所有线程之和
+enum class ProfileStage : uint32_t
+{
+	Intersect,  // 最近交点
+	Shade,      // 材质和光源采样
+	Shadow,     // 阴影光线
+	Sky,        // 未命中的天空光
+	Accumulate, // 累积和显示缓冲
+	Denoise,
+	Upload,     // 交给 ImageSink
+	Count
+};
+
+struct ProfileFrameStats
+{
+	uint64_t counters[(size_t)ProfileCounter::Count] = {};
+	double stageMs[(size_t)ProfileStage::Count] = {};
+	double frameMs = 0.0; // 墙钟时间
+};
+
+class Profiler
+{
+public:
+	static constexpr bool Enabled = RT_PROFILE != 0;
+
+	struct TraceEvent
+	{
+		const char* name;
+		uint64_t start, end; // Now() 的读数
+		uint32_t arg0, arg1;
+	};
+
+	struct alignas(64) ThreadData
+	{
+		uint64_t counters[(size_t)ProfileCounter::Count];
+		uint64_t stageTicks[(size_t)ProfileStage::Count];
+		std::vector<TraceEvent> events; // 只在录制时追加
+		bool capturing = false;
+	};
+
+	// x64 上为 TSC，每帧用墙钟校准换算成毫秒
+	static uint64_t Now()
+	{
+#if defined(_M_X64) || defined(__x86_64__)
+		return __rdtsc();
+#else
+		return (uint64_t)std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+	}
+
+	static const char* GetCounterName(ProfileCounter counter);
+	static const char* GetStageName(ProfileStage stage);
+
+	// 清零 threadCount 个线程的数据，调用线程 (0 号 worker) 绑定到第一份
+	void BeginFrame(uint32_t threadCount);
+	void EndFrame();
+
+	ThreadData& GetThread(uint32_t workerIndex) { return m_Threads[workerIndex]; }
+	static void BindThread(ThreadData* data) { s_CurrentThread = data; }
+	static ThreadData* GetCurrentThread() { return s_CurrentThread; }
+
+	const ProfileFrameStats& GetFrameStats() const { return m_FrameStats; }
+	double TicksToMs(uint64_t ticks) const { return (double)ticks * m_MsPerTick; }
+
+	// 录制接下来 frameCount 帧的 tile 和阶段事件，完成后 IsCaptureComplete 为 true
+	void StartCapture(uint32_t frameCount);
+	bool IsCapturing() const { return m_CaptureFramesLeft > 0; }
+	bool IsCaptureComplete() const { return m_CaptureFramesLeft == 0 && !m_CapturedEvents.empty(); }
+	// Chrome / Perfetto 的 JSON trace 格式 (chrome://tracing、ui.perfetto.dev)
+	bool WriteTrace(const std::string& path) const;
+	void ClearCapture() { m_CapturedEvents.clear(); }
+
+private:
+	struct CapturedEvent
+	{
+		const char* name;
+		uint32_t thread;
+		double startUs, durationUs;
+		uint32_t arg0, arg1;
+		int counter; // >= 0 时为阶段耗时的计数器事件
+		double value;
+	};
+
+	static thread_local ThreadData* s_CurrentThread;
+
+	std::vector<ThreadData> m_Threads;
+	uint32_t m_ThreadCount = 0;
+	ProfileFrameStats m_FrameStats;
+
+	uint64_t m_FrameStartTicks = 0;
+	std::chrono::steady_clock::time_point m_FrameStartTime;
+	double m_MsPerTick = 0.0;
+
+	uint32_t m_CaptureFramesLeft = 0;
+	std::chrono::steady_clock::time_point m_CaptureStartTime;
+	std::vector<CapturedEvent> m_CapturedEvents;
+};
+
+// 把作用域内的时间计入当前线程的一个阶段
+class ProfileStageScope
+{
+public:
+	explicit ProfileStageScope(ProfileStage stage) : m_Stage(stage), m_Start(Profiler::Now()) {}
+	~ProfileStageScope()
+	{
+		if (Profiler::ThreadData* thread = Profiler::GetCurrentThread())
+			thread->stageTicks[(size_t)m_Stage] += Profiler::Now() - m_Start;
+	}
+
+private:
+	ProfileStage m_Stage;
+	uint64_t m_Start;
+};
+
+// 录制时把作用域记为 trace 中的一段
+class ProfileEventScope
+{
+public:
+	ProfileEventScope(const char* name, uint32_t arg0 = 0, uint32_t arg1 = 0)
+		: m_Name(name), m_Arg0(arg0), m_Arg1(arg1), m_Start(Profiler::Now()) {}
+	~ProfileEventScope()
+	{
+		Profiler::ThreadData* thread = Profiler::GetCurrentThread();
+		if (thread && thread->capturing)
+			thread->events.push_back({ m_Name, m_Start, Profiler::Now(), m_Arg0, m_Arg1 });
+	}
+
+private:
+	const char* m_Name;
+	uint32_t m_Arg0, m_Arg1;
+	uint64_t m_Start;
+};
+
+#if RT_PROFILE
+	#define RT_PROFILE_CONCAT_INNER(a, b) a##b
+	#define RT_PROFILE_CONCAT(a, b) RT_PROFILE_CONCAT_INNER(a, b)
+	#define RT_PROFILE_COUNT(counter, n) \
+		do { if (Profiler::ThreadData* profileThread = Profiler::GetCurrentThread()) \
+			profileThread->counters[(size_t)ProfileCounter::counter] += (n); } while (0)
+	#define RT_PROFILE_STAGE(stage) ProfileStageScope RT_PROFILE_CONCAT(profileStage, __LINE__)(ProfileStage::stage)
+	#define RT_PROFILE_EVENT(...) ProfileEventScope RT_PROFILE_CONCAT(profileEvent, __LINE__)(__VA_ARGS__)
+	#define RT_PROFILE_BIND_THREAD(profiler, workerIndex) Profiler::BindThread(&(profiler).GetThread(workerIndex))
+	#define RT_PROFILE_BEGIN_FRAME(profiler, threadCount) (profiler).BeginFrame(threadCount)
+	#define RT_PROFILE_END_FRAME(profiler) (profiler).EndFrame()
+#else
+	#define RT_PROFILE_COUNT(counter, n) ((void)0)
+	#define RT_PROFILE_STAGE(stage) ((void)0)
+	#define RT_PROFILE_EVENT(...) ((void)0)
+	#define RT_PROFILE_BIND_THREAD(profiler, workerIndex) ((void)0)
+	#define RT_PROFILE_BEGIN_FRAME(profiler, threadCount) ((void)0)
+	#define RT_PROFILE_END_FRAME(profiler) ((void)0)
+#endif
@@ -0,0 +1,36 @@
+﻿#pragma once
+
+#include <glm/glm.hpp>
+#include <cstdint>
+
+namespace Utils {
+
+	inline uint32_t PCG_Hash(uint32_t input)
+	{
+		uint32_t state = input * 747796405u + 2891336453u;
+		uint32_t word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+		return (word >> 22u) ^ word;
+	}
+
+	// 每个 (像素, 帧, 样本) 一条独立的随机流，与线程调度和时间无关，结果可复现
+	inline uint32_t InitSeed(uint32_t pixelIndex, uint32_t frameIndex, uint32_t sampleIndex, uint32_t baseSeed)
+	{
+		return PCG_Hash(pixelIndex ^ PCG_Hash(frameIndex ^ PCG_Hash(sampleIndex ^ PCG_Hash(baseSeed))));
+	}
+
+	// [0, 1)，取高 24 位避免舍入到 1.0
+	inline float RandomFloat(uint32_t& seed)
+	{
+		seed = PCG_Hash(seed);
+		return (float)(seed >> 8) * (1.0f / 16777216.0f);
+	}
+
+	inline glm::vec3 RandomVec3(uint32_t& seed, float min, float max)
+	{
+		return glm::vec3(
+			RandomFloat(seed) * (max - min) + min,
+			RandomFloat(seed) * (max - min) + min,
+			RandomFloat(seed) * (max - min) + min);
+	}
+
+}
@@ -0,0 +1,214 @@
+﻿#include "RenderThread.h"
+
+#include <chrono>
+
+RenderThread::RenderThread(const Camera& camera)
+	: m_PendingCamera(camera), m_Camera(camera)
+{
+	m_Renderer.SetCancelToken(&m_Cancel);
+	m_Thread = std::thread(&RenderThread::ThreadLoop, this);
+}
+
+RenderThread::~RenderThread()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Stop = true;
+	}
+	m_Cancel = true;
+	m_Condition.notify_all();
+	m_Thread.join();
+}
+
+void RenderThread::Submit(const Request& request, const Camera& camera)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	m_PendingRequest = request;
+	m_PendingCamera = camera;
+	if (request.restart)
+	{
+		m_PendingRestart = true;
+		CancelRefinement();
+	}
+	if (request.renderOnce)
+		m_FrameRequested = true;
+	m_Condition.notify_one();
+}
+
+void RenderThread::SubmitScene(Scene& scene, bool replace)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	if (replace)
+	{
+		m_PendingScene = scene;
+		scene.ClearEdits();
+		m_SceneReplaced = true;
+	}
+	else
+	{
+		scene.TransferEdits(m_PendingScene);
+	}
+	m_PendingSceneVersion++;
+	m_PendingRestart = true;
+	CancelRefinement();
+	m_Condition.notify_one();
+}
+
+void RenderThread::Post(Task task)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	m_Tasks.push_back(std::move(task));
+	m_Condition.notify_one();
+}
+
+void RenderThread::CaptureTrace(uint32_t frameCount, const std::string& path)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	m_TraceFrames = frameCount;
+	m_TracePath = path;
+}
+
+void RenderThread::CancelRefinement()
+{
+	// 交互帧分辨率低、很快完成，让它显示出来；作废它只会让 FrameBudget 永远等不到一帧
+	if (!m_FrameInteracting)
+		m_Cancel = true;
+}
+
+bool RenderThread::Present(ImageSink& sink, FrameStats& stats)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	if (!m_FrontFrameNew)
+		return false;
+	sink.OnResize(m_FrontFrame.stats.width, m_FrontFrame.stats.height);
+	sink.SetData(m_FrontFrame.pixels.data());
+	stats = m_FrontFrame.stats;
+	m_FrontFrameNew = false;
+	return true;
+}
+
+void RenderThread::ThreadLoop()
+{
+	while (true)
+	{
+		std::vector<Task> tasks;
+		bool restart = false, render = false;
+		{
+			std::unique_lock<std::mutex> lock(m_Mutex);
+			m_Condition.wait(lock, [this]
+			{
+				return m_Stop || !m_Tasks.empty() || m_PendingRequest.continuous || m_FrameRequested;
+			});
+			if (m_Stop)
+				return;
+
+			// 取走待处理的状态，之后的提交才会取消本帧
+			if (m_SceneReplaced)
+			{
+				m_Scene = m_PendingScene;
+				m_PendingScene.ClearEdits();
+				m_SceneReplaced = false;
+			}
+			else if (m_SceneVersion != m_PendingSceneVersion)
+			{
+				m_PendingScene.TransferEdits(m_Scene);
+			}
+			m_SceneVersion = m_PendingSceneVersion;
+			m_Request = m_PendingRequest;
+			m_Camera = m_PendingCamera;
+			restart = m_PendingRestart;
+			m_PendingRestart = false;
+			render = m_Request.continuous || m_FrameRequested;
+			m_FrameRequested = false;
+			m_FrameInteracting = render && m_Request.interacting;
+			m_Cancel = false;
+			tasks.swap(m_Tasks);
+
+			if (m_TraceFrames > 0)
+			{
+				m_Renderer.GetProfiler().StartCapture(m_TraceFrames);
+				m_ActiveTracePath = m_TracePath;
+				m_TraceFrames = 0;
+			}
+		}
+
+		// 任务看到的是本帧将要渲染的场景
+		for (Task& task : tasks)
+			task(m_Scene, m_Camera);
+		if (restart)
+			m_Renderer.ResetFrameCount();
+		if (!render)
+			continue;
+
+		m_Renderer.ApplySettings(m_Request.settings);
+		m_Renderer.GetDenoiser().ApplySettings(m_Request.denoise);
+
+		m_FrameBudget.m_Enabled = m_Request.frameBudget;
+		m_FrameBudget.m_TargetFrameTime = m_Request.targetFrameTime;
+		m_FrameBudget.m_MinScale = m_Request.minScale;
+		m_Plan = m_FrameBudget.PlanFrame(m_Request.viewportWidth, m_Request.viewportHeight, m_Request.settings.m_NumRays,
+			m_Request.interacting, m_Request.shadingOnly, m_Renderer.GetFrameCount() == 1);
+		if (m_Plan.width == 0 || m_Plan.height == 0)
+			continue;
+		m_Camera.OnResize(m_Plan.width, m_Plan.height);
+		m_Renderer.OnResize(m_Plan.width, m_Plan.height);
+		m_Renderer.m_NumRays = m_Plan.samplesPerPixel;
+
+		auto start = std::chrono::steady_clock::now();
+		bool completed = m_Renderer.Render(m_Scene, m_Camera);
+		float renderTime = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+		Profiler& profiler = m_Renderer.GetProfiler();
+		if (profiler.IsCaptureComplete())
+		{
+			profiler.WriteTrace(m_ActiveTracePath);
+			profiler.ClearCapture();
+		}
+
+		if (!completed)
+		{
+			// 单帧渲染被打断时按新的状态重来
+			m_CancelledFrames++;
+			if (!m_Request.continuous)
+			{
+				std::lock_guard<std::mutex> lock(m_Mutex);
+				m_FrameRequested = true;
+			}
+			continue;
+		}
+		m_FrameBudget.OnFrameRendered(renderTime);
+		PublishFrame(renderTime);
+	}
+}
+
+void RenderThread::PublishFrame(float renderTime)
+{
+	uint32_t width = m_Renderer.GetWidth(), height = m_Renderer.GetHeight();
+	m_BackFrame.pixels.assign(m_Renderer.GetImageData(), m_Renderer.GetImageData() + (size_t)width * height);
+
+	FrameStats& stats = m_BackFrame.stats;
+	stats.width = width;
+	stats.height = height;
+	stats.plan = m_Plan;
+	stats.renderTime = renderTime;
+	stats.accumulatedFrames = m_Renderer.GetFrameCount() - 1;
+	stats.totalSamples = m_Renderer.GetTotalSampleCount();
+	stats.convergedPixels = m_Renderer.GetConvergedPixelCount();
+	stats.reusingPrimaryHits = m_Renderer.IsReusingPrimaryHits();
+	stats.denoiseTime = m_Renderer.GetDenoiser().GetDenoiseTime();
+	stats.rays = m_Renderer.GetRayCounts();
+	stats.profile = m_Renderer.GetProfiler().GetFrameStats();
+	stats.capturingTrace = m_Renderer.GetProfiler().IsCapturing();
+	stats.cancelledFrames = m_CancelledFrames;
+	stats.sphereBVHNodes = m_Scene.sphereBVH.GetNodeCount();
+	stats.sphereBVHBuildTime = m_Scene.sphereBVH.GetBuildTime();
+	stats.sphereBVHRefitTime = m_Scene.sphereBVH.GetRefitTime();
+	stats.instanceBVHBuildTime = m_Scene.instanceBVH.GetBuildTime();
+	stats.instanceBVHRefitTime = m_Scene.instanceBVH.GetRefitTime();
+	stats.pointLightCount = m_Scene.pointLightTree.GetLightCount();
+	stats.lightTreeBuildTime = m_Scene.pointLightTree.GetBuildTime();
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	std::swap(m_FrontFrame, m_BackFrame);
+	m_FrontFrameNew = true;
+}
@@ -0,0 +1,133 @@
+﻿#pragma once
+
+#include "Camera.h"
+#include "FrameBudget.h"
+#include "ImageSink.h"
+#include "Renderer.h"
+#include "Scene.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// 后台渲染线程：UI 线程提交场景修改、相机和参数，渲染线程在每帧开始时取走最新的一份，
+// 渲染到后缓冲，完成后与前缓冲交换；UI 线程只显示最近完成的一帧，不必等待渲染。
+// 新的提交要求重新累积 (相机移动、场景编辑) 时置位取消标志，正在渲染的全分辨率细化帧跳过剩余 tile 后作废；
+// 交互中的帧不取消，渲染完照常显示，下一帧再取最新的相机，否则连续拖动时一帧也显示不出来。
+// Renderer 和它看到的 Scene、Camera 只由渲染线程访问，两边只通过加锁的待处理状态交换数据
+class RenderThread
+{
+public:
+	// UI 线程每帧提交一份
+	struct Request
+	{
+		RenderSettings settings;  // m_NumRays 为每帧样本数，开启帧预算时为上限
+		DenoiseSettings denoise;
+		uint32_t viewportWidth = 0, viewportHeight = 0;
+		bool frameBudget = true;  // 见 FrameBudget
+		float targetFrameTime = 33.3f;
+		float minScale = 0.25f;
+		bool interacting = false; // 相机移动或正在编辑
+		bool shadingOnly = false; // 交互只改了着色 (材质、光源、渲染参数)，见 FrameBudget::PlanFrame
+		bool restart = false;     // 丢弃已累积的帧，正在渲染的帧作废
+		bool continuous = false;  // 连续渲染；否则只在 renderOnce 时渲染一帧
+		bool renderOnce = false;
+	};
+
+	// 最近完成的一帧的统计，和图像一起交换
+	struct FrameStats
+	{
+		uint32_t width = 0, height = 0;
+		FrameBudget::Plan plan;
+		float renderTime = 0.0f;       // 毫秒，不含等待
+		uint32_t accumulatedFrames = 0;
+		uint64_t totalSamples = 0;
+		uint32_t convergedPixels = 0;
+		bool reusingPrimaryHits = false;
+		float denoiseTime = 0.0f;
+		RayCounts rays;
+		ProfileFrameStats profile;
+		bool capturingTrace = false;
+		uint32_t cancelledFrames = 0;  // 启动以来作废的帧数
+
+		// 渲染线程那份场景的加速结构
+		uint32_t sphereBVHNodes = 0;
+		float sphereBVHBuildTime = 0.0f, sphereBVHRefitTime = 0.0f;
+		float instanceBVHBuildTime = 0.0f, instanceBVHRefitTime = 0.0f;
+		uint32_t pointLightCount = 0;
+		float lightTreeBuildTime = 0.0f;
+	};
+
+	// 在两帧之间于渲染线程上执行，可以读写渲染线程的场景
+	using Task = std::function<void(Scene& scene, const Camera& camera)>;
+
+	explicit RenderThread(const Camera& camera);
+	~RenderThread();
+
+	RenderThread(const RenderThread&) = delete;
+	RenderThread& operator=(const RenderThread&) = delete;
+
+	void Submit(const Request& request, const Camera& camera);
+	// 把 scene 上的修改交给渲染线程 (Scene::TransferEdits)；replace 为 true 时整个复制，用于加载了新场景
+	void SubmitScene(Scene& scene, bool replace = false);
+	void Post(Task task);
+	// 录制接下来 frameCount 帧并写入 path，只在定义 RT_PROFILE 编译时有效
+	void CaptureTrace(uint32_t frameCount, const std::string& path);
+
+	// 有新完成的帧时交给 sink 并返回 true；只在 UI 线程调用
+	bool Present(ImageSink& sink, FrameStats& stats);
+
+private:
+	struct Frame
+	{
+		std::vector<uint32_t> pixels;
+		FrameStats stats;
+	};
+
+	void ThreadLoop();
+	// 把渲染结果复制到后缓冲，再与前缓冲交换
+	void PublishFrame(float renderTime);
+	// 正在渲染的帧不是交互帧时取消它，调用时持有 m_Mutex
+	void CancelRefinement();
+
+private:
+	std::mutex m_Mutex;
+	std::condition_variable m_Condition;
+	bool m_Stop = false;
+	std::atomic<bool> m_Cancel{ false };
+
+	// 待处理的状态，受 m_Mutex 保护
+	Request m_PendingRequest;
+	Camera m_PendingCamera;
+	Scene m_PendingScene;
+	uint64_t m_PendingSceneVersion = 0;
+	bool m_SceneReplaced = false;
+	bool m_PendingRestart = true;
+	bool m_FrameRequested = false;
+	bool m_FrameInteracting = false; // 正在渲染的帧是交互帧
+	std::vector<Task> m_Tasks;
+	uint32_t m_TraceFrames = 0;
+	std::string m_TracePath;
+
+	// 交换的缓冲，受 m_Mutex 保护
+	Frame m_FrontFrame;
+	bool m_FrontFrameNew = false;
+
+	// 以下只由渲染线程访问
+	Renderer m_Renderer;
+	Scene m_Scene;
+	Camera m_Camera;
+	uint64_t m_SceneVersion = 0;
+	Request m_Request;
+	FrameBudget m_FrameBudget;
+	FrameBudget::Plan m_Plan;
+	Frame m_BackFrame;
+	uint32_t m_CancelledFrames = 0;
+	std::string m_ActiveTracePath;
+
+	std::thread m_Thread; // 最后构造
+};
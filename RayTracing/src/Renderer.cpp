@@ -1,7 +1,7 @@
 ﻿#include "Renderer.h"
+#include "Random.h"
 
-#include <execution>
-#include <chrono>
+#include <algorithm>
 
 namespace Utils {
 
@@ -15,227 +15,989 @@ namespace Utils {
 		return result;
 	}
 
-	static uint32_t GetTimeBasedSeed()
+	// 0 蓝 -> 0.5 绿 -> 1 红
+	static glm::vec4 HeatColor(float t)
 	{
-		auto now = std::chrono::high_resolution_clock::now();
-		return static_cast<uint32_t>(
-			std::chrono::duration_cast<std::chrono::nanoseconds>(
-				now.time_since_epoch()
-			).count()
-			);
+		t = glm::clamp(t, 0.0f, 1.0f);
+		if (t < 0.5f)
+			return glm::vec4(0.0f, t * 2.0f, 1.0f - t * 2.0f, 1.0f);
+		return glm::vec4(t * 2.0f - 1.0f, 2.0f - t * 2.0f, 0.0f, 1.0f);
 	}
 
-	static uint32_t PCG_Hash(uint32_t input)
+	static float Luminance(const glm::vec3& color)
 	{
-		uint32_t state = input * 747796405u + 2891336453u;
-		uint32_t word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
-		return (word >> 22u) ^ word;
+		return glm::dot(color, glm::vec3(0.2126f, 0.7152f, 0.0722f));
 	}
 
-	static float RandomFloat(uint32_t& seed)
+}
+
+namespace {
+
+	constexpr float Pi = 3.14159265f;
+
+	// 以单位向量 n 为 z 轴的正交基 (Duff et al. 2017)
+	void BuildBasis(const glm::vec3& n, glm::vec3& tangent, glm::vec3& bitangent)
+	{
+		float sign = n.z >= 0.0f ? 1.0f : -1.0f;
+		float a = -1.0f / (sign + n.z);
+		float b = n.x * n.y * a;
+		tangent = glm::vec3(1.0f + sign * n.x * n.x * a, sign * b, -sign * n.x);
+		bitangent = glm::vec3(b, sign + n.y * n.y * a, -n.y);
+	}
+
+	glm::vec3 ToWorld(const glm::vec3& local, const glm::vec3& n)
+	{
+		glm::vec3 tangent, bitangent;
+		BuildBasis(n, tangent, bitangent);
+		return local.x * tangent + local.y * bitangent + local.z * n;
+	}
+
+	// 余弦加权的半球采样，概率密度为 cos / π
+	glm::vec3 SampleCosineHemisphere(const glm::vec3& normal, float u1, float u2)
+	{
+		float r = glm::sqrt(u1), phi = 2.0f * Pi * u2;
+		return ToWorld(glm::vec3(r * glm::cos(phi), r * glm::sin(phi), glm::sqrt(glm::max(0.0f, 1.0f - u1))), normal);
+	}
+
+	float DistributionGGX(float NdotH, float alpha2)
+	{
+		float d = NdotH * NdotH * (alpha2 - 1.0f) + 1.0f;
+		return alpha2 / (Pi * d * d);
+	}
+
+	float SmithG1(float NdotX, float alpha2)
+	{
+		return 2.0f * NdotX / (NdotX + glm::sqrt(alpha2 + (1.0f - alpha2) * NdotX * NdotX));
+	}
+
+	// 按可见法线分布采样微表面法线 (Heitz 2018)，view 和返回值都在以宏观法线为 z 轴的局部空间
+	glm::vec3 SampleVisibleNormal(const glm::vec3& view, float alpha, float u1, float u2)
+	{
+		glm::vec3 vh = glm::normalize(glm::vec3(alpha * view.x, alpha * view.y, view.z));
+		float lengthSquared = vh.x * vh.x + vh.y * vh.y;
+		glm::vec3 t1 = lengthSquared > 0.0f ? glm::vec3(-vh.y, vh.x, 0.0f) / glm::sqrt(lengthSquared) : glm::vec3(1.0f, 0.0f, 0.0f);
+		glm::vec3 t2 = glm::cross(vh, t1);
+		float r = glm::sqrt(u1), phi = 2.0f * Pi * u2;
+		float p1 = r * glm::cos(phi), p2 = r * glm::sin(phi);
+		float s = 0.5f * (1.0f + vh.z);
+		p2 = (1.0f - s) * glm::sqrt(glm::max(0.0f, 1.0f - p1 * p1)) + s * p2;
+		glm::vec3 nh = p1 * t1 + p2 * t2 + glm::sqrt(glm::max(0.0f, 1.0f - p1 * p1 - p2 * p2)) * vh;
+		return glm::normalize(glm::vec3(alpha * nh.x, alpha * nh.y, glm::max(0.0f, nh.z)));
+	}
+
+	// 球体对某点所张圆锥的 1 - cos(θmax)，小张角时避免相减抵消；点在球内时为 0
+	float ConeSolidAngleFactor(float distance2, float radius2)
 	{
-		seed = PCG_Hash(seed);
-		return static_cast<float>(seed) / (static_cast<float>(std::numeric_limits<uint32_t>::max()) + 1.0f);
+		if (distance2 <= radius2)
+			return 0.0f;
+		float sin2 = radius2 / distance2;
+		return sin2 / (1.0f + glm::sqrt(1.0f - sin2));
 	}
 
-	static glm::vec3 RandomVec3(uint32_t& seed, float min, float max)
+	// β = 2 的幂启发式
+	float PowerHeuristic(float pdf, float otherPdf)
 	{
-		return glm::vec3(
-			RandomFloat(seed) * (max - min) + min,
-			RandomFloat(seed) * (max - min) + min,
-			RandomFloat(seed) * (max - min) + min);
+		float a = pdf * pdf, b = otherPdf * otherPdf;
+		return a / (a + b);
 	}
 
-	static glm::vec3 InUnitSphere(uint32_t& seed)
+	// 选择发光球体的权重，正比于球体发出的总功率
+	float SphereLightPower(const glm::vec3& emission, float radius2)
 	{
-		return glm::normalize(glm::vec3(
-			RandomFloat(seed) * 2.0f - 1.0f,
-			RandomFloat(seed) * 2.0f - 1.0f,
-			RandomFloat(seed) * 2.0f - 1.0f));
+		return Utils::Luminance(emission) * radius2;
 	}
 
 }
 
-void Renderer::Render(Scene& scene, Camera& camera)
+bool Renderer::Render(Scene& scene, Camera& camera)
 {
+	RT_PROFILE_BEGIN_FRAME(m_Profiler, m_Scheduler.GetThreadCount());
 	m_Scene = &scene;
 	m_Camera = &camera;
-	std::for_each(std::execution::par, m_ImageVerticalIter.begin(), m_ImageVerticalIter.end(),
-		[this](uint32_t y)
+	{
+		RT_PROFILE_EVENT("UpdateBVH");
+		scene.UpdateBVH();
+		scene.UpdateLightTree();
+	}
+	UpdateShadingMaterials(scene);
+	UpdateSphereLights(scene);
+
+	const Tile region = GetRegion();
+	uint32_t regionWidth = region.x1 - region.x0, regionHeight = region.y1 - region.y0;
+	if (m_FrameCount == 1)
+	{
+		m_PixelStats.resize(m_Width * m_Height);
+		for (uint32_t y = region.y0; y < region.y1; y++)
+		{
+			uint32_t row = region.x0 + y * m_Width;
+			std::fill_n(m_AccumulationData + row, regionWidth, glm::vec4(0.0f));
+			std::fill_n(m_AlbedoDepthData.begin() + row, regionWidth, glm::vec4(0.0f));
+			std::fill_n(m_NormalData.begin() + row, regionWidth, glm::vec4(0.0f));
+			std::fill_n(m_PixelStats.begin() + row, regionWidth, PixelStats());
+		}
+		m_TotalSamples = 0;
+	}
+	if (m_Adaptive)
+		PlanAdaptiveSamples();
+	else
+		m_TotalSamples += (uint64_t)m_NumRays * regionWidth * regionHeight;
+
+	UpdatePrimaryHitCache(scene, camera);
+
+	if (m_WavefrontQueues.size() < m_Scheduler.GetThreadCount())
+		m_WavefrontQueues.resize(m_Scheduler.GetThreadCount());
+	m_WorkerRayCounts.assign(m_Scheduler.GetThreadCount(), WorkerRayCounts());
+
+	m_Scheduler.Run(regionWidth, regionHeight,
+		[this, &region](const Tile& regionTile, uint32_t workerIndex)
 		{
-			std::for_each(std::execution::par, m_ImageHorizontalIter.begin(), m_ImageHorizontalIter.end(),
-				[this, y](uint32_t x)
+			if (m_CancelToken && m_CancelToken->load(std::memory_order_relaxed))
+				return;
+			const Tile tile = { regionTile.x0 + region.x0, regionTile.y0 + region.y0,
+				regionTile.x1 + region.x0, regionTile.y1 + region.y0 };
+			RT_PROFILE_BIND_THREAD(m_Profiler, workerIndex);
+			RT_PROFILE_EVENT("Tile", tile.x0, tile.y0);
+			RayCounts& rays = m_WorkerRayCounts[workerIndex].rays;
+			if (m_Mode == RenderMode::Wavefront)
+			{
+#if RT_PROFILE
+				uint64_t tileStart = Profiler::Now();
+#endif
+				RenderTileWavefront(tile, m_WavefrontQueues[workerIndex], rays);
+#if RT_PROFILE
+				// 路径在 tile 内一起推进，只能按 tile 平均
+				float pixelCost = (float)(Profiler::Now() - tileStart) / (float)((tile.x1 - tile.x0) * (tile.y1 - tile.y0));
+				for (uint32_t y = tile.y0; y < tile.y1; y++)
+					std::fill_n(m_PixelCost.begin() + tile.x0 + y * m_Width, tile.x1 - tile.x0, pixelCost);
+#endif
+				return;
+			}
+
+			for (uint32_t y = tile.y0; y < tile.y1; y++)
+			{
+				for (uint32_t x = tile.x0; x < tile.x1; x++)
 				{
-					glm::vec4 color = PerPixel(x, y);
-					uint32_t idx = x + y * m_FinalImage->GetWidth();
-					m_ImageData[idx] = Utils::ConvertToRGBA(color);
-				});
+					uint32_t index = x + y * m_Width;
+					uint32_t samples = GetPixelSampleCount(index);
+					if (samples == 0)
+					{
+#if RT_PROFILE
+						m_PixelCost[index] = 0.0f;
+#endif
+						UpdateDisplayPixel(index);
+						continue;
+					}
+#if RT_PROFILE
+					uint64_t pixelStart = Profiler::Now();
+#endif
+					AuxiliarySample aux;
+					glm::vec3 color = PerPixel(x, y, samples, aux, rays);
+					AccumulatePixel(index, color, aux, samples);
+#if RT_PROFILE
+					m_PixelCost[index] = (float)(Profiler::Now() - pixelStart);
+#endif
+				}
+			}
 		});
-	m_FinalImage->SetData(m_ImageData);
+	if (m_CancelToken && m_CancelToken->load())
+	{
+		// 部分 tile 已经写入累积缓冲，整帧作废；写了一半的主光线缓存保持无效
+		RT_PROFILE_END_FRAME(m_Profiler);
+		m_FrameCount = 1;
+		return false;
+	}
+	if (m_PrimaryHitMode == PrimaryHitMode::Write)
+		m_PrimaryHitCache.valid = true;
+	m_RayCounts = RayCounts();
+	for (const WorkerRayCounts& worker : m_WorkerRayCounts)
+	{
+		m_RayCounts.primary += worker.rays.primary;
+		m_RayCounts.secondary += worker.rays.secondary;
+		m_RayCounts.shadow += worker.rays.shadow;
+	}
+
+#if RT_PROFILE
+	if (m_ShowPixelCost && !m_ShowSampleCounts)
+		ShowPixelCost();
+#endif
+
+	m_Denoised = m_Denoise && !m_ShowSampleCounts && !m_ShowPixelCost;
+	if (m_Denoised)
+		Denoise();
+	if (m_ImageSink)
+	{
+		RT_PROFILE_EVENT("Upload");
+		RT_PROFILE_STAGE(Upload);
+		m_ImageSink->SetData(m_ImageData);
+	}
+	RT_PROFILE_END_FRAME(m_Profiler);
+
+	if (m_Accumulate)
+		m_FrameCount++;
+	else
+		m_FrameCount = 1;
+	return true;
 }
 
 void Renderer::OnResize(uint32_t width, uint32_t height)
 {
-	if (m_FinalImage)
+	if (m_ImageData && width == m_Width && height == m_Height)
+		return;
+	m_Width = width;
+	m_Height = height;
+	if (m_ImageSink)
+		m_ImageSink->OnResize(width, height);
+
+	delete[] m_ImageData;
+	m_ImageData = new uint32_t[width * height];
+
+	delete[] m_AccumulationData;
+	m_AccumulationData = new glm::vec4[width * height];
+	m_AlbedoDepthData.resize(width * height);
+	m_NormalData.resize(width * height);
+	m_HasRegion = false;
+	if (Profiler::Enabled)
+		m_PixelCost.resize(width * height);
+	m_FrameCount = 1;
+}
+
+void Renderer::SaveAccumulation(AccumulationState& state) const
+{
+	uint32_t pixelCount = m_Width * m_Height;
+	state.width = m_Width;
+	state.height = m_Height;
+	state.frameCount = m_FrameCount;
+	state.totalSamples = m_TotalSamples;
+	state.accumulation.assign(m_AccumulationData, m_AccumulationData + pixelCount);
+	state.albedoDepth = m_AlbedoDepthData;
+	state.normal = m_NormalData;
+	// 第一帧之前还没有统计
+	state.pixelStats = m_PixelStats;
+	state.pixelStats.resize(pixelCount);
+}
+
+bool Renderer::LoadAccumulation(const AccumulationState& state)
+{
+	uint32_t pixelCount = m_Width * m_Height;
+	if (state.width != m_Width || state.height != m_Height || state.frameCount == 0 ||
+		state.accumulation.size() != pixelCount || state.albedoDepth.size() != pixelCount ||
+		state.normal.size() != pixelCount || state.pixelStats.size() != pixelCount)
+		return false;
+	std::copy(state.accumulation.begin(), state.accumulation.end(), m_AccumulationData);
+	m_AlbedoDepthData = state.albedoDepth;
+	m_NormalData = state.normal;
+	m_PixelStats = state.pixelStats;
+	m_TotalSamples = state.totalSamples;
+	// 显示缓冲在下一帧重新生成
+	m_FrameCount = state.frameCount;
+	return true;
+}
+
+void Renderer::SetImageSink(std::shared_ptr<ImageSink> sink)
+{
+	m_ImageSink = sink;
+	if (m_ImageSink && m_ImageData)
+		m_ImageSink->OnResize(m_Width, m_Height);
+}
+
+void Renderer::AccumulatePixel(uint32_t index, const glm::vec3& color, const AuxiliarySample& aux, uint32_t samples)
+{
+	RT_PROFILE_STAGE(Accumulate);
+	// 累积不截断的 HDR 亮度，只在转换为 RGBA 显示时截断到 [0, 1]，轮盘赌和 MIS 放大的样本不会被削掉
+	// 一帧 m_NumRays 个样本的权重为 1，非自适应时与按帧平均相同
+	float weight = (float)samples / (float)m_NumRays;
+	m_AccumulationData[index] += glm::vec4(color * weight, weight);
+	m_AlbedoDepthData[index] += glm::vec4(aux.albedo, aux.depth) * weight;
+	m_NormalData[index] += glm::vec4(aux.normal, 0.0f) * weight;
+	UpdateDisplayPixel(index);
+}
+
+void Renderer::UpdateDisplayPixel(uint32_t index)
+{
+	if (m_ShowSampleCounts)
 	{
-		if (width == m_FinalImage->GetWidth() && height == m_FinalImage->GetHeight())
-			return;
-		m_FinalImage->Resize(width, height);
+		// 相对均匀采样的样本数，m_AdaptiveMaxBoost 倍为红
+		float uniformSamples = (float)(m_FrameCount * m_NumRays);
+		m_ImageData[index] = Utils::ConvertToRGBA(Utils::HeatColor(
+			(float)m_PixelStats[index].samples / (uniformSamples * (float)m_AdaptiveMaxBoost)));
+		return;
 	}
-	else
+
+	const glm::vec4& accumulated = m_AccumulationData[index];
+	glm::vec4 accumulatedColor = accumulated / accumulated.w;
+	accumulatedColor = glm::clamp(accumulatedColor, glm::vec4(0.0f), glm::vec4(1.0f));
+	m_ImageData[index] = Utils::ConvertToRGBA(accumulatedColor);
+}
+
+void Renderer::ShowPixelCost()
+{
+	// 平均耗时为绿，两倍及以上为红
+	uint32_t pixelCount = m_Width * m_Height;
+	double totalCost = 0.0;
+	for (uint32_t i = 0; i < pixelCount; i++)
+		totalCost += m_PixelCost[i];
+	float scale = totalCost > 0.0 ? (float)(pixelCount / (2.0 * totalCost)) : 0.0f;
+	for (uint32_t i = 0; i < pixelCount; i++)
+		m_ImageData[i] = Utils::ConvertToRGBA(Utils::HeatColor(m_PixelCost[i] * scale));
+}
+
+void Renderer::RecordSample(uint32_t index, const glm::vec3& color)
+{
+	// 与累积缓冲一样记录未截断的 HDR 亮度，否则超过 1 的像素方差为 0，
+	// 自适应采样会把它们当作已收敛，降噪器也不会过滤它们
+	PixelStats& stats = m_PixelStats[index];
+	float luminance = Utils::Luminance(color);
+	stats.sum += luminance;
+	stats.sumSquares += luminance * luminance;
+	stats.samples++;
+}
+
+void Renderer::PlanAdaptiveSamples()
+{
+	uint32_t pixelCount = m_Width * m_Height;
+	m_FrameSamples.resize(pixelCount);
+	m_ConvergedPixels = 0;
+	if (m_FrameCount <= m_AdaptiveMinFrames)
 	{
-		m_FinalImage = std::make_shared<Walnut::Image>(width, height, Walnut::ImageFormat::RGBA);
+		std::fill(m_FrameSamples.begin(), m_FrameSamples.end(), (uint16_t)m_NumRays);
+		m_TotalSamples += (uint64_t)m_NumRays * pixelCount;
+		return;
+	}
+
+	// 均值的标准误差 sqrt(var / n)，亮度超过 1 的像素除以均值变成相对误差：
+	// 统计的是 HDR 亮度，显示时已饱和的亮像素否则几乎不会收敛，占掉大部分预算。低于阈值的像素记 0
+	std::vector<float>& errors = m_PixelError;
+	errors.resize(pixelCount);
+	double errorSum = 0.0;
+	for (uint32_t i = 0; i < pixelCount; i++)
+	{
+		const PixelStats& stats = m_PixelStats[i];
+		float n = (float)stats.samples;
+		float mean = stats.sum / n;
+		float variance = glm::max(0.0f, stats.sumSquares / n - mean * mean);
+		float error = glm::sqrt(variance / n) / glm::max(mean, 1.0f);
+		errors[i] = error < m_AdaptiveThreshold ? 0.0f : error;
+		errorSum += errors[i];
 	}
-	delete[] m_ImageData;
-	m_ImageData = new uint32_t[width * height];
 
-	m_ImageHorizontalIter.resize(width);
-	for (uint32_t i = 0; i < width; i++)
-		m_ImageHorizontalIter[i] = i;
-	m_ImageVerticalIter.resize(height);
-	for (uint32_t i = 0; i < height; i++)
-		m_ImageVerticalIter[i] = i;
+	double budget = (double)m_NumRays * pixelCount;
+	uint32_t maxSamples = std::min(m_NumRays * m_AdaptiveMaxBoost, (uint32_t)UINT16_MAX);
+	for (uint32_t i = 0; i < pixelCount; i++)
+	{
+		if (errors[i] == 0.0f)
+		{
+			m_FrameSamples[i] = 0;
+			m_ConvergedPixels++;
+			continue;
+		}
+		double share = budget * errors[i] / errorSum;
+		uint32_t samples = (uint32_t)std::min((double)maxSamples, std::max(1.0, share + 0.5));
+		m_FrameSamples[i] = (uint16_t)samples;
+		m_TotalSamples += samples;
+	}
 }
 
-glm::vec4 Renderer::PerPixel(uint32_t x, uint32_t y)
+float Renderer::GetPixelVariance(uint32_t index) const
 {
-	uint32_t idx = x + y * m_FinalImage->GetWidth();
-	Ray ray(m_Camera->GetPosition(), m_Camera->GetRayDirections()[idx]);
-	glm::vec4 color = glm::vec4(TraceRay(*m_Scene, ray), 1.0f);
-	return color;
+	// 像素均值的方差 var / n；样本太少时估计不可信，交给降噪器用邻域估计
+	const PixelStats& stats = m_PixelStats[index];
+	if (stats.samples < 4)
+		return -1.0f;
+	float n = (float)stats.samples;
+	float mean = stats.sum / n;
+	return glm::max(0.0f, stats.sumSquares / n - mean * mean) / n;
 }
 
-glm::vec3 Renderer::TraceRay(Scene& scene, Ray ray)
+void Renderer::Denoise()
 {
+	RT_PROFILE_EVENT("Denoise");
+	RT_PROFILE_STAGE(Denoise);
+	uint32_t pixelCount = m_Width * m_Height;
+	m_PixelVariance.resize(pixelCount);
+	m_DenoisedData.resize(pixelCount);
+
+	for (uint32_t i = 0; i < pixelCount; i++)
+		m_PixelVariance[i] = GetPixelVariance(i);
+
+	DenoiseInput input;
+	input.width = m_Width;
+	input.height = m_Height;
+	input.color = m_AccumulationData;
+	input.albedoDepth = m_AlbedoDepthData.data();
+	input.normal = m_NormalData.data();
+	input.variance = m_PixelVariance.data();
+	m_Denoiser.Denoise(input, m_DenoisedData.data(), m_Scheduler);
+
+	for (uint32_t i = 0; i < pixelCount; i++)
+		m_ImageData[i] = Utils::ConvertToRGBA(glm::clamp(m_DenoisedData[i], glm::vec4(0.0f), glm::vec4(1.0f)));
+}
+
+glm::vec3 Renderer::PerPixel(uint32_t x, uint32_t y, uint32_t samples, AuxiliarySample& aux, RayCounts& rays)
+{
+	return TraceRay(*m_Scene, x, y, samples, aux, rays);
+}
+
+glm::vec3 Renderer::TraceRay(Scene& scene, uint32_t x, uint32_t y, uint32_t samples, AuxiliarySample& aux, RayCounts& rays)
+{
+	uint32_t pixelIndex = x + y * m_Width;
 	glm::vec3 totalColor(0.0f);
-	for (uint32_t i = 1; i <= m_NumRays; i++)
+	aux = AuxiliarySample();
+	for (uint32_t i = 1; i <= samples; i++)
 	{
-		totalColor += TraceRayOnce(scene, ray);
+		uint32_t seed = Utils::InitSeed(pixelIndex, m_FrameCount, i, m_Seed);
+		AuxiliarySample sampleAux;
+		Ray ray = GeneratePrimaryRay(x, y, seed);
+		glm::vec3 color = TraceRayOnce(scene, ray, seed, rays, &sampleAux, GetPrimaryHitSlot(pixelIndex, i - 1));
+		RecordSample(pixelIndex, color);
+		totalColor += color;
+		aux.albedo += sampleAux.albedo;
+		aux.normal += sampleAux.normal;
+		aux.depth += sampleAux.depth;
 	}
-	totalColor /= m_NumRays;
-	totalColor = glm::clamp(totalColor, glm::vec3(0.0f), glm::vec3(1.0f));
+	rays.primary += samples;
+	totalColor /= samples;
+	aux.albedo /= samples;
+	aux.normal /= samples;
+	aux.depth /= samples;
 	return totalColor;
 }
 
-glm::vec3 Renderer::TraceRayOnce(Scene& scene, Ray ray, uint32_t dep)
+Ray Renderer::GeneratePrimaryRay(uint32_t x, uint32_t y, uint32_t& seed) const
+{
+	// 不抖动时取像素左下角
+	float jitterX = 0.0f, jitterY = 0.0f;
+	if (m_JitterPrimaryRays)
+	{
+		jitterX = Utils::RandomFloat(seed);
+		jitterY = Utils::RandomFloat(seed);
+	}
+	return Ray(m_Camera->GetPosition(), m_Camera->GetRayDirection((float)x + jitterX, (float)y + jitterY));
+}
+
+glm::vec3 Renderer::TraceRayOnce(Scene& scene, Ray ray, uint32_t& seed, RayCounts& rays, AuxiliarySample* aux, PrimaryHit* primaryHit)
 {
-	if (dep >= m_MaxBounceCount)
-		return GetSkyLight(ray);
-	HitInfo hitInfo = CalculateRayCollision(scene, ray);
-	if (!hitInfo.didHit)
-		return GetSkyLight(ray);
+	// 显式累积路径权重，和 wavefront 版本的累加顺序一致
+	glm::vec3 radiance(0.0f);
+	glm::vec3 throughput(1.0f);
+	float bsdfPdf = 0.0f;
+	for (uint32_t depth = 0; depth < m_MaxBounceCount; depth++)
+	{
+		if (depth > 0)
+			rays.secondary++;
+		HitInfo hitInfo = depth == 0 && primaryHit ? FindPrimaryHit(scene, ray, *primaryHit) : CalculateRayCollision(scene, ray);
+		if (depth == 0 && aux)
+		{
+			if (hitInfo.didHit)
+			{
+				aux->albedo = scene.GetMaterial(hitInfo.materialID).albedo;
+				aux->normal = hitInfo.normal;
+				aux->depth = hitInfo.dist;
+			}
+			else
+				aux->albedo = glm::clamp(GetSkyLight(ray), glm::vec3(0.0f), glm::vec3(1.0f));
+		}
+		if (!hitInfo.didHit)
+			return radiance + throughput * GetSkyLight(ray);
+
+		SurfaceSample sample = ShadeHit(scene, ray, hitInfo, bsdfPdf, depth + 1 == m_MaxBounceCount, seed);
+		radiance += throughput * sample.emission;
 
-	uint32_t seed = Utils::GetTimeBasedSeed();
+		// 直接光照
+		rays.shadow += sample.shadowCount;
+		for (uint32_t i = 0; i < sample.shadowCount; i++)
+		{
+			const ShadowConnection& shadow = sample.shadows[i];
+			radiance += throughput * shadow.contribution * TraceShadowRay(scene, shadow.ray, shadow.maxDistance);
+		}
 
-	const Material& mat = scene.GetMaterial(hitInfo.materialID);
+		// 继续追踪反射光线
+		throughput *= sample.indirectWeight;
+		if (!ContinuePath(throughput, depth, seed))
+			return radiance;
+		ray = sample.nextRay;
+		bsdfPdf = sample.pdf;
+	}
 
-	// 直接光照
-	glm::vec3 directColor = CalculateDirectLight(scene, hitInfo, ray);
+	// 达到最大弹射次数
+	return radiance + throughput * GetSkyLight(ray);
+}
 
-	// 自发光
-	glm::vec3 totalColor = mat.GetEmission();
+bool Renderer::ContinuePath(glm::vec3& throughput, uint32_t depth, uint32_t& seed) const
+{
+	if (throughput == glm::vec3(0.0f))
+		return false;
+	// 下一次只剩天空光，不值得再抽一个随机数
+	if (!m_RussianRoulette || depth + 1 < m_RouletteStartBounce || depth + 1 >= m_MaxBounceCount)
+		return true;
 
-	// 计算反射光线
-	glm::vec3 reflectionDir = glm::reflect(ray.direction, hitInfo.normal);
-	reflectionDir = glm::normalize(reflectionDir);
+	// 以路径权重的最大分量为存活概率，存活的路径除以概率保持无偏
+	float survival = std::min(std::max(throughput.r, std::max(throughput.g, throughput.b)), 0.95f);
+	if (Utils::RandomFloat(seed) >= survival)
+		return false;
+	throughput /= survival;
+	return true;
+}
+
+void Renderer::UpdateShadingMaterials(const Scene& scene)
+{
+	// 展开成 ShadeKernelCount 个实例
+	static const ShadeKernel kernels[ShadeKernelCount] = {
+		&Renderer::ShadeHitKernel<0>, &Renderer::ShadeHitKernel<1>, &Renderer::ShadeHitKernel<2>, &Renderer::ShadeHitKernel<3>,
+		&Renderer::ShadeHitKernel<4>, &Renderer::ShadeHitKernel<5>, &Renderer::ShadeHitKernel<6>, &Renderer::ShadeHitKernel<7>,
+		&Renderer::ShadeHitKernel<8>, &Renderer::ShadeHitKernel<9>, &Renderer::ShadeHitKernel<10>, &Renderer::ShadeHitKernel<11>,
+		&Renderer::ShadeHitKernel<12>, &Renderer::ShadeHitKernel<13>, &Renderer::ShadeHitKernel<14>, &Renderer::ShadeHitKernel<15>,
+	};
 
-	// 添加粗糙度影响
-	if (mat.roughness > 0.0f)
+	m_ShadingMaterials.resize(scene.materials.size());
+	for (size_t i = 0; i < scene.materials.size(); i++)
 	{
-		// 使用余弦加权的半球采样，更符合物理
-		glm::vec3 randomDir = glm::normalize(Utils::RandomVec3(seed, -1.0f, 1.0f));
-		if (glm::dot(randomDir, hitInfo.normal) < 0.0f) randomDir = -randomDir;
+		const Material& material = scene.materials[i];
+		ShadingMaterial& mat = m_ShadingMaterials[i];
+		mat = ShadingMaterial();
+		mat.emission = material.GetEmission();
+		uint32_t flags = mat.emission != glm::vec3(0.0f) ? (uint32_t)ShadeEmissive : 0u;
+		if (m_JustDiffuse)
+			mat.diffuseColor = material.albedo;
+		else
+		{
+			mat.diffuseColor = material.albedo * (1.0f - material.metallic);
+			mat.reflectance = material.GetReflectance();
+			// 过小的 alpha 使 GGX 分布在浮点精度内退化
+			mat.alpha = glm::max(material.roughness * material.roughness, 1e-3f);
+			flags |= material.roughness > 0.0f ? ShadeGlossy : ShadeMirror;
+		}
+		if (mat.diffuseColor != glm::vec3(0.0f))
+			flags |= ShadeDiffuse;
+		mat.shade = kernels[flags];
+	}
+}
+
+void Renderer::UpdateSphereLights(const Scene& scene)
+{
+	m_SphereLights.clear();
+	bool emissive = false;
+	for (const ShadingMaterial& mat : m_ShadingMaterials)
+		emissive |= mat.emission != glm::vec3(0.0f);
+	if (!emissive)
+		return;
 
-		// 混合理想反射和随机方向
-		reflectionDir = glm::mix(reflectionDir, randomDir, mat.roughness);
-		reflectionDir = glm::normalize(reflectionDir);
+	const SphereSoA& soa = scene.sphereSoA;
+	float power = 0.0f;
+	for (uint32_t i = 0; i < soa.count; i++)
+	{
+		const glm::vec3& emission = m_ShadingMaterials[soa.materialID[i]].emission;
+		float lightPower = SphereLightPower(emission, soa.radius2[i]);
+		if (lightPower <= 0.0f)
+			continue;
+		power += lightPower;
+		m_SphereLights.push_back({ glm::vec3(soa.x[i], soa.y[i], soa.z[i]), soa.radius2[i], emission, power });
 	}
+}
+
+template<uint32_t Flags>
+SurfaceSample Renderer::ShadeHitKernel(Scene& scene, const Ray& ray, const HitInfo& hitInfo, const ShadingMaterial& mat,
+	float bsdfPdf, bool lastBounce, uint32_t& seed)
+{
+	RT_PROFILE_STAGE(Shade);
+	constexpr bool diffuse = (Flags & ShadeDiffuse) != 0;
+	constexpr bool glossy = (Flags & ShadeGlossy) != 0;
+	constexpr bool mirror = (Flags & ShadeMirror) != 0;
+	SurfaceSample sample;
 
-	// 生成新光线
-	Ray newRay;
-	newRay.origin = hitInfo.hitPoint + hitInfo.normal * 0.001f;
-	newRay.direction = reflectionDir;
+	// 自发光
+	if constexpr ((Flags & ShadeEmissive) != 0)
+		sample.emission = mat.emission * EmissionWeight(scene, ray, hitInfo, mat.emission, bsdfPdf);
 
-	// 菲涅尔效应
-	float cosTheta = glm::dot(glm::normalize(-ray.direction), hitInfo.normal);
-	glm::vec3 fresnel = mat.FresnelSchlick(cosTheta);
+	ShadingPoint point;
+	point.view = -glm::normalize(ray.direction);
+	point.normal = hitInfo.normal;
+	point.NdotV = glm::dot(point.normal, point.view);
+	if (point.NdotV < 0.0f)
+	{
+		// 从球体内部看到的面
+		point.normal = -point.normal;
+		point.NdotV = -point.NdotV;
+	}
+	point.NdotV = glm::max(point.NdotV, 1e-4f);
+	point.position = hitInfo.hitPoint + point.normal * 0.001f;
 
-	// 继续追踪反射光线
-	glm::vec3 indirectColor = TraceRayOnce(scene, newRay, dep + 1);
+	// 菲涅尔效应：镜面 lobe 反射的部分不再进入漫反射
+	point.fresnel = glm::vec3(0.0f);
+	if constexpr (glossy || mirror)
+		point.fresnel = Material::FresnelSchlick(mat.reflectance, point.NdotV);
+	point.diffuse = mat.diffuseColor * (glm::vec3(1.0f) - point.fresnel);
+	float specularWeight = glossy || mirror ? Utils::Luminance(point.fresnel) : 0.0f;
+	float diffuseWeight = diffuse ? Utils::Luminance(point.diffuse) : 0.0f;
+	if (specularWeight + diffuseWeight <= 0.0f)
+		return sample;
+	point.specularProbability = specularWeight / (specularWeight + diffuseWeight);
 
-	// 金属和非金属的不同处理
-	float metallicFactor = mat.metallic;
-	float diffuseFactor = (1.0f - metallicFactor) * (1.0f - fresnel.r);
-	float specularFactor = metallicFactor + (1.0f - metallicFactor) * fresnel.r;
+	// 理想镜面反射的方向是 δ 分布，光源采样不会命中
+	if constexpr (diffuse || glossy)
+		CalculateDirectLight<Flags>(scene, mat, point, lastBounce, seed, sample);
 
-	totalColor += mat.albedo * (directColor * diffuseFactor +
-		indirectColor * specularFactor);
+	// 按能量选一个 lobe 重要性采样反射方向
+	float lobe = diffuse && (glossy || mirror) ? Utils::RandomFloat(seed) : 0.0f;
+	glm::vec3 direction = point.normal;
+	if (lobe < point.specularProbability)
+	{
+		if constexpr (mirror)
+		{
+			sample.nextRay = Ray(point.position, glm::reflect(-point.view, point.normal));
+			sample.indirectWeight = point.fresnel / point.specularProbability;
+			return sample;
+		}
+		else if constexpr (glossy)
+		{
+			// 在以法线为 z 轴的局部空间按可见法线分布采样微表面法线，再关于它反射
+			glm::vec3 tangent, bitangent;
+			BuildBasis(point.normal, tangent, bitangent);
+			glm::vec3 localView(glm::dot(point.view, tangent), glm::dot(point.view, bitangent), point.NdotV);
+			float u1 = Utils::RandomFloat(seed), u2 = Utils::RandomFloat(seed);
+			glm::vec3 m = SampleVisibleNormal(localView, mat.alpha, u1, u2);
+			direction = glm::reflect(-point.view, m.x * tangent + m.y * bitangent + m.z * point.normal);
+		}
+	}
+	else
+	{
+		float u1 = Utils::RandomFloat(seed), u2 = Utils::RandomFloat(seed);
+		direction = SampleCosineHemisphere(point.normal, u1, u2);
+	}
 
-	return totalColor;
+	// 权重用两个 lobe 混合后的概率密度，采到地平线以下的方向时路径结束
+	float pdf;
+	glm::vec3 value = EvaluateBSDF<Flags>(mat, point, direction, pdf);
+	if (pdf <= 0.0f)
+		return sample;
+	sample.nextRay = Ray(point.position, direction);
+	sample.indirectWeight = value / pdf;
+	sample.pdf = pdf;
+	return sample;
 }
 
-glm::vec3 Renderer::CalculateDirectLight(Scene& scene, HitInfo& hitInfo, Ray& ray)
+template<uint32_t Flags>
+glm::vec3 Renderer::EvaluateBSDF(const ShadingMaterial& mat, const ShadingPoint& point, const glm::vec3& toLight, float& pdf) const
 {
-	const Material& mat = scene.GetMaterial(hitInfo.materialID);
-	const DirectionalLight& light = scene.directionalLight;
+	pdf = 0.0f;
+	float NdotL = glm::dot(point.normal, toLight);
+	if (NdotL <= 0.0f)
+		return glm::vec3(0.0f);
+
+	glm::vec3 value(0.0f);
+	if constexpr ((Flags & ShadeDiffuse) != 0)
+	{
+		value += point.diffuse * (NdotL / Pi);
+		pdf += (1.0f - point.specularProbability) * NdotL / Pi;
+	}
+	if constexpr ((Flags & ShadeGlossy) != 0)
+	{
+		// Smith 遮蔽取 G1(v) G1(l)：f * cos = D G1(v) G1(l) F / (4 n·v)，可见法线采样的概率密度为 D G1(v) / (4 n·v)
+		glm::vec3 halfDir = glm::normalize(point.view + toLight);
+		float alpha2 = mat.alpha * mat.alpha;
+		float specularPdf = DistributionGGX(glm::max(glm::dot(point.normal, halfDir), 0.0f), alpha2)
+			* SmithG1(point.NdotV, alpha2) / (4.0f * point.NdotV);
+		glm::vec3 fresnel = Material::FresnelSchlick(mat.reflectance, glm::max(glm::dot(point.view, halfDir), 0.0f));
+		value += fresnel * (specularPdf * SmithG1(NdotL, alpha2));
+		pdf += point.specularProbability * specularPdf;
+	}
+	return value;
+}
 
-	// 计算光照方向
-	glm::vec3 lightDir = glm::normalize(light.direction);
+template<uint32_t Flags>
+void Renderer::CalculateDirectLight(Scene& scene, const ShadingMaterial& mat, const ShadingPoint& point, bool lastBounce, uint32_t& seed,
+	SurfaceSample& sample)
+{
+	auto addShadow = [&](const glm::vec3& direction, float maxDistance, const glm::vec3& contribution)
+		{
+			ShadowConnection& shadow = sample.shadows[sample.shadowCount++];
+			shadow.ray = Ray(point.position, direction);
+			shadow.maxDistance = maxDistance;
+			shadow.contribution = contribution;
+		};
+	float bsdfPdf;
 
-	// 阴影测试
-	Ray shadowRay;
-	shadowRay.origin = hitInfo.hitPoint + hitInfo.normal * 0.001f;
-	shadowRay.direction = -lightDir;
+	// 定向光和点光源是 δ 光源，只能由光源采样得到，不需要 MIS
+	const DirectionalLight& light = scene.directionalLight;
+	glm::vec3 lightDir = -glm::normalize(light.direction);
+	glm::vec3 contribution = EvaluateBSDF<Flags>(mat, point, lightDir, bsdfPdf) * light.color * (light.intensity * Pi);
+	if (contribution != glm::vec3(0.0f))
+		addShadow(lightDir, FLT_MAX, contribution);
 
-	float visibility = 1.0f;
-	for (const Sphere& sphere : scene.spheres)
+	// 点光源：按估计贡献随机选灯，除以选中的概率保持无偏
+	const LightTree& lightTree = scene.pointLightTree;
+	if (!lightTree.IsEmpty())
 	{
-		HitInfo shadowHit = RaySphere(shadowRay, sphere);
-		if (shadowHit.didHit && shadowHit.dist > 0.001f)
+		uint32_t lightSamples = glm::clamp(m_LightSamples, 1u, SurfaceSample::MaxLightSamples);
+		for (uint32_t i = 0; i < lightSamples; i++)
 		{
-			visibility = 0.3f; // 部分阴影
-			break;
+			LightSample lightSample = lightTree.Sample(point.position, point.normal, Utils::RandomFloat(seed));
+			if (lightSample.pdf <= 0.0f)
+				continue;
+
+			const PointLight& pointLight = scene.pointLights[lightSample.lightIndex];
+			glm::vec3 toLight = pointLight.position - point.position;
+			float distance = glm::length(toLight);
+			toLight /= distance;
+			if (glm::dot(point.normal, toLight) <= 0.0f)
+				continue;
+
+			float intensity = pointLight.intensity * PointLight::Attenuation(distance, pointLight.range) * Pi;
+			contribution = EvaluateBSDF<Flags>(mat, point, toLight, bsdfPdf) * pointLight.color
+				* (intensity / (lightSample.pdf * (float)lightSamples));
+			if (contribution != glm::vec3(0.0f))
+				addShadow(toLight, distance, contribution);
 		}
 	}
 
-	// 漫反射计算
-	float NdotL = glm::max(0.0f, glm::dot(hitInfo.normal, -lightDir));
-	glm::vec3 diffuse = mat.albedo * NdotL * light.color * light.intensity * visibility;
+	// 发光球体：按功率选一个，在它所张的圆锥内均匀采样方向，与 BSDF 采样命中它的情况用幂启发式合并
+	if (m_SphereLights.empty())
+		return;
+	float u = Utils::RandomFloat(seed) * m_SphereLights.back().cdf;
+	auto selected = std::upper_bound(m_SphereLights.begin(), m_SphereLights.end(), u,
+		[](float value, const SphereLight& sphereLight) { return value < sphereLight.cdf; });
+	const SphereLight& sphereLight = selected == m_SphereLights.end() ? m_SphereLights.back() : *selected;
+	float u1 = Utils::RandomFloat(seed), u2 = Utils::RandomFloat(seed);
 
-	if (m_JustDiffuse)
-		return diffuse;
+	glm::vec3 toCenter = sphereLight.center - point.position;
+	float height = glm::dot(point.normal, toCenter);
+	if (height < 0.0f && height * height >= sphereLight.radius2)
+		return; // 整个球在地平线以下，包括着色点就在这个球上的情况
+	float distance2 = glm::dot(toCenter, toCenter);
+	float oneMinusCos = ConeSolidAngleFactor(distance2, sphereLight.radius2);
+	if (oneMinusCos <= 0.0f)
+		return;
+	float cosTheta = 1.0f - u1 * oneMinusCos;
+	float sin2Theta = u1 * oneMinusCos * (2.0f - u1 * oneMinusCos);
+	float sinTheta = glm::sqrt(sin2Theta), phi = 2.0f * Pi * u2;
+	float distance = glm::sqrt(distance2);
+	glm::vec3 toLight = ToWorld(glm::vec3(sinTheta * glm::cos(phi), sinTheta * glm::sin(phi), cosTheta), toCenter / distance);
 
-	// 镜面反射计算 - 使用半向量方法
-	glm::vec3 viewDir = glm::normalize(ray.origin - hitInfo.hitPoint);
-	glm::vec3 halfDir = glm::normalize(-lightDir + viewDir);
+	glm::vec3 value = EvaluateBSDF<Flags>(mat, point, toLight, bsdfPdf);
+	if (value == glm::vec3(0.0f))
+		return;
+	float lightPdf = SphereLightPdf(point.position, sphereLight.center, sphereLight.radius2, sphereLight.emission);
+	// 最后一次弹射之后不再有 BSDF 采样的光线命中光源，光源采样的权重取 1
+	float weight = lastBounce ? 1.0f : PowerHeuristic(lightPdf, bsdfPdf);
+	// 阴影光线停在球面之前
+	float hitDistance = distance * cosTheta - glm::sqrt(glm::max(0.0f, sphereLight.radius2 - distance2 * sin2Theta));
+	addShadow(toLight, hitDistance * 0.999f, value * sphereLight.emission * (weight / lightPdf));
+}
 
-	// 粗糙度影响
-	float roughness = glm::max(0.01f, mat.roughness);
-	float NdotH = glm::max(0.0f, glm::dot(hitInfo.normal, halfDir));
-	float specular = glm::pow(NdotH, 1.0f / roughness) * light.intensity;
+float Renderer::EmissionWeight(const Scene& scene, const Ray& ray, const HitInfo& hit, const glm::vec3& emission, float bsdfPdf) const
+{
+	// 主光线、镜面反射和三角形上的自发光只能由 BSDF 采样得到
+	if (bsdfPdf <= 0.0f || m_SphereLights.empty() || (hit.primitive & Scene::TrianglePrimitiveBit))
+		return 1.0f;
+	const SphereSoA& soa = scene.sphereSoA;
+	uint32_t i = hit.primitive;
+	float lightPdf = SphereLightPdf(ray.origin, glm::vec3(soa.x[i], soa.y[i], soa.z[i]), soa.radius2[i], emission);
+	return PowerHeuristic(bsdfPdf, lightPdf);
+}
 
-	// 金属和非金属不同的高光颜色
-	glm::vec3 specularColor = mat.metallic > 0.5f ? mat.albedo : glm::vec3(0.8f);
+float Renderer::SphereLightPdf(const glm::vec3& position, const glm::vec3& center, float radius2, const glm::vec3& emission) const
+{
+	glm::vec3 toCenter = center - position;
+	float oneMinusCos = ConeSolidAngleFactor(glm::dot(toCenter, toCenter), radius2);
+	if (oneMinusCos <= 0.0f)
+		return 0.0f;
+	return SphereLightPower(emission, radius2) / m_SphereLights.back().cdf / (2.0f * Pi * oneMinusCos);
+}
 
-	return diffuse + specularColor * specular * visibility;
+float Renderer::TraceShadowRay(Scene& scene, const Ray& shadowRay, float maxDistance)
+{
+	RT_PROFILE_STAGE(Shadow);
+	bool occluded = scene.sphereBVH.TraverseAny(shadowRay.origin, shadowRay.direction, maxDistance,
+		[&](uint32_t first, uint32_t count, float tMax)
+		{
+			RT_PROFILE_COUNT(SphereTests, count);
+			return scene.sphereSoA.IntersectAny(first, count, shadowRay.origin, shadowRay.direction, 0.001f, tMax);
+		});
+	// 顶层 BVH 找到实例后把光线变换到物体空间再遍历 BLAS；方向不归一化，t 在两个空间中相同
+	const Buffer<uint32_t>& instanceOrder = scene.instanceBVH.GetPrimitiveIndices();
+	occluded = occluded || scene.instanceBVH.TraverseAny(shadowRay.origin, shadowRay.direction, maxDistance,
+		[&](uint32_t first, uint32_t count, float tMax)
+		{
+			for (uint32_t i = first; i < first + count; i++)
+			{
+				uint32_t instance = instanceOrder[i];
+				const glm::mat4& toObject = scene.instanceInverseTransforms[instance];
+				glm::vec3 origin(toObject * glm::vec4(shadowRay.origin, 1.0f));
+				glm::vec3 direction(toObject * glm::vec4(shadowRay.direction, 0.0f));
+				const Mesh& mesh = scene.meshes[scene.instances[instance].meshID];
+				uint32_t firstTriangle = mesh.firstIndex / 3;
+				if (scene.meshBVHs[scene.instances[instance].meshID].TraverseAny(origin, direction, tMax,
+					[&](uint32_t meshFirst, uint32_t meshCount, float meshTMax)
+					{
+						RT_PROFILE_COUNT(TriangleTests, meshCount);
+						return scene.triangleSoA.IntersectAny(firstTriangle + meshFirst, meshCount, origin, direction, 0.001f, meshTMax);
+					}))
+					return true;
+			}
+			return false;
+		});
+	return occluded ? 0.0f : 1.0f;
 }
 
 HitInfo Renderer::CalculateRayCollision(Scene& scene, Ray ray)
 {
-	HitInfo finalHitInfo;
-	for (const Sphere& sphere : scene.spheres)
+	RT_PROFILE_STAGE(Intersect);
+	float tMax = FLT_MAX;
+	uint32_t primitive = 0, instance = 0;
+	if (!IntersectScene(scene, ray.origin, ray.direction, tMax, primitive, instance))
+		return HitInfo();
+	return MakeHitInfo(scene, ray, tMax, primitive, instance);
+}
+
+void Renderer::UpdatePrimaryHitCache(const Scene& scene, const Camera& camera)
+{
+	// 不抖动时主光线每帧相同；抖动时种子随帧号变化，只有累积第一帧与缓存时的主光线相同
+	m_PrimaryHitMode = PrimaryHitMode::None;
+	if (!m_CachePrimaryHits || (m_JitterPrimaryRays && m_FrameCount != 1))
+		return;
+	const Tile region = GetRegion();
+
+	PrimaryHitCache& cache = m_PrimaryHitCache;
+	uint32_t samplesPerPixel = std::min(m_NumRays, PrimaryHitCache::MaxSamplesPerPixel);
+	if (cache.geometryVersion != scene.geometryVersion || cache.cameraPosition != camera.GetPosition()
+		|| cache.cameraDirection != camera.GetDirection() || cache.verticalFOV != camera.GetVerticalFOV()
+		|| cache.width != m_Width || cache.height != m_Height || cache.samplesPerPixel != samplesPerPixel
+		|| cache.seed != m_Seed || cache.jitter != m_JitterPrimaryRays || cache.region.x0 != region.x0
+		|| cache.region.y0 != region.y0 || cache.region.x1 != region.x1 || cache.region.y1 != region.y1)
+	{
+		cache.geometryVersion = scene.geometryVersion;
+		cache.cameraPosition = camera.GetPosition();
+		cache.cameraDirection = camera.GetDirection();
+		cache.verticalFOV = camera.GetVerticalFOV();
+		cache.width = m_Width;
+		cache.height = m_Height;
+		cache.samplesPerPixel = samplesPerPixel;
+		cache.seed = m_Seed;
+		cache.jitter = m_JitterPrimaryRays;
+		cache.region = region;
+		cache.valid = false;
+		cache.hits.resize((size_t)m_Width * m_Height * samplesPerPixel);
+	}
+	if (cache.valid)
+		m_PrimaryHitMode = PrimaryHitMode::Read;
+	else if (!m_Adaptive || m_FrameCount <= m_AdaptiveMinFrames)
+		m_PrimaryHitMode = PrimaryHitMode::Write; // 自适应分配样本后部分像素不追踪，写不满缓存
+}
+
+Renderer::PrimaryHit* Renderer::GetPrimaryHitSlot(uint32_t pixelIndex, uint32_t sample)
+{
+	if (m_PrimaryHitMode == PrimaryHitMode::None || sample >= m_PrimaryHitCache.samplesPerPixel)
+		return nullptr;
+	return &m_PrimaryHitCache.hits[(size_t)pixelIndex * m_PrimaryHitCache.samplesPerPixel + sample];
+}
+
+HitInfo Renderer::FindPrimaryHit(const Scene& scene, const Ray& ray, PrimaryHit& slot)
+{
+	RT_PROFILE_STAGE(Intersect);
+	if (m_PrimaryHitMode == PrimaryHitMode::Read)
 	{
-		HitInfo hitInfo = RaySphere(ray, sphere);
-		if (hitInfo.didHit && (!finalHitInfo.didHit || hitInfo.dist <= finalHitInfo.dist))
+		if (slot.primitive == WavefrontQueue::NoHit)
+			return HitInfo();
+		// 材质在使用时查询，只改实例材质时缓存仍然有效
+		HitInfo hitInfo;
+		hitInfo.didHit = true;
+		hitInfo.dist = slot.t;
+		hitInfo.hitPoint = ray.origin + ray.direction * slot.t;
+		hitInfo.normal = slot.normal;
+		hitInfo.materialID = scene.GetPrimitiveMaterial(slot.primitive, slot.instance);
+		hitInfo.primitive = slot.primitive;
+		return hitInfo;
+	}
+
+	float tMax = FLT_MAX;
+	uint32_t primitive = 0, instance = 0;
+	if (!IntersectScene(scene, ray.origin, ray.direction, tMax, primitive, instance))
+	{
+		slot = PrimaryHit();
+		return HitInfo();
+	}
+	HitInfo hitInfo = MakeHitInfo(scene, ray, tMax, primitive, instance);
+	slot.t = tMax;
+	slot.primitive = primitive;
+	slot.instance = instance;
+	slot.normal = hitInfo.normal;
+	return hitInfo;
+}
+
+bool Renderer::IntersectScene(const Scene& scene, const glm::vec3& origin, const glm::vec3& direction,
+	float& tMax, uint32_t& primitive, uint32_t& instance)
+{
+	uint32_t hitIndex = 0;
+	bool didHit = scene.sphereBVH.Traverse(origin, direction, tMax,
+		[&](uint32_t first, uint32_t count, float& closest)
 		{
-			finalHitInfo = hitInfo;
-		}
+			RT_PROFILE_COUNT(SphereTests, count);
+			return scene.sphereSoA.IntersectClosest(first, count, origin, direction, closest, hitIndex);
+		});
+	if (didHit)
+		primitive = hitIndex;
+
+	// 实例用球体的最近距离剪枝
+	const Buffer<uint32_t>& instanceOrder = scene.instanceBVH.GetPrimitiveIndices();
+	didHit |= scene.instanceBVH.Traverse(origin, direction, tMax,
+		[&](uint32_t first, uint32_t count, float& closest)
+		{
+			bool hit = false;
+			for (uint32_t i = first; i < first + count; i++)
+			{
+				uint32_t instanceIndex = instanceOrder[i];
+				const glm::mat4& toObject = scene.instanceInverseTransforms[instanceIndex];
+				glm::vec3 objectOrigin(toObject * glm::vec4(origin, 1.0f));
+				glm::vec3 objectDirection(toObject * glm::vec4(direction, 0.0f));
+				const Mesh& mesh = scene.meshes[scene.instances[instanceIndex].meshID];
+				uint32_t firstTriangle = mesh.firstIndex / 3;
+				if (scene.meshBVHs[scene.instances[instanceIndex].meshID].Traverse(objectOrigin, objectDirection, closest,
+					[&](uint32_t meshFirst, uint32_t meshCount, float& meshClosest)
+					{
+						RT_PROFILE_COUNT(TriangleTests, meshCount);
+						return scene.triangleSoA.IntersectClosest(firstTriangle + meshFirst, meshCount,
+							objectOrigin, objectDirection, meshClosest, hitIndex);
+					}))
+				{
+					primitive = hitIndex | Scene::TrianglePrimitiveBit;
+					instance = instanceIndex;
+					hit = true;
+				}
+			}
+			return hit;
+		});
+	return didHit;
+}
+
+HitInfo Renderer::MakeHitInfo(const Scene& scene, const Ray& ray, float t, uint32_t primitive, uint32_t instance)
+{
+	// 只为最终的最近交点计算交点和法线
+	HitInfo hitInfo;
+	hitInfo.didHit = true;
+	hitInfo.dist = t;
+	hitInfo.hitPoint = ray.origin + ray.direction * t;
+	hitInfo.materialID = scene.GetPrimitiveMaterial(primitive, instance);
+	hitInfo.primitive = primitive;
+	if (primitive & Scene::TrianglePrimitiveBit)
+	{
+		// 物体空间法线乘逆变换的转置回到世界空间；三角形双面，法线朝向入射一侧
+		glm::vec3 objectNormal = scene.triangleSoA.GetNormal(primitive & ~Scene::TrianglePrimitiveBit);
+		const glm::mat4& toObject = scene.instanceInverseTransforms[instance];
+		glm::vec3 normal = glm::normalize(glm::vec3(glm::dot(glm::vec3(toObject[0]), objectNormal),
+			glm::dot(glm::vec3(toObject[1]), objectNormal), glm::dot(glm::vec3(toObject[2]), objectNormal)));
+		hitInfo.normal = glm::dot(normal, ray.direction) > 0.0f ? -normal : normal;
 	}
-	return finalHitInfo;
+	else
+	{
+		const SphereSoA& soa = scene.sphereSoA;
+		glm::vec3 center(soa.x[primitive], soa.y[primitive], soa.z[primitive]);
+		hitInfo.normal = glm::normalize(hitInfo.hitPoint - center);
+	}
+	return hitInfo;
 }
 
 glm::vec3 Renderer::GetSkyLight(Ray ray)
 {
+	RT_PROFILE_STAGE(Sky);
 	// 方向归一化
 	glm::vec3 dir = glm::normalize(ray.direction);
 
@@ -258,14 +1020,14 @@ glm::vec3 Renderer::GetSkyLight(Ray ray)
 	return glm::clamp(finalColor, 0.0f, 10.0f); // 限制最大亮度
 }
 
-HitInfo Renderer::RaySphere(Ray ray, Sphere sphere)
+HitInfo Renderer::RaySphere(const Ray& ray, const Sphere& sphere)
 {
 	HitInfo hitInfo;
 	glm::vec3 offsetRayOrigin = ray.origin - sphere.position;
 	float a = glm::dot(ray.direction, ray.direction);
-	float b = 2.0 * glm::dot(offsetRayOrigin, ray.direction);
+	float b = 2.0f * glm::dot(offsetRayOrigin, ray.direction);
 	float c = glm::dot(offsetRayOrigin, offsetRayOrigin) - sphere.radius * sphere.radius;
-	float d = b * b - 4 * a * c;
+	float d = b * b - 4.0f * a * c;
 	if (d > 0)
 	{
 		float ct = (-b - glm::sqrt(d)) / (2.0f * a);
@@ -1,11 +1,16 @@
-#pragma once
-
-#include "Walnut/Image.h"
+﻿#pragma once
 
 #include "Camera.h"
+#include "Denoiser.h"
+#include "Profiler.h"
 #include "Scene.h"
+#include "ImageSink.h"
+#include "TileScheduler.h"
+#include "Wavefront.h"
 
+#include <atomic>
 #include <memory>
+#include <vector>
 #include <glm/glm.hpp>
 
 struct Ray
@@ -23,42 +28,345 @@ struct HitInfo
 	glm::vec3 hitPoint;
 	glm::vec3 normal;
 	uint32_t materialID = 0;
+	uint32_t primitive = 0; // Scene 的图元编号，见 Scene::TrianglePrimitiveBit
+};
+
+// 一帧追踪的光线数
+struct RayCounts
+{
+	uint64_t primary = 0;   // 相机样本
+	uint64_t secondary = 0; // 弹射光线
+	uint64_t shadow = 0;    // 阴影光线
+};
+
+// 主光线第一次命中处的信息，供降噪器区分边缘；未命中时 albedo 为天空颜色，normal 和 depth 为零
+struct AuxiliarySample
+{
+	glm::vec3 albedo{ 0.0f };
+	glm::vec3 normal{ 0.0f };
+	float depth = 0.0f;
+};
+
+// 一条待测遮挡的直接光照连接
+struct ShadowConnection
+{
+	Ray ray;
+	float maxDistance = FLT_MAX;
+	glm::vec3 contribution{ 0.0f }; // 未计遮挡，乘以 ray 的可见度
 };
 
-class Renderer
+// 一次命中的着色结果，递归和 wavefront 两种路径共用
+struct SurfaceSample
 {
+	static constexpr uint32_t MaxLightSamples = 4; // 每个着色点最多采样的点光源数
+	static constexpr uint32_t MaxShadowConnections = 2 + MaxLightSamples; // 定向光 + 点光源 + 发光球体
+
+	glm::vec3 emission{ 0.0f };
+	ShadowConnection shadows[MaxShadowConnections];
+	uint32_t shadowCount = 0;
+	glm::vec3 indirectWeight{ 0.0f }; // 乘以 nextRay 带回的光
+	Ray nextRay;
+	float pdf = 0.0f; // nextRay 方向的采样概率密度 (立体角)，镜面反射为 0。下一次命中发光球体时用于 MIS
+};
+
+// 可以在帧之间调整的渲染参数。交互程序的 UI 线程编辑自己的一份，渲染线程在帧开始时整体赋给 Renderer
+struct RenderSettings
+{
+	uint32_t m_NumRays = 2;
+	uint32_t m_MaxBounceCount = 2; // 硬上限，开启轮盘赌后大部分路径在此之前结束
+	bool m_RussianRoulette = true;
+	uint32_t m_RouletteStartBounce = 3; // 前几次弹射不做轮盘赌，避免短路径上的额外噪声
+	bool m_JustDiffuse = false; // 所有表面按 Lambert 漫反射着色
+	uint32_t m_LightSamples = 1; // 每个着色点采样的点光源数，不超过 SurfaceSample::MaxLightSamples
+	bool m_Accumulate = true;
+	bool m_CachePrimaryHits = true; // 见 Renderer::PrimaryHitCache
+	bool m_JitterPrimaryRays = true; // 主光线在像素内随机偏移，累积后即抗锯齿
+	uint32_t m_Seed = 0; // 相同种子得到逐位相同的结果
+	RenderMode m_Mode = RenderMode::Recursive;
+	WavefrontSort m_WavefrontSort = WavefrontSort::None;
+
+	// 自适应采样：像素均值的标准误差 (HDR 亮度，均值超过 1 时取相对误差) 低于阈值后不再采样，
+	// 每帧 m_NumRays * 像素数 的预算按误差分给未收敛的像素
+	bool m_Adaptive = false;
+	float m_AdaptiveThreshold = 0.01f;
+	uint32_t m_AdaptiveMinFrames = 8;   // 先均匀累积这么多帧，误差估计才可信
+	uint32_t m_AdaptiveMaxBoost = 4;    // 单个像素每帧最多 m_NumRays * m_AdaptiveMaxBoost 个样本
+	bool m_ShowSampleCounts = false;    // 调试视图：按每个像素的样本数着色
+	bool m_ShowPixelCost = false;       // 调试视图：按每个像素本帧的耗时着色，需要 RT_PROFILE
+
+	// 每帧对累积结果做边缘保持的滤波，只影响显示，累积缓冲不变
+	bool m_Denoise = false;
+};
+
+class Renderer : public RenderSettings
+{
+public:
+	// 单个样本的亮度统计，估计像素均值的误差
+	struct PixelStats
+	{
+		float sum = 0.0f;
+		float sumSquares = 0.0f;
+		uint32_t samples = 0;
+	};
+
+	// 继续一次累积所需的全部状态。随机数只由像素编号、帧号、样本号和种子决定，没有另外的流状态，
+	// 恢复后从 frameCount 接着渲染，与不中断时逐位相同
+	struct AccumulationState
+	{
+		uint32_t width = 0, height = 0;
+		uint32_t frameCount = 1;    // 下一帧的帧号
+		uint64_t totalSamples = 0;
+		std::vector<glm::vec4> accumulation, albedoDepth, normal;
+		std::vector<PixelStats> pixelStats;
+	};
+
 public:
 	Renderer() = default;
 
-	void Render(Scene& scene, Camera& camera);
+	// 返回 false 表示本帧被取消：已累积的帧作废，下一帧从头开始，结果不交给 ImageSink
+	bool Render(Scene& scene, Camera& camera);
 	void OnResize(uint32_t width, uint32_t height);
 
-	std::shared_ptr<Walnut::Image> GetFinalImage() const { return m_FinalImage; }
+	void SetImageSink(std::shared_ptr<ImageSink> sink);
+	// 每个 tile 开始前检查，置位后尚未开始的 tile 全部跳过；为空时不可取消
+	void SetCancelToken(const std::atomic<bool>* token) { m_CancelToken = token; }
+	void ApplySettings(const RenderSettings& settings) { static_cast<RenderSettings&>(*this) = settings; }
+	// 只渲染图像中的这个矩形，其余像素保持不变 (分布式渲染的 worker 每个任务只算一块)；
+	// 像素编号和随机序列仍按整幅图像计算，结果与渲染整幅图像时逐位相同。不支持自适应采样
+	void SetRegion(const Tile& region) { m_Region = region; m_HasRegion = true; }
+	void ClearRegion() { m_HasRegion = false; }
+	TileScheduler& GetScheduler() { return m_Scheduler; }
 
-	HitInfo RaySphere(Ray ray, Sphere sphere);
+	uint32_t GetWidth() const { return m_Width; }
+	uint32_t GetHeight() const { return m_Height; }
+	const uint32_t* GetImageData() const { return m_ImageData; }
+	// 累积缓冲为加权的各帧之和，w 分量是权重 (一帧 m_NumRays 个样本记 1)，rgb / w 即均值
+	const glm::vec4* GetAccumulationData() const { return m_AccumulationData; }
+	// 与累积缓冲同权重累积的第一次命中的反照率 + 距离、法线，见 DenoiseInput
+	const glm::vec4* GetAlbedoDepthData() const { return m_AlbedoDepthData.data(); }
+	const glm::vec4* GetNormalData() const { return m_NormalData.data(); }
+	// 像素均值的亮度方差，样本太少时为 -1，见 DenoiseInput::variance
+	float GetPixelVariance(uint32_t index) const;
+	// 开启降噪时为最近一帧降噪后的颜色 (alpha 为 1)，否则为空
+	const glm::vec4* GetDenoisedData() const { return m_Denoised ? m_DenoisedData.data() : nullptr; }
+	Denoiser& GetDenoiser() { return m_Denoiser; }
+	// 只有定义 RT_PROFILE 编译时才有数据
+	Profiler& GetProfiler() { return m_Profiler; }
+
+	// 自适应采样的统计：本次累积追踪的主样本总数、已收敛的像素数
+	uint64_t GetTotalSampleCount() const { return m_TotalSamples; }
+	// 上一帧的光线数
+	const RayCounts& GetRayCounts() const { return m_RayCounts; }
+	uint32_t GetConvergedPixelCount() const { return m_ConvergedPixels; }
+
+	// 本帧的主光线交点是否全部取自缓存
+	bool IsReusingPrimaryHits() const { return m_PrimaryHitMode == PrimaryHitMode::Read; }
+
+	// 相机或场景变化后丢弃已累积的帧
+	void ResetFrameCount() { m_FrameCount = 1; }
+	uint32_t GetFrameCount() const { return m_FrameCount; }
+
+	// 在两帧之间调用；Load 要求尺寸与当前 OnResize 的相同
+	void SaveAccumulation(AccumulationState& state) const;
+	bool LoadAccumulation(const AccumulationState& state);
+
+	// 标量参考实现，渲染路径使用 SphereSoA 的 SIMD 内核
+	HitInfo RaySphere(const Ray& ray, const Sphere& sphere);
 
 private:
-	glm::vec4 PerPixel(uint32_t x, uint32_t y);
-	glm::vec3 TraceRay(Scene& scene, Ray ray);
-	glm::vec3 TraceRayOnce(Scene& scene, Ray ray, uint32_t dep = 0);
-	glm::vec3 Renderer::CalculateDirectLight(Scene& scene, HitInfo& hit, Ray& ray);
+	// 主光线交点缓存：相机和几何都没变时，只改材质或灯光的帧直接取出交点，跳过主光线求交。
+	// 开启抖动时只有累积第一帧的主光线会重复 (种子只取决于帧号和样本号)，关闭抖动时每帧都能复用
+	struct PrimaryHit
+	{
+		float t = FLT_MAX;
+		uint32_t primitive = WavefrontQueue::NoHit; // 未命中为 NoHit
+		uint32_t instance = 0;
+		glm::vec3 normal{ 0.0f };
+	};
+
+	struct PrimaryHitCache
+	{
+		static constexpr uint32_t MaxSamplesPerPixel = 4; // 只缓存每个像素的前几个样本，限制内存
+
+		std::vector<PrimaryHit> hits; // 像素 * samplesPerPixel + 样本
+		// 生成缓存时的状态，任何一项变化都要重新求交
+		uint64_t geometryVersion = 0;
+		glm::vec3 cameraPosition{ 0.0f }, cameraDirection{ 0.0f };
+		float verticalFOV = 0.0f;
+		uint32_t width = 0, height = 0, samplesPerPixel = 0, seed = 0;
+		Tile region = {}; // 只有区域内的像素写入了缓存
+		bool jitter = false;
+		bool valid = false;
+	};
+
+	enum class PrimaryHitMode
+	{
+		None,  // 本帧的主光线与缓存不同
+		Read,  // 从缓存取交点
+		Write  // 求交并写入缓存
+	};
+
+	// 着色内核的模板参数，由材质属性和渲染选项组合而成
+	enum ShadeFlags : uint32_t
+	{
+		ShadeDiffuse = 1 << 0,  // Lambert 漫反射 lobe (metallic 为 1 或 albedo 为 0 时没有)
+		ShadeGlossy = 1 << 1,   // roughness > 0：GGX 镜面 lobe
+		ShadeMirror = 1 << 2,   // roughness == 0：理想镜面反射，只能由 BSDF 采样得到
+		ShadeEmissive = 1 << 3, // 有自发光
+		ShadeKernelCount = 1 << 4
+	};
+
+	struct ShadingMaterial;
+	using ShadeKernel = SurfaceSample(Renderer::*)(Scene&, const Ray&, const HitInfo&, const ShadingMaterial&, float, bool, uint32_t&);
+
+	// 着色用的材质副本，附带按帧选定的内核。m_JustDiffuse 时去掉镜面 lobe，漫反射取完整的 albedo
+	struct ShadingMaterial
+	{
+		glm::vec3 diffuseColor{ 0.0f };  // albedo * (1 - metallic)
+		glm::vec3 reflectance{ 0.0f };   // 菲涅尔 F0
+		float alpha = 0.0f;              // GGX 参数 roughness^2
+		glm::vec3 emission{ 0.0f };
+		ShadeKernel shade = nullptr;
+	};
+
+	// 一个着色点上与入射方向无关的量，BSDF 采样和直接光照共用
+	struct ShadingPoint
+	{
+		glm::vec3 position;  // 沿法线偏移后的点，反射光线和阴影光线都从这里出发
+		glm::vec3 normal;    // 朝向入射一侧
+		glm::vec3 view;      // 指向观察者
+		float NdotV;
+		glm::vec3 fresnel;   // F(n·v)，估计镜面 lobe 的能量
+		glm::vec3 diffuse;   // 漫反射 lobe 的反照率 diffuseColor * (1 - F)
+		float specularProbability; // 选择镜面 lobe 的概率，按两个 lobe 的能量分配
+	};
+
+	// 发光球体，按 亮度 * 半径^2 的比例被选中做直接光照
+	struct SphereLight
+	{
+		glm::vec3 center;
+		float radius2;
+		glm::vec3 emission;
+		float cdf; // 含本灯在内的累积功率
+	};
+
+	// color 和 aux 为本帧 samples 个样本的均值
+	void AccumulatePixel(uint32_t index, const glm::vec3& color, const AuxiliarySample& aux, uint32_t samples);
+	void UpdateDisplayPixel(uint32_t index);
+	void RecordSample(uint32_t index, const glm::vec3& color);
+	// 自适应模式下按误差分配本帧每个像素的样本数，0 表示已收敛
+	void PlanAdaptiveSamples();
+	uint32_t GetPixelSampleCount(uint32_t index) const { return m_Adaptive ? m_FrameSamples[index] : m_NumRays; }
+	glm::vec3 PerPixel(uint32_t x, uint32_t y, uint32_t samples, AuxiliarySample& aux, RayCounts& rays);
+	glm::vec3 TraceRay(Scene& scene, uint32_t x, uint32_t y, uint32_t samples, AuxiliarySample& aux, RayCounts& rays);
+	// 每个样本的主光线，抖动消耗 seed 中的两个随机数
+	Ray GeneratePrimaryRay(uint32_t x, uint32_t y, uint32_t& seed) const;
+	// seed 沿路径传递，每次弹射推进；aux 不为空时写入第一次命中的信息；
+	// primaryHit 不为空时主光线的交点经由缓存取得
+	glm::vec3 TraceRayOnce(Scene& scene, Ray ray, uint32_t& seed, RayCounts& rays, AuxiliarySample* aux = nullptr,
+		PrimaryHit* primaryHit = nullptr);
+	// 判断缓存是否失效，决定本帧读还是写
+	void UpdatePrimaryHitCache(const Scene& scene, const Camera& camera);
+	// 第 sample 个样本 (从 0 开始) 在缓存中的位置，本帧不使用缓存或样本超出缓存范围时为空
+	PrimaryHit* GetPrimaryHitSlot(uint32_t pixelIndex, uint32_t sample);
+	HitInfo FindPrimaryHit(const Scene& scene, const Ray& ray, PrimaryHit& slot);
+	// 第 depth 次弹射之后路径是否继续，俄罗斯轮盘赌存活时按存活概率放大 throughput
+	bool ContinuePath(glm::vec3& throughput, uint32_t depth, uint32_t& seed) const;
+	// 按材质取本帧选好的着色内核；bsdfPdf 为上一次弹射采样 ray 方向的概率密度，主光线和镜面反射为 0；
+	// lastBounce 为 true 时不会再追踪 BSDF 采样的光线去找发光球体
+	SurfaceSample ShadeHit(Scene& scene, const Ray& ray, const HitInfo& hit, float bsdfPdf, bool lastBounce, uint32_t& seed)
+	{
+		const ShadingMaterial& mat = m_ShadingMaterials[hit.materialID];
+		return (this->*mat.shade)(scene, ray, hit, mat, bsdfPdf, lastBounce, seed);
+	}
+	// 每帧开始时由材质和渲染选项选出内核，预先算好与着色点无关的量
+	void UpdateShadingMaterials(const Scene& scene);
+	// 收集自发光材质的球体，在 UpdateShadingMaterials 之后调用
+	void UpdateSphereLights(const Scene& scene);
+	template<uint32_t Flags>
+	SurfaceSample ShadeHitKernel(Scene& scene, const Ray& ray, const HitInfo& hit, const ShadingMaterial& mat,
+		float bsdfPdf, bool lastBounce, uint32_t& seed);
+	// 非镜面 lobe 在 toLight 方向的 f * cos 和按 lobe 选择概率混合的采样概率密度
+	template<uint32_t Flags>
+	glm::vec3 EvaluateBSDF(const ShadingMaterial& mat, const ShadingPoint& point, const glm::vec3& toLight, float& pdf) const;
+	// 定向光、按 light tree 采样的点光源和一个发光球体，追加到 sample.shadows
+	template<uint32_t Flags>
+	void CalculateDirectLight(Scene& scene, const ShadingMaterial& mat, const ShadingPoint& point, bool lastBounce, uint32_t& seed,
+		SurfaceSample& sample);
+	// BSDF 采样命中发光球体时自发光的 MIS 权重，与 CalculateDirectLight 中光源采样的权重之和为 1
+	float EmissionWeight(const Scene& scene, const Ray& ray, const HitInfo& hit, const glm::vec3& emission, float bsdfPdf) const;
+	// 从 position 出发，选中这个球体并在它所张的圆锥内采样到某个方向的概率密度，position 在球内时为 0
+	float SphereLightPdf(const glm::vec3& position, const glm::vec3& center, float radius2, const glm::vec3& emission) const;
+	// maxDistance 之内被遮挡时为 0，否则为 1
+	float TraceShadowRay(Scene& scene, const Ray& shadowRay, float maxDistance = FLT_MAX);
 	HitInfo CalculateRayCollision(Scene& scene, Ray ray);
+	// 球体和网格实例中最近的交点，primitive 为 Scene 的图元编号，命中三角形时 instance 为实例编号
+	bool IntersectScene(const Scene& scene, const glm::vec3& origin, const glm::vec3& direction,
+		float& tMax, uint32_t& primitive, uint32_t& instance);
+	HitInfo MakeHitInfo(const Scene& scene, const Ray& ray, float t, uint32_t primitive, uint32_t instance);
 
 	glm::vec3 GetSkyLight(Ray ray);
 
-public:
-	uint32_t m_NumRays = 2;
-	uint32_t m_MaxBounceCount = 2;
-	bool m_JustDiffuse = false;
+	// 对累积结果降噪并写入 m_ImageData
+	void Denoise();
+	// 本帧渲染的矩形，没有设置时为整幅图像
+	Tile GetRegion() const { return m_HasRegion ? m_Region : Tile{ 0, 0, m_Width, m_Height }; }
+	// 用 m_PixelCost 覆盖显示缓冲
+	void ShowPixelCost();
+
+	// wavefront 模式的各个阶段，见 Wavefront.cpp
+	void RenderTileWavefront(const Tile& tile, WavefrontQueue& queue, RayCounts& rays);
+	void WavefrontGenerate(const Tile& tile, WavefrontQueue& queue);
+	void WavefrontExtend(WavefrontQueue& queue, uint32_t depth);
+	void WavefrontMiss(WavefrontQueue& queue, uint32_t depth);
+	void WavefrontSortHits(WavefrontQueue& queue);
+	void WavefrontShade(WavefrontQueue& queue, uint32_t depth);
+	void WavefrontShadowConnect(WavefrontQueue& queue);
 
 private:
 	Scene* m_Scene = nullptr;
 	Camera* m_Camera = nullptr;
 
-	uint32_t m_FrameCount = 0;
+	uint32_t m_FrameCount = 1;
+	const std::atomic<bool>* m_CancelToken = nullptr;
 
-	std::shared_ptr<Walnut::Image> m_FinalImage;
+	std::shared_ptr<ImageSink> m_ImageSink;
+	uint32_t m_Width = 0, m_Height = 0;
+	Tile m_Region = {};
+	bool m_HasRegion = false;
 	uint32_t* m_ImageData = nullptr;
+	glm::vec4* m_AccumulationData = nullptr;
+
+	PrimaryHitCache m_PrimaryHitCache;
+	PrimaryHitMode m_PrimaryHitMode = PrimaryHitMode::None;
+
+	std::vector<ShadingMaterial> m_ShadingMaterials;
+	std::vector<SphereLight> m_SphereLights;
+
+	std::vector<PixelStats> m_PixelStats;
+	std::vector<uint16_t> m_FrameSamples;
+	std::vector<float> m_PixelError;
+	uint64_t m_TotalSamples = 0;
+	uint32_t m_ConvergedPixels = 0;
+
+	// 与累积缓冲同权重累积的第一次命中信息：反照率 + 距离、法线
+	std::vector<glm::vec4> m_AlbedoDepthData, m_NormalData;
+	std::vector<float> m_PixelVariance;
+	std::vector<glm::vec4> m_DenoisedData;
+	bool m_Denoised = false;
+	Denoiser m_Denoiser;
+
+	Profiler m_Profiler;
+	std::vector<float> m_PixelCost; // 本帧每个像素的 Profiler::Now() 读数差，wavefront 模式按 tile 平均
+
+	TileScheduler m_Scheduler;
+	std::vector<WavefrontQueue> m_WavefrontQueues; // 每个 worker 一份
 
-	std::vector<uint32_t> m_ImageHorizontalIter, m_ImageVerticalIter;
+	// 每个 worker 单独计数，各占一条缓存行
+	struct alignas(64) WorkerRayCounts
+	{
+		RayCounts rays;
+	};
+	std::vector<WorkerRayCounts> m_WorkerRayCounts;
+	RayCounts m_RayCounts;
 };
\ No newline at end of file
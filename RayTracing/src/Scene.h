@@ -1,7 +1,19 @@
 #pragma once
 
+#include "BVH.h"
+#include "SphereSoA.h"
+#include "TriangleSoA.h"
+#include "LightTree.h"
+#include "Buffer.h"
+
+class MappedFile;
+
 #include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
 #include <vector>
+#include <memory>
+#include <algorithm>
+#include <atomic>
 
 struct Material
 {
@@ -13,17 +25,34 @@ struct Material
 
     glm::vec3 GetEmission() const { return emissionColor * emissionPower; }
 
-    glm::vec3 FresnelSchlick(float cosTheta) const
+    // ֱʱķ F0
+    glm::vec3 GetReflectance() const
     {
         float minReflectance = 0.04f;
-        glm::vec3 reflectance = albedo * metallic +
-            glm::vec3(minReflectance) * (1.0f - metallic);
-        float powerTerm = glm::pow(glm::clamp(1.0f - cosTheta, 0.0f, 1.0f), 5.0f);
-        return reflectance + (glm::vec3(1.0f) - reflectance) * powerTerm;
+        return albedo * metallic + glm::vec3(minReflectance) * (1.0f - metallic);
+    }
+
+    glm::vec3 FresnelSchlick(float cosTheta) const
+    {
+        return FresnelSchlick(GetReflectance(), cosTheta);
+    }
+
+    // ɫںʹԤõ F0
+    static glm::vec3 FresnelSchlick(const glm::vec3& reflectance, float cosTheta)
+    {
+        return reflectance + (glm::vec3(1.0f) - reflectance) * Pow5(glm::clamp(1.0f - cosTheta, 0.0f, 1.0f));
+    }
+
+    // x^5γ˷ pow
+    static float Pow5(float x)
+    {
+        float x2 = x * x;
+        return x2 * x2 * x;
     }
 
 };
 
+// Ƶ intensity   ΪնȣԵƵİɫΪ color * intensity
 struct DirectionalLight
 {
     glm::vec3 direction = glm::normalize(glm::vec3(-1, -1, -1));
@@ -37,6 +66,20 @@ struct PointLight
     glm::vec3 color = glm::vec3(1.0f);
     float intensity = 1.0f;
     float range = 10.0f;
+
+    // 1/d^2 ˥ range ƽضΪ 0
+    static float Attenuation(float distance, float range)
+    {
+        float ratio = distance / range;
+        float window = glm::clamp(1.0f - ratio * ratio * ratio * ratio, 0.0f, 1.0f);
+        return window * window / glm::max(distance * distance, 1e-4f);
+    }
+
+    // ѡʱƹõı
+    float GetPower() const { return intensity * glm::dot(color, glm::vec3(0.2126f, 0.7152f, 0.0722f)); }
+
+    // ÷Χ
+    AABB GetBounds() const { return { position - glm::vec3(range), position + glm::vec3(range) }; }
 };
 
 struct Sphere
@@ -45,16 +88,84 @@ struct Sphere
     float radius = 0.5f;
 
     uint32_t materialID = 0;
+
+    AABB GetBounds() const
+    {
+        return { position - glm::vec3(radius), position + glm::vec3(radius) };
+    }
+};
+
+// 񼸺 (BLAS)ָ Scene Ķ㻺壻ͬһԱʵ
+struct Mesh
+{
+    uint32_t firstIndex = 0;    // Scene::indices е㣬 firstIndex / 3  triangleSoA еһ
+    uint32_t triangleCount = 0;
+};
+
+// ʵ任 + ʣκ BLAS ʵ
+struct MeshInstance
+{
+    glm::vec3 position{ 0.0f };
+    glm::vec3 rotation{ 0.0f };     // ŷ () ZXY ת
+    glm::vec3 scale{ 1.0f };
+    uint32_t meshID = 0;
+    uint32_t materialID = 0;
+
+    // ռ䵽ռ
+    glm::mat4 GetTransform() const
+    {
+        glm::mat4 transform = glm::translate(glm::mat4(1.0f), position);
+        transform = glm::rotate(transform, glm::radians(rotation.y), glm::vec3(0.0f, 1.0f, 0.0f));
+        transform = glm::rotate(transform, glm::radians(rotation.x), glm::vec3(1.0f, 0.0f, 0.0f));
+        transform = glm::rotate(transform, glm::radians(rotation.z), glm::vec3(0.0f, 0.0f, 1.0f));
+        return glm::scale(transform, scale);
+    }
 };
 
 struct Scene
 {
+    // ͼԪţλκ壬λΪӦ SoA ±ꣻ¼еʵ
+    static constexpr uint32_t TrianglePrimitiveBit = 0x80000000u;
+
     std::vector<Material> materials;
     std::vector<Sphere> spheres;
 
+    Buffer<glm::vec3> vertices;         // 
+    Buffer<uint32_t> indices;           // ÿһΣָ vertices
+    std::vector<Mesh> meshes;
+    std::vector<MeshInstance> instances;
+
     DirectionalLight directionalLight;
     std::vector<PointLight> pointLights;
 
+    // 屾ǵλʵsphereBVH ൱ǵĶṹ
+    BVH sphereBVH;
+    SphereSoA sphereSoA;                //  sphereBVH ͼԪ˳
+    std::vector<AABB> sphereBounds;
+    bool sphereBVHNeedsRebuild = true;  // ɾ
+    std::vector<uint32_t> changedSpheres; // ֻλû뾶ֲ Refit
+    std::vector<uint32_t> changedSphereMaterials; // ֻ˲ʣӰ켸
+
+    // ײ㣺ÿһ BLASͼԪڵ
+    std::vector<BVH> meshBVHs;          // ֻΪ񹹽
+    TriangleSoA triangleSoA;            // ÿһΣڰ BLAS ͼԪ˳
+
+    // 㣺ʵռΧϵ BVH
+    BVH instanceBVH;
+    std::vector<glm::mat4> instanceInverseTransforms;  // ռ䵽ռ
+    std::vector<AABB> instanceBounds;
+    bool instanceBVHNeedsRebuild = true;    // ɾʵ
+    std::vector<uint32_t> changedInstances; // ֻ˱任ֲ Refit
+
+    LightTree pointLightTree;
+    bool pointLightsChanged = true;
+
+    //  (塢ʵ任) ÿθºһȫΨһıţȾݴжϻ߽ǷʧЧ
+    uint64_t geometryVersion = NextGeometryVersion();
+
+    // ӶƳļʱBuffer ֱӳڴ
+    std::shared_ptr<MappedFile> backingFile;
+
     uint32_t AddMaterial(const Material& material)
     {
         materials.push_back(material);
@@ -73,10 +184,261 @@ struct Scene
         float range = 10.0f)
     {
         pointLights.push_back({ position,color,intensity,range });
+        pointLightsChanged = true;
     }
 
+    // indices  positions׷ӵ󷵻ţҪ AddInstance Żڳ
+    uint32_t AddMesh(const std::vector<glm::vec3>& positions, const std::vector<uint32_t>& meshIndices)
+    {
+        uint32_t vertexOffset = (uint32_t)vertices.size();
+        std::vector<glm::vec3>& sharedVertices = vertices.Edit();
+        sharedVertices.insert(sharedVertices.end(), positions.begin(), positions.end());
+
+        Mesh mesh;
+        mesh.firstIndex = (uint32_t)indices.size();
+        mesh.triangleCount = (uint32_t)(meshIndices.size() / 3);
+        std::vector<uint32_t>& sharedIndices = indices.Edit();
+        sharedIndices.reserve(sharedIndices.size() + mesh.triangleCount * 3);
+        for (uint32_t i = 0; i < mesh.triangleCount * 3; i++)
+            sharedIndices.push_back(meshIndices[i] + vertexOffset);
+
+        meshes.push_back(mesh);
+        return (uint32_t)(meshes.size() - 1);
+    }
+
+    uint32_t AddInstance(const MeshInstance& instance)
+    {
+        instances.push_back(instance);
+        instanceBVHNeedsRebuild = true;
+        return (uint32_t)(instances.size() - 1);
+    }
+
+    // ֻʵı任ֻĲʲҪ
+    void MarkInstanceChanged(uint32_t instanceIndex)
+    {
+        changedInstances.push_back(instanceIndex);
+    }
+
+    uint32_t GetPrimitiveMaterial(uint32_t primitive, uint32_t instance) const
+    {
+        if (primitive & TrianglePrimitiveBit)
+            return instances[instance].materialID;
+        return sphereSoA.materialID[primitive];
+    }
+
+    uint32_t GetTriangleCount() const { return (uint32_t)(indices.size() / 3); }
+
     void AddSphere(const Sphere& sphere)
     {
         spheres.push_back(sphere);
+        sphereBVHNeedsRebuild = true;
+    }
+
+    // һλû뾶
+    void MarkSphereChanged(uint32_t sphereIndex)
+    {
+        changedSpheres.push_back(sphereIndex);
+    }
+
+    // ֻһĲʣд SoA еĲ±꣬ RefitҲ geometryVersion߽ȻЧ
+    void MarkSphereMaterialChanged(uint32_t sphereIndex)
+    {
+        changedSphereMaterials.push_back(sphereIndex);
+    }
+
+    // ɾ༭˵Դ
+    void MarkPointLightsChanged()
+    {
+        pointLightsChanged = true;
+    }
+
+    // ༭ݳϽУһ (Ⱦ̳߳еĸ) ֻ޸ģƳݺʹ޸ıǣ
+    // target Ѿļٽṹ´ UpdateBVH ʱ¡֮ı
+    void TransferEdits(Scene& target)
+    {
+        target.materials = materials;
+        target.spheres = spheres;
+        // ֻ׷ӣСʱҲ
+        if (target.vertices.size() != vertices.size() || target.indices.size() != indices.size())
+        {
+            target.vertices = vertices;
+            target.indices = indices;
+        }
+        target.meshes = meshes;
+        target.instances = instances;
+        target.directionalLight = directionalLight;
+        target.pointLights = pointLights;
+        target.backingFile = backingFile;
+
+        target.sphereBVHNeedsRebuild |= sphereBVHNeedsRebuild;
+        target.changedSpheres.insert(target.changedSpheres.end(), changedSpheres.begin(), changedSpheres.end());
+        target.changedSphereMaterials.insert(target.changedSphereMaterials.end(), changedSphereMaterials.begin(), changedSphereMaterials.end());
+        target.instanceBVHNeedsRebuild |= instanceBVHNeedsRebuild;
+        target.changedInstances.insert(target.changedInstances.end(), changedInstances.begin(), changedInstances.end());
+        target.pointLightsChanged |= pointLightsChanged;
+        ClearEdits();
+    }
+
+    // ޸Ѿĸ
+    void ClearEdits()
+    {
+        sphereBVHNeedsRebuild = false;
+        changedSpheres.clear();
+        changedSphereMaterials.clear();
+        instanceBVHNeedsRebuild = false;
+        changedInstances.clear();
+        pointLightsChanged = false;
+    }
+
+    void UpdateLightTree()
+    {
+        if (!pointLightsChanged)
+            return;
+        pointLightTree.Build(pointLights);
+        pointLightsChanged = false;
+    }
+
+    void UpdateBVH()
+    {
+        bool geometryChanged = meshBVHs.size() != meshes.size() || instanceBVHNeedsRebuild || !changedInstances.empty() ||
+            instanceBounds.size() != instances.size() || sphereBVHNeedsRebuild || !changedSpheres.empty() ||
+            sphereBounds.size() != spheres.size();
+        UpdateMeshBVHs();
+        UpdateInstanceBVH();
+        UpdateSphereBVH();
+        if (geometryChanged)
+            geometryVersion = NextGeometryVersion();
     }
-};
\ No newline at end of file
+
+    static uint64_t NextGeometryVersion()
+    {
+        static std::atomic<uint64_t> counter{ 0 };
+        return ++counter;
+    }
+
+    void UpdateSphereBVH()
+    {
+        // ļص BVH ûбͼԪΧ
+        if (sphereBVHNeedsRebuild || sphereBounds.size() != spheres.size())
+        {
+            sphereBounds.resize(spheres.size());
+            for (size_t i = 0; i < spheres.size(); i++)
+                sphereBounds[i] = spheres[i].GetBounds();
+        }
+
+        if (sphereBVHNeedsRebuild)
+        {
+            sphereBVH.Build(sphereBounds, SphereSoA::GetLaneCount());
+
+            const Buffer<uint32_t>& order = sphereBVH.GetPrimitiveIndices();
+            sphereSoA.Resize((uint32_t)spheres.size());
+            for (uint32_t i = 0; i < (uint32_t)order.size(); i++)
+            {
+                const Sphere& sphere = spheres[order[i]];
+                sphereSoA.Set(i, sphere.position, sphere.radius, sphere.materialID);
+            }
+        }
+        else if (!changedSpheres.empty())
+        {
+            for (uint32_t i : changedSpheres)
+                sphereBounds[i] = spheres[i].GetBounds();
+            sphereBVH.RefitPrimitives(changedSpheres, sphereBounds);
+            for (uint32_t i : changedSpheres)
+                sphereSoA.Set(sphereBVH.GetPrimitiveSlot(i), spheres[i].position, spheres[i].radius, spheres[i].materialID);
+        }
+
+        // ؽʱ±Ѿд
+        if (!sphereBVHNeedsRebuild && !changedSphereMaterials.empty())
+        {
+            sphereBVH.BuildRefitIndex();
+            std::vector<uint32_t>& materialIDs = sphereSoA.materialID.Edit();
+            for (uint32_t i : changedSphereMaterials)
+                materialIDs[sphereBVH.GetPrimitiveSlot(i)] = spheres[i].materialID;
+        }
+
+        sphereBVHNeedsRebuild = false;
+        changedSpheres.clear();
+        changedSphereMaterials.clear();
+    }
+
+    // ֻΪû BLAS 񹹽Ӱ
+    void UpdateMeshBVHs()
+    {
+        if (meshBVHs.size() == meshes.size())
+            return;
+
+        triangleSoA.Resize(GetTriangleCount());
+        for (size_t m = meshBVHs.size(); m < meshes.size(); m++)
+        {
+            const Mesh& mesh = meshes[m];
+            const uint32_t* meshIndices = indices.data() + mesh.firstIndex;
+            std::vector<AABB> bounds(mesh.triangleCount);
+            for (uint32_t i = 0; i < mesh.triangleCount; i++)
+            {
+                bounds[i].Grow(vertices[meshIndices[i * 3 + 0]]);
+                bounds[i].Grow(vertices[meshIndices[i * 3 + 1]]);
+                bounds[i].Grow(vertices[meshIndices[i * 3 + 2]]);
+            }
+            meshBVHs.emplace_back();
+            meshBVHs.back().Build(bounds);
+
+            const Buffer<uint32_t>& order = meshBVHs.back().GetPrimitiveIndices();
+            uint32_t firstTriangle = mesh.firstIndex / 3;
+            for (uint32_t i = 0; i < (uint32_t)order.size(); i++)
+            {
+                uint32_t tri = order[i];
+                triangleSoA.Set(firstTriangle + i, vertices[meshIndices[tri * 3 + 0]], vertices[meshIndices[tri * 3 + 1]],
+                    vertices[meshIndices[tri * 3 + 2]]);
+            }
+        }
+        // µ BLAS ıʵİΧ
+        instanceBVHNeedsRebuild = true;
+    }
+
+    void UpdateInstanceBVH()
+    {
+        if (instanceBounds.size() != instances.size())
+            instanceBVHNeedsRebuild = true;
+
+        if (instanceBVHNeedsRebuild)
+        {
+            instanceInverseTransforms.resize(instances.size());
+            instanceBounds.resize(instances.size());
+            for (uint32_t i = 0; i < (uint32_t)instances.size(); i++)
+                UpdateInstanceTransform(i);
+            instanceBVH.Build(instanceBounds, 1);
+        }
+        else if (!changedInstances.empty())
+        {
+            for (uint32_t i : changedInstances)
+                UpdateInstanceTransform(i);
+            instanceBVH.RefitPrimitives(changedInstances, instanceBounds);
+        }
+
+        instanceBVHNeedsRebuild = false;
+        changedInstances.clear();
+    }
+
+    // 任ռΧ (BLAS ڵΧе 8 ǵ任ȡΧ)
+    void UpdateInstanceTransform(uint32_t instanceIndex)
+    {
+        const MeshInstance& instance = instances[instanceIndex];
+        glm::mat4 transform = instance.GetTransform();
+        instanceInverseTransforms[instanceIndex] = glm::inverse(transform);
+
+        AABB bounds;
+        const BVH& blas = meshBVHs[instance.meshID];
+        if (!blas.IsEmpty())
+        {
+            const BVHNode& root = blas.GetNodes()[0];
+            for (int corner = 0; corner < 8; corner++)
+            {
+                glm::vec3 p((corner & 1) ? root.boundsMax.x : root.boundsMin.x,
+                    (corner & 2) ? root.boundsMax.y : root.boundsMin.y,
+                    (corner & 4) ? root.boundsMax.z : root.boundsMin.z);
+                bounds.Grow(glm::vec3(transform * glm::vec4(p, 1.0f)));
+            }
+        }
+        instanceBounds[instanceIndex] = bounds;
+    }
+};
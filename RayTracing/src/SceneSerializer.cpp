@@ -0,0 +1,673 @@
+﻿#include "SceneSerializer.h"
+#include "MappedFile.h"
+#include "MeshLoader.h"
+#include "Json.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <type_traits>
+
+namespace {
+
+	// ---- 二进制格式 ----
+
+	constexpr char Magic[8] = { 'R', 'T', 'S', 'C', 'E', 'N', 'E', '\0' };
+	constexpr uint32_t Version = 2;
+	constexpr uint32_t ByteOrderMark = 0x01020304;
+	constexpr uint64_t SectionAlignment = 64; // 缓存行，也满足 AVX-512 对齐加载
+
+	enum class SectionID : uint32_t
+	{
+		Materials = 1, Spheres, PointLights, DirectionalLight, Camera,
+		Vertices, Indices, Meshes, Instances,
+		SphereBVHNodes, SphereBVHIndices,
+		SphereX, SphereY, SphereZ, SphereRadius2, SphereMaterial,
+		MeshBVHNodes, MeshBVHNodeCounts, MeshBVHIndices, // 各网格 BLAS 依次拼接
+		TriangleV0X, TriangleV0Y, TriangleV0Z,
+		TriangleE1X, TriangleE1Y, TriangleE1Z,
+		TriangleE2X, TriangleE2Y, TriangleE2Z,
+	};
+
+	struct FileHeader
+	{
+		char magic[8];
+		uint32_t version;
+		uint32_t byteOrder;
+		uint32_t sectionCount;
+		uint32_t reserved;
+		uint64_t fileSize;
+	};
+
+	struct SectionHeader
+	{
+		uint32_t id;
+		uint32_t elementSize; // 加载时与 sizeof 比较，布局变化的文件直接拒绝
+		uint64_t count;
+		uint64_t offset;
+	};
+
+	struct CameraData
+	{
+		glm::vec3 position;
+		float verticalFOV;
+		glm::vec3 direction;
+		float reserved;
+	};
+
+	static_assert(std::is_trivially_copyable<Material>::value, "Material is stored as raw bytes");
+	static_assert(std::is_trivially_copyable<Sphere>::value, "Sphere is stored as raw bytes");
+	static_assert(std::is_trivially_copyable<PointLight>::value, "PointLight is stored as raw bytes");
+	static_assert(std::is_trivially_copyable<DirectionalLight>::value, "DirectionalLight is stored as raw bytes");
+	static_assert(std::is_trivially_copyable<Mesh>::value, "Mesh is stored as raw bytes");
+	static_assert(std::is_trivially_copyable<MeshInstance>::value, "MeshInstance is stored as raw bytes");
+	static_assert(std::is_trivially_copyable<BVHNode>::value, "BVHNode is stored as raw bytes");
+
+	uint64_t AlignUp(uint64_t value, uint64_t alignment)
+	{
+		return (value + alignment - 1) / alignment * alignment;
+	}
+
+	class BinaryWriter
+	{
+	public:
+		template<typename T>
+		void Add(SectionID id, const T* data, size_t count)
+		{
+			if (count == 0)
+				return;
+			m_Sections.push_back({ (uint32_t)id, (uint32_t)sizeof(T), (uint64_t)count, 0 });
+			m_Payloads.push_back(data);
+		}
+
+		template<typename T>
+		void Add(SectionID id, const Buffer<T>& buffer) { Add(id, buffer.data(), buffer.size()); }
+		template<typename T>
+		void Add(SectionID id, const std::vector<T>& values) { Add(id, values.data(), values.size()); }
+
+		bool Write(const std::string& path)
+		{
+			uint64_t offset = AlignUp(sizeof(FileHeader) + m_Sections.size() * sizeof(SectionHeader), SectionAlignment);
+			for (SectionHeader& section : m_Sections)
+			{
+				section.offset = offset;
+				offset = AlignUp(offset + section.count * section.elementSize, SectionAlignment);
+			}
+
+			FileHeader header = {};
+			memcpy(header.magic, Magic, sizeof(Magic));
+			header.version = Version;
+			header.byteOrder = ByteOrderMark;
+			header.sectionCount = (uint32_t)m_Sections.size();
+			header.fileSize = offset;
+
+			std::ofstream file(path, std::ios::binary);
+			if (!file)
+				return false;
+			file.write((const char*)&header, sizeof(header));
+			file.write((const char*)m_Sections.data(), m_Sections.size() * sizeof(SectionHeader));
+
+			static const char zeros[SectionAlignment] = {};
+			uint64_t written = sizeof(header) + m_Sections.size() * sizeof(SectionHeader);
+			for (size_t i = 0; i < m_Sections.size(); i++)
+			{
+				file.write(zeros, m_Sections[i].offset - written);
+				file.write((const char*)m_Payloads[i], m_Sections[i].count * m_Sections[i].elementSize);
+				written = m_Sections[i].offset + m_Sections[i].count * m_Sections[i].elementSize;
+			}
+			file.write(zeros, header.fileSize - written);
+			return (bool)file;
+		}
+
+	private:
+		std::vector<SectionHeader> m_Sections;
+		std::vector<const void*> m_Payloads;
+	};
+
+	class BinaryReader
+	{
+	public:
+		bool Open(const std::shared_ptr<MappedFile>& file)
+		{
+			m_File = file;
+			if (file->GetSize() < sizeof(FileHeader))
+				return false;
+
+			const FileHeader* header = (const FileHeader*)file->GetData();
+			if (memcmp(header->magic, Magic, sizeof(Magic)) != 0 || header->version != Version ||
+				header->byteOrder != ByteOrderMark || header->fileSize != file->GetSize())
+				return false;
+
+			uint64_t tableEnd = sizeof(FileHeader) + (uint64_t)header->sectionCount * sizeof(SectionHeader);
+			if (tableEnd > file->GetSize())
+				return false;
+			m_Sections = (const SectionHeader*)(file->GetData() + sizeof(FileHeader));
+			m_SectionCount = header->sectionCount;
+
+			// 段数据必须完整落在文件内：先确认起点不越界，再用除法比较长度，避免 offset + count * elementSize 溢出
+			uint64_t fileSize = file->GetSize();
+			for (uint32_t i = 0; i < m_SectionCount; i++)
+			{
+				const SectionHeader& section = m_Sections[i];
+				if (section.offset % SectionAlignment != 0 || section.offset < tableEnd || section.offset > fileSize ||
+					section.elementSize == 0 || section.count > (fileSize - section.offset) / section.elementSize)
+					return false;
+			}
+			return true;
+		}
+
+		// 缺少的段得到空数组；元素大小不符返回 false
+		template<typename T>
+		bool Get(SectionID id, const T*& data, size_t& count) const
+		{
+			data = nullptr;
+			count = 0;
+			for (uint32_t i = 0; i < m_SectionCount; i++)
+			{
+				if (m_Sections[i].id != (uint32_t)id)
+					continue;
+				if (m_Sections[i].elementSize != sizeof(T))
+					return false;
+				data = (const T*)(m_File->GetData() + m_Sections[i].offset);
+				count = (size_t)m_Sections[i].count;
+				return true;
+			}
+			return true;
+		}
+
+		template<typename T>
+		bool Copy(SectionID id, std::vector<T>& values) const
+		{
+			const T* data;
+			size_t count;
+			if (!Get(id, data, count))
+				return false;
+			values.assign(data, data + count);
+			return true;
+		}
+
+		template<typename T>
+		bool View(SectionID id, Buffer<T>& buffer) const
+		{
+			const T* data;
+			size_t count;
+			if (!Get(id, data, count))
+				return false;
+			buffer.SetView(data, count);
+			return true;
+		}
+
+	private:
+		std::shared_ptr<MappedFile> m_File;
+		const SectionHeader* m_Sections = nullptr;
+		uint32_t m_SectionCount = 0;
+	};
+
+	// 子节点必须在父节点之后 (Refit 依赖这一点)，叶子区间不能越界，
+	// 深度不能超过 BVH::MaxDepth (遍历用固定大小的栈)
+	bool IsValidBVH(const BVH& bvh, size_t primCount)
+	{
+		const Buffer<BVHNode>& nodes = bvh.GetNodes();
+		const Buffer<uint32_t>& primIndices = bvh.GetPrimitiveIndices();
+		if (primIndices.size() != primCount || nodes.empty() != (primCount == 0))
+			return false;
+		// 子节点在父节点之后，一次正向遍历就能得到每个节点的深度
+		std::vector<uint32_t> depth(nodes.size(), 0);
+		for (size_t i = 0; i < nodes.size(); i++)
+		{
+			const BVHNode& node = nodes[i];
+			if (node.IsLeaf() ? (uint64_t)node.leftFirst + node.count > primCount
+				: node.leftFirst <= i || (uint64_t)node.leftFirst + 1 >= nodes.size())
+				return false;
+			if (depth[i] > BVH::MaxDepth)
+				return false;
+			if (!node.IsLeaf())
+			{
+				depth[node.leftFirst] = std::max(depth[node.leftFirst], depth[i] + 1);
+				depth[node.leftFirst + 1] = std::max(depth[node.leftFirst + 1], depth[i] + 1);
+			}
+		}
+		for (uint32_t prim : primIndices)
+			if (prim >= primCount)
+				return false;
+		return true;
+	}
+
+	// ---- JSON ----
+
+	void WriteVec3(FILE* file, const glm::vec3& v)
+	{
+		fprintf(file, "[%.9g, %.9g, %.9g]", v.x, v.y, v.z);
+	}
+
+	bool HasJSONExtension(const std::string& path)
+	{
+		std::string extension = path.substr(path.find_last_of('.') + 1);
+		std::transform(extension.begin(), extension.end(), extension.begin(),
+			[](unsigned char c) { return (char)std::tolower(c); });
+		return extension == "json";
+	}
+
+}
+
+namespace SceneSerializer {
+
+	bool SaveBinary(const std::string& path, Scene& scene, const Camera* camera)
+	{
+		// 加速结构随文件保存，加载时无需重建
+		scene.UpdateBVH();
+
+		BinaryWriter writer;
+		writer.Add(SectionID::Materials, scene.materials);
+		writer.Add(SectionID::Spheres, scene.spheres);
+		writer.Add(SectionID::PointLights, scene.pointLights);
+		writer.Add(SectionID::DirectionalLight, &scene.directionalLight, 1);
+		CameraData cameraData = {};
+		if (camera)
+		{
+			cameraData.position = camera->GetPosition();
+			cameraData.direction = camera->GetDirection();
+			cameraData.verticalFOV = camera->GetVerticalFOV();
+			writer.Add(SectionID::Camera, &cameraData, 1);
+		}
+
+		writer.Add(SectionID::Vertices, scene.vertices);
+		writer.Add(SectionID::Indices, scene.indices);
+		writer.Add(SectionID::Meshes, scene.meshes);
+		writer.Add(SectionID::Instances, scene.instances);
+
+		const SphereSoA& spheres = scene.sphereSoA;
+		writer.Add(SectionID::SphereBVHNodes, scene.sphereBVH.GetNodes());
+		writer.Add(SectionID::SphereBVHIndices, scene.sphereBVH.GetPrimitiveIndices());
+		writer.Add(SectionID::SphereX, spheres.x);
+		writer.Add(SectionID::SphereY, spheres.y);
+		writer.Add(SectionID::SphereZ, spheres.z);
+		writer.Add(SectionID::SphereRadius2, spheres.radius2);
+		writer.Add(SectionID::SphereMaterial, spheres.materialID);
+
+		// BLAS 的图元顺序放在网格对应的三角形区间；顶层 BVH 很小，加载时重建
+		std::vector<BVHNode> meshNodes;
+		std::vector<uint32_t> meshNodeCounts;
+		std::vector<uint32_t> meshPrimIndices(scene.GetTriangleCount());
+		for (size_t m = 0; m < scene.meshes.size(); m++)
+		{
+			const BVH& blas = scene.meshBVHs[m];
+			meshNodes.insert(meshNodes.end(), blas.GetNodes().begin(), blas.GetNodes().end());
+			meshNodeCounts.push_back(blas.GetNodeCount());
+			std::copy(blas.GetPrimitiveIndices().begin(), blas.GetPrimitiveIndices().end(),
+				meshPrimIndices.begin() + scene.meshes[m].firstIndex / 3);
+		}
+		writer.Add(SectionID::MeshBVHNodes, meshNodes);
+		writer.Add(SectionID::MeshBVHNodeCounts, meshNodeCounts);
+		writer.Add(SectionID::MeshBVHIndices, meshPrimIndices);
+
+		const TriangleSoA& triangles = scene.triangleSoA;
+		writer.Add(SectionID::TriangleV0X, triangles.v0x);
+		writer.Add(SectionID::TriangleV0Y, triangles.v0y);
+		writer.Add(SectionID::TriangleV0Z, triangles.v0z);
+		writer.Add(SectionID::TriangleE1X, triangles.e1x);
+		writer.Add(SectionID::TriangleE1Y, triangles.e1y);
+		writer.Add(SectionID::TriangleE1Z, triangles.e1z);
+		writer.Add(SectionID::TriangleE2X, triangles.e2x);
+		writer.Add(SectionID::TriangleE2Y, triangles.e2y);
+		writer.Add(SectionID::TriangleE2Z, triangles.e2z);
+
+		return writer.Write(path);
+	}
+
+	bool LoadBinary(const std::string& path, Scene& scene, Camera* camera)
+	{
+		auto file = std::make_shared<MappedFile>();
+		if (!file->Open(path))
+			return false;
+		BinaryReader reader;
+		if (!reader.Open(file))
+			return false;
+
+		Scene loaded;
+		loaded.backingFile = file;
+
+		// 可编辑的小数组复制出来
+		std::vector<DirectionalLight> directionalLight;
+		std::vector<CameraData> cameraData;
+		if (!reader.Copy(SectionID::Materials, loaded.materials) ||
+			!reader.Copy(SectionID::Spheres, loaded.spheres) ||
+			!reader.Copy(SectionID::PointLights, loaded.pointLights) ||
+			!reader.Copy(SectionID::Meshes, loaded.meshes) ||
+			!reader.Copy(SectionID::Instances, loaded.instances) ||
+			!reader.Copy(SectionID::DirectionalLight, directionalLight) ||
+			!reader.Copy(SectionID::Camera, cameraData))
+			return false;
+		if (!directionalLight.empty())
+			loaded.directionalLight = directionalLight[0];
+
+		// 大数组直接引用映射内存
+		if (!reader.View(SectionID::Vertices, loaded.vertices) || !reader.View(SectionID::Indices, loaded.indices))
+			return false;
+		for (const Mesh& mesh : loaded.meshes)
+			if (mesh.firstIndex % 3 != 0 || (uint64_t)mesh.firstIndex + (uint64_t)mesh.triangleCount * 3 > loaded.indices.size())
+				return false;
+		for (uint32_t index : loaded.indices)
+			if (index >= loaded.vertices.size())
+				return false;
+
+		const BVHNode* nodes;
+		const uint32_t* primIndices;
+		size_t nodeCount, primCount;
+
+		// 球体 BVH 和 SoA；缺失或不一致时加载后重建
+		SphereSoA& spheres = loaded.sphereSoA;
+		bool sphereOK = reader.Get(SectionID::SphereBVHNodes, nodes, nodeCount) &&
+			reader.Get(SectionID::SphereBVHIndices, primIndices, primCount) &&
+			reader.View(SectionID::SphereX, spheres.x) && reader.View(SectionID::SphereY, spheres.y) &&
+			reader.View(SectionID::SphereZ, spheres.z) && reader.View(SectionID::SphereRadius2, spheres.radius2) &&
+			reader.View(SectionID::SphereMaterial, spheres.materialID);
+		if (!sphereOK)
+			return false;
+		loaded.sphereBVH.SetExternalData(nodes, (uint32_t)nodeCount, primIndices, (uint32_t)primCount);
+		size_t paddedCount = loaded.spheres.size() + SphereSoA::MaxLaneCount;
+		spheres.count = (uint32_t)loaded.spheres.size();
+		loaded.sphereBVHNeedsRebuild = !IsValidBVH(loaded.sphereBVH, loaded.spheres.size()) ||
+			spheres.x.size() < paddedCount || spheres.y.size() < paddedCount || spheres.z.size() < paddedCount ||
+			spheres.radius2.size() < paddedCount || spheres.materialID.size() < paddedCount;
+		// 着色按 SoA 里的材质下标取材质，映射的这份也要检查
+		for (uint32_t i = 0; !loaded.sphereBVHNeedsRebuild && i < spheres.count; i++)
+			loaded.sphereBVHNeedsRebuild = spheres.materialID[i] >= loaded.materials.size();
+
+		// 各网格的 BLAS 和三角形 SoA；任何一个不一致就全部重建
+		TriangleSoA& triangles = loaded.triangleSoA;
+		const uint32_t* nodeCounts;
+		size_t meshCount;
+		bool triangleOK = reader.Get(SectionID::MeshBVHNodes, nodes, nodeCount) &&
+			reader.Get(SectionID::MeshBVHNodeCounts, nodeCounts, meshCount) &&
+			reader.Get(SectionID::MeshBVHIndices, primIndices, primCount);
+		for (auto& section : std::initializer_list<std::pair<SectionID, Buffer<float>*>>{
+			{ SectionID::TriangleV0X, &triangles.v0x }, { SectionID::TriangleV0Y, &triangles.v0y }, { SectionID::TriangleV0Z, &triangles.v0z },
+			{ SectionID::TriangleE1X, &triangles.e1x }, { SectionID::TriangleE1Y, &triangles.e1y }, { SectionID::TriangleE1Z, &triangles.e1z },
+			{ SectionID::TriangleE2X, &triangles.e2x }, { SectionID::TriangleE2Y, &triangles.e2y }, { SectionID::TriangleE2Z, &triangles.e2z } })
+		{
+			triangleOK = triangleOK && reader.View(section.first, *section.second);
+		}
+		if (!triangleOK)
+			return false;
+		uint32_t triangleCount = loaded.GetTriangleCount();
+		triangles.count = triangleCount;
+		bool blasComplete = meshCount == loaded.meshes.size() && primCount == triangleCount;
+		for (const Buffer<float>* values : { &triangles.v0x, &triangles.v0y, &triangles.v0z,
+			&triangles.e1x, &triangles.e1y, &triangles.e1z, &triangles.e2x, &triangles.e2y, &triangles.e2z })
+			blasComplete = blasComplete && values->size() == triangleCount;
+		size_t firstNode = 0;
+		for (size_t m = 0; blasComplete && m < meshCount; m++)
+		{
+			const Mesh& mesh = loaded.meshes[m];
+			if (nodeCounts[m] > nodeCount - firstNode)
+			{
+				blasComplete = false;
+				break;
+			}
+			loaded.meshBVHs.emplace_back();
+			loaded.meshBVHs.back().SetExternalData(nodes + firstNode, nodeCounts[m], primIndices + mesh.firstIndex / 3, mesh.triangleCount);
+			blasComplete = IsValidBVH(loaded.meshBVHs.back(), mesh.triangleCount);
+			firstNode += nodeCounts[m];
+		}
+		if (!blasComplete)
+			loaded.meshBVHs.clear();
+
+		for (const Sphere& sphere : loaded.spheres)
+			if (sphere.materialID >= loaded.materials.size())
+				return false;
+		for (const MeshInstance& instance : loaded.instances)
+			if (instance.meshID >= loaded.meshes.size() || instance.materialID >= loaded.materials.size())
+				return false;
+
+		scene = std::move(loaded);
+		if (camera && !cameraData.empty())
+		{
+			camera->SetPosition(cameraData[0].position);
+			camera->SetDirection(cameraData[0].direction);
+			camera->SetVerticalFOV(cameraData[0].verticalFOV);
+		}
+		return true;
+	}
+
+	bool SaveJSON(const std::string& path, const Scene& scene, const Camera* camera)
+	{
+		FILE* file = fopen(path.c_str(), "w");
+		if (!file)
+			return false;
+
+		fprintf(file, "{\n  \"version\": %u", Version);
+		if (camera)
+		{
+			fprintf(file, ",\n  \"camera\": { \"position\": ");
+			WriteVec3(file, camera->GetPosition());
+			fprintf(file, ", \"direction\": ");
+			WriteVec3(file, camera->GetDirection());
+			fprintf(file, ", \"verticalFOV\": %.9g }", camera->GetVerticalFOV());
+		}
+
+		fprintf(file, ",\n  \"materials\": [");
+		for (size_t i = 0; i < scene.materials.size(); i++)
+		{
+			const Material& material = scene.materials[i];
+			fprintf(file, "%s\n    { \"albedo\": ", i ? "," : "");
+			WriteVec3(file, material.albedo);
+			fprintf(file, ", \"metallic\": %.9g, \"roughness\": %.9g, \"emissionColor\": ", material.metallic, material.roughness);
+			WriteVec3(file, material.emissionColor);
+			fprintf(file, ", \"emissionPower\": %.9g }", material.emissionPower);
+		}
+
+		fprintf(file, "\n  ],\n  \"spheres\": [");
+		for (size_t i = 0; i < scene.spheres.size(); i++)
+		{
+			const Sphere& sphere = scene.spheres[i];
+			fprintf(file, "%s\n    { \"position\": ", i ? "," : "");
+			WriteVec3(file, sphere.position);
+			fprintf(file, ", \"radius\": %.9g, \"material\": %u }", sphere.radius, sphere.materialID);
+		}
+
+		const DirectionalLight& light = scene.directionalLight;
+		fprintf(file, "\n  ],\n  \"directionalLight\": { \"direction\": ");
+		WriteVec3(file, light.direction);
+		fprintf(file, ", \"color\": ");
+		WriteVec3(file, light.color);
+		fprintf(file, ", \"intensity\": %.9g },\n  \"pointLights\": [", light.intensity);
+		for (size_t i = 0; i < scene.pointLights.size(); i++)
+		{
+			const PointLight& pointLight = scene.pointLights[i];
+			fprintf(file, "%s\n    { \"position\": ", i ? "," : "");
+			WriteVec3(file, pointLight.position);
+			fprintf(file, ", \"color\": ");
+			WriteVec3(file, pointLight.color);
+			fprintf(file, ", \"intensity\": %.9g, \"range\": %.9g }", pointLight.intensity, pointLight.range);
+		}
+
+		// 网格内联写出，顶点只保留该网格引用到的区间
+		fprintf(file, "\n  ],\n  \"meshes\": [");
+		for (size_t i = 0; i < scene.meshes.size(); i++)
+		{
+			const Mesh& mesh = scene.meshes[i];
+			const uint32_t* meshIndices = scene.indices.data() + mesh.firstIndex;
+			uint32_t indexCount = mesh.triangleCount * 3;
+			uint32_t firstVertex = indexCount ? *std::min_element(meshIndices, meshIndices + indexCount) : 0;
+			uint32_t lastVertex = indexCount ? *std::max_element(meshIndices, meshIndices + indexCount) + 1 : 0;
+
+			fprintf(file, "%s\n    { \"positions\": [", i ? "," : "");
+			for (uint32_t v = firstVertex; v < lastVertex; v++)
+			{
+				const glm::vec3& p = scene.vertices[v];
+				fprintf(file, "%s%.9g, %.9g, %.9g", v > firstVertex ? ", " : "", p.x, p.y, p.z);
+			}
+			fprintf(file, "],\n      \"indices\": [");
+			for (uint32_t k = 0; k < indexCount; k++)
+				fprintf(file, "%s%u", k ? ", " : "", meshIndices[k] - firstVertex);
+			fprintf(file, "] }");
+		}
+
+		fprintf(file, "\n  ],\n  \"instances\": [");
+		for (size_t i = 0; i < scene.instances.size(); i++)
+		{
+			const MeshInstance& instance = scene.instances[i];
+			fprintf(file, "%s\n    { \"mesh\": %u, \"material\": %u, \"position\": ", i ? "," : "", instance.meshID, instance.materialID);
+			WriteVec3(file, instance.position);
+			fprintf(file, ", \"rotation\": ");
+			WriteVec3(file, instance.rotation);
+			fprintf(file, ", \"scale\": ");
+			WriteVec3(file, instance.scale);
+			fprintf(file, " }");
+		}
+		fprintf(file, "\n  ]\n}\n");
+
+		bool ok = !ferror(file);
+		fclose(file);
+		return ok;
+	}
+
+	bool LoadJSON(const std::string& path, Scene& scene, Camera* camera)
+	{
+		MappedFile file;
+		if (!file.Open(path))
+			return false;
+
+		JsonValue root;
+		JsonParser parser(file.GetData(), file.GetData() + file.GetSize());
+		if (!parser.Parse(root) || root.type != JsonValue::Type::Object)
+			return false;
+
+		Scene loaded;
+		if (const JsonValue* materials = root.Find("materials"))
+		{
+			for (const JsonValue& value : materials->array)
+			{
+				Material material;
+				material.albedo = value.GetVec3("albedo", material.albedo);
+				material.metallic = value.GetFloat("metallic", material.metallic);
+				material.roughness = value.GetFloat("roughness", material.roughness);
+				material.emissionColor = value.GetVec3("emissionColor", material.emissionColor);
+				material.emissionPower = value.GetFloat("emissionPower", material.emissionPower);
+				loaded.AddMaterial(material);
+			}
+		}
+		if (loaded.materials.empty())
+			loaded.AddMaterial(Material());
+		auto getMaterial = [&](const JsonValue& value)
+			{
+				uint32_t materialID = (uint32_t)value.GetFloat("material", 0.0f);
+				return std::min(materialID, (uint32_t)loaded.materials.size() - 1);
+			};
+
+		if (const JsonValue* spheres = root.Find("spheres"))
+		{
+			for (const JsonValue& value : spheres->array)
+			{
+				Sphere sphere;
+				sphere.position = value.GetVec3("position", sphere.position);
+				sphere.radius = value.GetFloat("radius", sphere.radius);
+				sphere.materialID = getMaterial(value);
+				loaded.AddSphere(sphere);
+			}
+		}
+
+		if (const JsonValue* light = root.Find("directionalLight"))
+		{
+			DirectionalLight& directional = loaded.directionalLight;
+			directional.direction = light->GetVec3("direction", directional.direction);
+			directional.color = light->GetVec3("color", directional.color);
+			directional.intensity = light->GetFloat("intensity", directional.intensity);
+		}
+
+		if (const JsonValue* pointLights = root.Find("pointLights"))
+		{
+			for (const JsonValue& value : pointLights->array)
+			{
+				PointLight light;
+				loaded.AddPointLight(value.GetVec3("position", light.position), value.GetVec3("color", light.color),
+					value.GetFloat("intensity", light.intensity), value.GetFloat("range", light.range));
+			}
+		}
+
+		if (const JsonValue* meshes = root.Find("meshes"))
+		{
+			// "path" 相对于 JSON 文件所在目录
+			std::string directory = path.substr(0, path.find_last_of("/\\") + 1);
+			for (const JsonValue& value : meshes->array)
+			{
+				MeshData mesh;
+				const JsonValue* meshPath = value.Find("path");
+				if (meshPath && meshPath->type == JsonValue::Type::String)
+				{
+					std::string fullPath = meshPath->string;
+					bool absolute = !fullPath.empty() && (fullPath[0] == '/' || fullPath[0] == '\\' || fullPath.find(':') != std::string::npos);
+					if (!MeshLoader::Load(absolute ? fullPath : directory + fullPath, mesh))
+						return false;
+				}
+				else
+				{
+					const JsonValue* positions = value.Find("positions");
+					const JsonValue* indices = value.Find("indices");
+					if (!positions || !indices || positions->array.size() % 3 != 0 || indices->array.size() % 3 != 0)
+						return false;
+					for (size_t i = 0; i < positions->array.size(); i += 3)
+						mesh.positions.emplace_back((float)positions->array[i].number,
+							(float)positions->array[i + 1].number, (float)positions->array[i + 2].number);
+					for (const JsonValue& index : indices->array)
+					{
+						if (index.number < 0.0 || index.number >= (double)mesh.positions.size())
+							return false;
+						mesh.indices.push_back((uint32_t)index.number);
+					}
+				}
+				uint32_t meshID = loaded.AddMesh(mesh.positions, mesh.indices);
+
+				// 没有 "instances" 时每个网格在原位放一个实例，材质写在网格上
+				if (!root.Find("instances"))
+				{
+					MeshInstance instance;
+					instance.meshID = meshID;
+					instance.materialID = getMaterial(value);
+					loaded.AddInstance(instance);
+				}
+			}
+		}
+
+		if (const JsonValue* instances = root.Find("instances"))
+		{
+			for (const JsonValue& value : instances->array)
+			{
+				MeshInstance instance;
+				instance.meshID = (uint32_t)value.GetFloat("mesh", 0.0f);
+				if (instance.meshID >= loaded.meshes.size())
+					return false;
+				instance.materialID = getMaterial(value);
+				instance.position = value.GetVec3("position", instance.position);
+				instance.rotation = value.GetVec3("rotation", instance.rotation);
+				instance.scale = value.GetVec3("scale", instance.scale);
+				loaded.AddInstance(instance);
+			}
+		}
+
+		scene = std::move(loaded);
+		const JsonValue* cameraValue = root.Find("camera");
+		if (camera && cameraValue)
+		{
+			camera->SetPosition(cameraValue->GetVec3("position", camera->GetPosition()));
+			camera->SetDirection(cameraValue->GetVec3("direction", camera->GetDirection()));
+			camera->SetVerticalFOV(cameraValue->GetFloat("verticalFOV", camera->GetVerticalFOV()));
+		}
+		return true;
+	}
+
+	bool Save(const std::string& path, Scene& scene, const Camera* camera)
+	{
+		return HasJSONExtension(path) ? SaveJSON(path, scene, camera) : SaveBinary(path, scene, camera);
+	}
+
+	bool Load(const std::string& path, Scene& scene, Camera* camera)
+	{
+		return HasJSONExtension(path) ? LoadJSON(path, scene, camera) : LoadBinary(path, scene, camera);
+	}
+
+}
@@ -0,0 +1,31 @@
+﻿#pragma once
+
+#include "Scene.h"
+#include "Camera.h"
+
+#include <string>
+
+// 场景的二进制格式 (.rtscene) 和 JSON 格式
+//
+// 二进制文件：文件头 + 段表，每段 64 字节对齐，内容就是内存中的数组。
+// 加载时 mmap 整个文件，顶点、索引、BVH 和 SoA 直接引用映射内存 (Buffer::SetView)，
+// 不解析也不复制；材质、球体、灯光等可编辑的小数组复制出来。
+// 保存前会先更新 BVH，加载后无需重新构建 (顶层 BVH 很小，加载时按实例重建)。
+// 文件只能在相同字节序的机器之间共享。
+//
+// JSON 用于手工编写场景，不包含加速结构；网格可以内联顶点，也可以用 "path" 引用 .obj/.ply，
+// "instances" 引用网格编号并给出变换和材质。
+namespace SceneSerializer {
+
+	// camera 可以为空
+	bool SaveBinary(const std::string& path, Scene& scene, const Camera* camera);
+	bool LoadBinary(const std::string& path, Scene& scene, Camera* camera);
+
+	bool SaveJSON(const std::string& path, const Scene& scene, const Camera* camera);
+	bool LoadJSON(const std::string& path, Scene& scene, Camera* camera);
+
+	// 按扩展名 (.json / 其他为二进制) 选择格式
+	bool Save(const std::string& path, Scene& scene, const Camera* camera);
+	bool Load(const std::string& path, Scene& scene, Camera* camera);
+
+}
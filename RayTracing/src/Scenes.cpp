@@ -0,0 +1,153 @@
+﻿#include "Scenes.h"
+#include "Random.h"
+
+#include <cmath>
+
+namespace Scenes {
+
+	Scene CreateDefaultScene()
+	{
+		Scene scene;
+
+		// 创建材质
+		Material groundMat;
+		groundMat.albedo = { 0.2f, 0.3f, 0.1f };
+		groundMat.roughness = 0.9f;
+		uint32_t groundMatID = scene.AddMaterial(groundMat);
+
+		Material sphereMat; // 铜色材质
+		sphereMat.albedo = { 0.8f, 0.5f, 0.2f };
+		sphereMat.metallic = 0.5f;
+		uint32_t sphereMatID = scene.AddMaterial(sphereMat);
+
+		Material blueSphereMat; // 蓝色材质 - 新增
+		blueSphereMat.albedo = { 0.2f, 0.3f, 0.8f };
+		blueSphereMat.metallic = 0.9f;
+		blueSphereMat.roughness = 0.2f;
+		uint32_t blueMatID = scene.AddMaterial(blueSphereMat);
+
+		// 创建球体并分配材质
+		{
+			Sphere sphere;
+			sphere.position = { 0.0f, -101.0f, 0.0f };
+			sphere.radius = 100.0f;
+			sphere.materialID = groundMatID; // 地面材质
+			scene.AddSphere(sphere);
+		}
+		{
+			Sphere sphere;  // 中心铜色球
+			sphere.position = { 0.0f, 0.0f, 0.0f };
+			sphere.radius = 1.0f;
+			sphere.materialID = sphereMatID;
+			scene.AddSphere(sphere);
+		}
+		{
+			Sphere sphere;  // 新增蓝色球体
+			sphere.position = { 1.7f, 0.5f, 0.0f };  // 右侧位置，轻微悬浮
+			sphere.radius = 0.7f;  // 比中心球稍小
+			sphere.materialID = blueMatID; // 新材质
+			scene.AddSphere(sphere);
+		}
+
+		return scene;
+	}
+
+	namespace {
+
+		Scene CreateSphereField(uint32_t count, uint32_t seed, bool glossy)
+		{
+			Scene scene;
+			Material groundMat;
+			groundMat.albedo = { 0.5f, 0.5f, 0.5f };
+			groundMat.roughness = 0.9f;
+			Sphere ground;
+			ground.position = { 0.0f, -1000.0f, 0.0f };
+			ground.radius = 1000.0f;
+			ground.materialID = scene.AddMaterial(groundMat);
+			scene.AddSphere(ground);
+
+			// 少量共享材质，球体数量很大时材质表也不会变大
+			constexpr uint32_t MaterialCount = 16;
+			uint32_t state = Utils::PCG_Hash(seed);
+			uint32_t firstMaterial = (uint32_t)scene.materials.size();
+			for (uint32_t i = 0; i < MaterialCount; i++)
+			{
+				Material material;
+				material.albedo = Utils::RandomVec3(state, 0.2f, 0.9f);
+				material.metallic = glossy ? 0.9f + 0.1f * Utils::RandomFloat(state) : Utils::RandomFloat(state);
+				material.roughness = glossy ? 0.05f + 0.15f * Utils::RandomFloat(state) : Utils::RandomFloat(state);
+				scene.AddMaterial(material);
+			}
+
+			// 每个球平均占 4 个单位面积
+			float halfExtent = std::sqrt((float)count);
+			for (uint32_t i = 0; i < count; i++)
+			{
+				Sphere sphere;
+				sphere.radius = 0.2f + 0.3f * Utils::RandomFloat(state);
+				sphere.position = glm::vec3(
+					(Utils::RandomFloat(state) * 2.0f - 1.0f) * halfExtent,
+					sphere.radius,
+					(Utils::RandomFloat(state) * 2.0f - 1.0f) * halfExtent - halfExtent);
+				sphere.materialID = firstMaterial + glm::min((uint32_t)(Utils::RandomFloat(state) * MaterialCount), MaterialCount - 1);
+				scene.AddSphere(sphere);
+			}
+			return scene;
+		}
+
+	}
+
+	Scene CreateRandomSpheresScene(uint32_t count, uint32_t seed)
+	{
+		return CreateSphereField(count, seed, false);
+	}
+
+	Scene CreateGlossyScene(uint32_t count, uint32_t seed)
+	{
+		return CreateSphereField(count, seed, true);
+	}
+
+	void AddRandomPointLights(Scene& scene, uint32_t count, uint32_t seed)
+	{
+		uint32_t state = Utils::PCG_Hash(seed);
+		for (uint32_t i = 0; i < count; i++)
+		{
+			glm::vec3 position(
+				Utils::RandomFloat(state) * 20.0f - 10.0f,
+				Utils::RandomFloat(state) * 3.0f - 0.5f,
+				Utils::RandomFloat(state) * 20.0f - 10.0f);
+			glm::vec3 color = Utils::RandomVec3(state, 0.2f, 1.0f);
+			float intensity = 0.5f + Utils::RandomFloat(state) * 2.0f;
+			float range = 1.0f + Utils::RandomFloat(state) * 4.0f;
+			scene.AddPointLight(position, color, intensity, range);
+		}
+	}
+
+	void AddInstanceGrid(Scene& scene, uint32_t meshID, uint32_t materialID, uint32_t count, uint32_t seed)
+	{
+		const Mesh& mesh = scene.meshes[meshID];
+		if (mesh.triangleCount == 0)
+			return;
+		AABB bounds;
+		for (uint32_t i = 0; i < mesh.triangleCount * 3; i++)
+			bounds.Grow(scene.vertices[scene.indices[mesh.firstIndex + i]]);
+
+		glm::vec3 extent = bounds.max - bounds.min;
+		float spacing = glm::max(extent.x, extent.z) * 1.5f;
+		uint32_t columns = (uint32_t)std::ceil(std::sqrt((float)count));
+		uint32_t state = Utils::PCG_Hash(seed);
+		for (uint32_t i = 0; i < count; i++)
+		{
+			MeshInstance instance;
+			instance.meshID = meshID;
+			instance.materialID = materialID;
+			instance.position = glm::vec3(
+				((float)(i % columns) - 0.5f * (columns - 1)) * spacing,
+				0.0f,
+				((float)(i / columns) - 0.5f * (columns - 1)) * spacing);
+			instance.rotation.y = Utils::RandomFloat(state) * 360.0f;
+			scene.AddInstance(instance);
+		}
+	}
+
+}
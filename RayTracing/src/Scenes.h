@@ -0,0 +1,22 @@
+﻿#pragma once
+
+#include "Scene.h"
+
+namespace Scenes {
+
+	// 铜色球 + 蓝色金属球 + 地面
+	Scene CreateDefaultScene();
+
+	// 地面 + count 个随机大小和材质的小球，铺在以原点为中心的正方形区域内，密度与数量无关
+	Scene CreateRandomSpheresScene(uint32_t count, uint32_t seed = 0);
+
+	// 同上，但全部是低粗糙度的金属球，路径主要由镜面反射组成
+	Scene CreateGlossyScene(uint32_t count, uint32_t seed = 0);
+
+	// 在地面上方随机撒 count 个彩色点光源，用于测试多光源采样
+	void AddRandomPointLights(Scene& scene, uint32_t count, uint32_t seed = 0);
+
+	// 网格原点在 XZ 平面上排成 count 个实例的方阵，每个实例随机绕 Y 旋转，用于测试实例化
+	void AddInstanceGrid(Scene& scene, uint32_t meshID, uint32_t materialID, uint32_t count, uint32_t seed = 0);
+
+}
@@ -0,0 +1,426 @@
+﻿#include "SphereSoA.h"
+
+#include <cfloat>
+
+#if defined(__x86_64__) || defined(_M_X64)
+	#define RT_X64 1
+	#include <immintrin.h>
+	#if defined(_MSC_VER)
+		#include <intrin.h>
+		#define RT_TARGET(x)
+	#else
+		#define RT_TARGET(x) __attribute__((target(x)))
+	#endif
+#else
+	#define RT_X64 0
+#endif
+
+// 射线-球体: a = d·d, b = oc·d, c = oc·oc - r²，判别式 b² - ac，t = (-b - √disc) / a
+// 只取近交点 (与原标量版本一致)，射线起点在球内时不算命中
+
+namespace {
+
+	using ClosestKernel = bool(*)(const SphereSoA&, uint32_t, uint32_t, const glm::vec3&, const glm::vec3&, float&, uint32_t&);
+	using AnyKernel = bool(*)(const SphereSoA&, uint32_t, uint32_t, const glm::vec3&, const glm::vec3&, float, float);
+
+	bool IntersectClosestScalar(const SphereSoA& s, uint32_t first, uint32_t count,
+		const glm::vec3& o, const glm::vec3& d, float& tMax, uint32_t& hitIndex)
+	{
+		float a = glm::dot(d, d);
+		float invA = 1.0f / a;
+		bool hit = false;
+		for (uint32_t i = first; i < first + count; i++)
+		{
+			glm::vec3 oc(o.x - s.x[i], o.y - s.y[i], o.z - s.z[i]);
+			float b = glm::dot(oc, d);
+			float c = glm::dot(oc, oc) - s.radius2[i];
+			float disc = b * b - a * c;
+			if (disc <= 0.0f)
+				continue;
+			float t = (-b - glm::sqrt(disc)) * invA;
+			if (t >= 0.0f && t < tMax)
+			{
+				tMax = t;
+				hitIndex = i;
+				hit = true;
+			}
+		}
+		return hit;
+	}
+
+	bool IntersectAnyScalar(const SphereSoA& s, uint32_t first, uint32_t count,
+		const glm::vec3& o, const glm::vec3& d, float tMin, float tMax)
+	{
+		float a = glm::dot(d, d);
+		float invA = 1.0f / a;
+		for (uint32_t i = first; i < first + count; i++)
+		{
+			glm::vec3 oc(o.x - s.x[i], o.y - s.y[i], o.z - s.z[i]);
+			float b = glm::dot(oc, d);
+			float c = glm::dot(oc, oc) - s.radius2[i];
+			float disc = b * b - a * c;
+			if (disc <= 0.0f)
+				continue;
+			float t = (-b - glm::sqrt(disc)) * invA;
+			if (t >= 0.0f && t > tMin && t < tMax)
+				return true;
+		}
+		return false;
+	}
+
+#if RT_X64
+
+	uint32_t LowestLane(uint32_t mask)
+	{
+	#if defined(_MSC_VER)
+		unsigned long index;
+		_BitScanForward(&index, mask);
+		return (uint32_t)index;
+	#else
+		return (uint32_t)__builtin_ctz(mask);
+	#endif
+	}
+
+	RT_TARGET("sse2")
+	__m128 DistancesSSE(const SphereSoA& s, uint32_t i, __m128 ox, __m128 oy, __m128 oz,
+		__m128 dx, __m128 dy, __m128 dz, __m128 a, __m128 invA, __m128& valid)
+	{
+		__m128 ocx = _mm_sub_ps(ox, _mm_loadu_ps(&s.x[i]));
+		__m128 ocy = _mm_sub_ps(oy, _mm_loadu_ps(&s.y[i]));
+		__m128 ocz = _mm_sub_ps(oz, _mm_loadu_ps(&s.z[i]));
+		__m128 b = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ocx, dx), _mm_mul_ps(ocy, dy)), _mm_mul_ps(ocz, dz));
+		__m128 c = _mm_sub_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(ocx, ocx), _mm_mul_ps(ocy, ocy)), _mm_mul_ps(ocz, ocz)),
+			_mm_loadu_ps(&s.radius2[i]));
+		__m128 disc = _mm_sub_ps(_mm_mul_ps(b, b), _mm_mul_ps(a, c));
+		valid = _mm_cmpgt_ps(disc, _mm_setzero_ps());
+		__m128 t = _mm_mul_ps(_mm_sub_ps(_mm_sub_ps(_mm_setzero_ps(), b), _mm_sqrt_ps(disc)), invA);
+		valid = _mm_and_ps(valid, _mm_cmpge_ps(t, _mm_setzero_ps()));
+		return t;
+	}
+
+	RT_TARGET("sse2")
+	__m128 LaneMaskSSE(uint32_t remaining)
+	{
+		__m128i lanes = _mm_setr_epi32(0, 1, 2, 3);
+		return _mm_castsi128_ps(_mm_cmpgt_epi32(_mm_set1_epi32((int)remaining), lanes));
+	}
+
+	RT_TARGET("sse2")
+	bool IntersectClosestSSE(const SphereSoA& s, uint32_t first, uint32_t count,
+		const glm::vec3& o, const glm::vec3& d, float& tMax, uint32_t& hitIndex)
+	{
+		float aScalar = glm::dot(d, d);
+		__m128 ox = _mm_set1_ps(o.x), oy = _mm_set1_ps(o.y), oz = _mm_set1_ps(o.z);
+		__m128 dx = _mm_set1_ps(d.x), dy = _mm_set1_ps(d.y), dz = _mm_set1_ps(d.z);
+		__m128 a = _mm_set1_ps(aScalar), invA = _mm_set1_ps(1.0f / aScalar);
+		bool hit = false;
+		for (uint32_t i = 0; i < count; i += 4)
+		{
+			__m128 valid;
+			__m128 t = DistancesSSE(s, first + i, ox, oy, oz, dx, dy, dz, a, invA, valid);
+			valid = _mm_and_ps(valid, LaneMaskSSE(count - i));
+			valid = _mm_and_ps(valid, _mm_cmplt_ps(t, _mm_set1_ps(tMax)));
+			int mask = _mm_movemask_ps(valid);
+			if (!mask)
+				continue;
+
+			alignas(16) float ts[4];
+			_mm_store_ps(ts, t);
+			for (uint32_t lane = 0; lane < 4; lane++)
+			{
+				if ((mask & (1 << lane)) && ts[lane] < tMax)
+				{
+					tMax = ts[lane];
+					hitIndex = first + i + lane;
+				}
+			}
+			hit = true;
+		}
+		return hit;
+	}
+
+	RT_TARGET("sse2")
+	bool IntersectAnySSE(const SphereSoA& s, uint32_t first, uint32_t count,
+		const glm::vec3& o, const glm::vec3& d, float tMin, float tMax)
+	{
+		float aScalar = glm::dot(d, d);
+		__m128 ox = _mm_set1_ps(o.x), oy = _mm_set1_ps(o.y), oz = _mm_set1_ps(o.z);
+		__m128 dx = _mm_set1_ps(d.x), dy = _mm_set1_ps(d.y), dz = _mm_set1_ps(d.z);
+		__m128 a = _mm_set1_ps(aScalar), invA = _mm_set1_ps(1.0f / aScalar);
+		__m128 vMin = _mm_set1_ps(tMin), vMax = _mm_set1_ps(tMax);
+		for (uint32_t i = 0; i < count; i += 4)
+		{
+			__m128 valid;
+			__m128 t = DistancesSSE(s, first + i, ox, oy, oz, dx, dy, dz, a, invA, valid);
+			valid = _mm_and_ps(valid, LaneMaskSSE(count - i));
+			valid = _mm_and_ps(valid, _mm_and_ps(_mm_cmpgt_ps(t, vMin), _mm_cmplt_ps(t, vMax)));
+			if (_mm_movemask_ps(valid))
+				return true;
+		}
+		return false;
+	}
+
+	RT_TARGET("avx2,fma")
+	__m256 DistancesAVX2(const SphereSoA& s, uint32_t i, __m256 ox, __m256 oy, __m256 oz,
+		__m256 dx, __m256 dy, __m256 dz, __m256 a, __m256 invA, __m256& valid)
+	{
+		__m256 ocx = _mm256_sub_ps(ox, _mm256_loadu_ps(&s.x[i]));
+		__m256 ocy = _mm256_sub_ps(oy, _mm256_loadu_ps(&s.y[i]));
+		__m256 ocz = _mm256_sub_ps(oz, _mm256_loadu_ps(&s.z[i]));
+		__m256 b = _mm256_fmadd_ps(ocz, dz, _mm256_fmadd_ps(ocy, dy, _mm256_mul_ps(ocx, dx)));
+		__m256 c = _mm256_fmadd_ps(ocz, ocz, _mm256_fmadd_ps(ocy, ocy, _mm256_mul_ps(ocx, ocx)));
+		c = _mm256_sub_ps(c, _mm256_loadu_ps(&s.radius2[i]));
+		__m256 disc = _mm256_fmsub_ps(b, b, _mm256_mul_ps(a, c));
+		valid = _mm256_cmp_ps(disc, _mm256_setzero_ps(), _CMP_GT_OQ);
+		__m256 t = _mm256_mul_ps(_mm256_sub_ps(_mm256_sub_ps(_mm256_setzero_ps(), b), _mm256_sqrt_ps(disc)), invA);
+		valid = _mm256_and_ps(valid, _mm256_cmp_ps(t, _mm256_setzero_ps(), _CMP_GE_OQ));
+		return t;
+	}
+
+	RT_TARGET("avx2,fma")
+	__m256 LaneMaskAVX2(uint32_t remaining)
+	{
+		__m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+		return _mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_set1_epi32((int)remaining), lanes));
+	}
+
+	RT_TARGET("avx2,fma")
+	bool IntersectClosestAVX2(const SphereSoA& s, uint32_t first, uint32_t count,
+		const glm::vec3& o, const glm::vec3& d, float& tMax, uint32_t& hitIndex)
+	{
+		float aScalar = glm::dot(d, d);
+		__m256 ox = _mm256_set1_ps(o.x), oy = _mm256_set1_ps(o.y), oz = _mm256_set1_ps(o.z);
+		__m256 dx = _mm256_set1_ps(d.x), dy = _mm256_set1_ps(d.y), dz = _mm256_set1_ps(d.z);
+		__m256 a = _mm256_set1_ps(aScalar), invA = _mm256_set1_ps(1.0f / aScalar);
+		bool hit = false;
+		for (uint32_t i = 0; i < count; i += 8)
+		{
+			__m256 valid;
+			__m256 t = DistancesAVX2(s, first + i, ox, oy, oz, dx, dy, dz, a, invA, valid);
+			valid = _mm256_and_ps(valid, LaneMaskAVX2(count - i));
+			valid = _mm256_and_ps(valid, _mm256_cmp_ps(t, _mm256_set1_ps(tMax), _CMP_LT_OQ));
+			if (!_mm256_movemask_ps(valid))
+				continue;
+
+			// 水平求最小值，再找出对应的通道
+			__m256 tm = _mm256_blendv_ps(_mm256_set1_ps(FLT_MAX), t, valid);
+			__m256 m = _mm256_min_ps(tm, _mm256_permute2f128_ps(tm, tm, 1));
+			m = _mm256_min_ps(m, _mm256_shuffle_ps(m, m, _MM_SHUFFLE(1, 0, 3, 2)));
+			m = _mm256_min_ps(m, _mm256_shuffle_ps(m, m, _MM_SHUFFLE(2, 3, 0, 1)));
+			int lanes = _mm256_movemask_ps(_mm256_and_ps(valid, _mm256_cmp_ps(tm, m, _CMP_EQ_OQ)));
+
+			tMax = _mm256_cvtss_f32(m);
+			hitIndex = first + i + LowestLane((uint32_t)lanes);
+			hit = true;
+		}
+		return hit;
+	}
+
+	RT_TARGET("avx2,fma")
+	bool IntersectAnyAVX2(const SphereSoA& s, uint32_t first, uint32_t count,
+		const glm::vec3& o, const glm::vec3& d, float tMin, float tMax)
+	{
+		float aScalar = glm::dot(d, d);
+		__m256 ox = _mm256_set1_ps(o.x), oy = _mm256_set1_ps(o.y), oz = _mm256_set1_ps(o.z);
+		__m256 dx = _mm256_set1_ps(d.x), dy = _mm256_set1_ps(d.y), dz = _mm256_set1_ps(d.z);
+		__m256 a = _mm256_set1_ps(aScalar), invA = _mm256_set1_ps(1.0f / aScalar);
+		__m256 vMin = _mm256_set1_ps(tMin), vMax = _mm256_set1_ps(tMax);
+		for (uint32_t i = 0; i < count; i += 8)
+		{
+			__m256 valid;
+			__m256 t = DistancesAVX2(s, first + i, ox, oy, oz, dx, dy, dz, a, invA, valid);
+			valid = _mm256_and_ps(valid, LaneMaskAVX2(count - i));
+			valid = _mm256_and_ps(valid, _mm256_and_ps(
+				_mm256_cmp_ps(t, vMin, _CMP_GT_OQ), _mm256_cmp_ps(t, vMax, _CMP_LT_OQ)));
+			if (_mm256_movemask_ps(valid))
+				return true;
+		}
+		return false;
+	}
+
+	RT_TARGET("avx512f")
+	__m512 DistancesAVX512(const SphereSoA& s, uint32_t i, __m512 ox, __m512 oy, __m512 oz,
+		__m512 dx, __m512 dy, __m512 dz, __m512 a, __m512 invA, __mmask16& valid)
+	{
+		__m512 ocx = _mm512_sub_ps(ox, _mm512_loadu_ps(&s.x[i]));
+		__m512 ocy = _mm512_sub_ps(oy, _mm512_loadu_ps(&s.y[i]));
+		__m512 ocz = _mm512_sub_ps(oz, _mm512_loadu_ps(&s.z[i]));
+		__m512 b = _mm512_fmadd_ps(ocz, dz, _mm512_fmadd_ps(ocy, dy, _mm512_mul_ps(ocx, dx)));
+		__m512 c = _mm512_fmadd_ps(ocz, ocz, _mm512_fmadd_ps(ocy, ocy, _mm512_mul_ps(ocx, ocx)));
+		c = _mm512_sub_ps(c, _mm512_loadu_ps(&s.radius2[i]));
+		__m512 disc = _mm512_fmsub_ps(b, b, _mm512_mul_ps(a, c));
+		valid = _mm512_cmp_ps_mask(disc, _mm512_setzero_ps(), _CMP_GT_OQ);
+		__m512 t = _mm512_mul_ps(_mm512_sub_ps(_mm512_sub_ps(_mm512_setzero_ps(), b), _mm512_sqrt_ps(disc)), invA);
+		valid &= _mm512_cmp_ps_mask(t, _mm512_setzero_ps(), _CMP_GE_OQ);
+		return t;
+	}
+
+	__mmask16 LaneMaskAVX512(uint32_t remaining)
+	{
+		return remaining >= 16 ? (__mmask16)0xFFFF : (__mmask16)((1u << remaining) - 1);
+	}
+
+	RT_TARGET("avx512f")
+	bool IntersectClosestAVX512(const SphereSoA& s, uint32_t first, uint32_t count,
+		const glm::vec3& o, const glm::vec3& d, float& tMax, uint32_t& hitIndex)
+	{
+		float aScalar = glm::dot(d, d);
+		__m512 ox = _mm512_set1_ps(o.x), oy = _mm512_set1_ps(o.y), oz = _mm512_set1_ps(o.z);
+		__m512 dx = _mm512_set1_ps(d.x), dy = _mm512_set1_ps(d.y), dz = _mm512_set1_ps(d.z);
+		__m512 a = _mm512_set1_ps(aScalar), invA = _mm512_set1_ps(1.0f / aScalar);
+		bool hit = false;
+		for (uint32_t i = 0; i < count; i += 16)
+		{
+			__mmask16 valid;
+			__m512 t = DistancesAVX512(s, first + i, ox, oy, oz, dx, dy, dz, a, invA, valid);
+			valid &= LaneMaskAVX512(count - i);
+			valid &= _mm512_cmp_ps_mask(t, _mm512_set1_ps(tMax), _CMP_LT_OQ);
+			if (!valid)
+				continue;
+
+			float tMin = _mm512_mask_reduce_min_ps(valid, t);
+			__mmask16 lanes = valid & _mm512_cmp_ps_mask(t, _mm512_set1_ps(tMin), _CMP_EQ_OQ);
+			tMax = tMin;
+			hitIndex = first + i + LowestLane((uint32_t)lanes);
+			hit = true;
+		}
+		return hit;
+	}
+
+	RT_TARGET("avx512f")
+	bool IntersectAnyAVX512(const SphereSoA& s, uint32_t first, uint32_t count,
+		const glm::vec3& o, const glm::vec3& d, float tMin, float tMax)
+	{
+		float aScalar = glm::dot(d, d);
+		__m512 ox = _mm512_set1_ps(o.x), oy = _mm512_set1_ps(o.y), oz = _mm512_set1_ps(o.z);
+		__m512 dx = _mm512_set1_ps(d.x), dy = _mm512_set1_ps(d.y), dz = _mm512_set1_ps(d.z);
+		__m512 a = _mm512_set1_ps(aScalar), invA = _mm512_set1_ps(1.0f / aScalar);
+		__m512 vMin = _mm512_set1_ps(tMin), vMax = _mm512_set1_ps(tMax);
+		for (uint32_t i = 0; i < count; i += 16)
+		{
+			__mmask16 valid;
+			__m512 t = DistancesAVX512(s, first + i, ox, oy, oz, dx, dy, dz, a, invA, valid);
+			valid &= LaneMaskAVX512(count - i);
+			valid &= _mm512_cmp_ps_mask(t, vMin, _CMP_GT_OQ) & _mm512_cmp_ps_mask(t, vMax, _CMP_LT_OQ);
+			if (valid)
+				return true;
+		}
+		return false;
+	}
+
+	SIMDLevel DetectSIMDLevel()
+	{
+	#if defined(_MSC_VER)
+		int info[4];
+		__cpuid(info, 0);
+		int maxLeaf = info[0];
+		__cpuid(info, 1);
+		bool osxsave = (info[2] & (1 << 27)) != 0;
+		bool avx = (info[2] & (1 << 28)) != 0;
+		bool fma = (info[2] & (1 << 12)) != 0;
+		unsigned long long xcr0 = osxsave ? _xgetbv(0) : 0;
+		bool avxState = (xcr0 & 0x6) == 0x6;
+		bool avx512State = (xcr0 & 0xE6) == 0xE6;
+		bool avx2 = false, avx512 = false;
+		if (maxLeaf >= 7)
+		{
+			__cpuidex(info, 7, 0);
+			avx2 = (info[1] & (1 << 5)) != 0;
+			avx512 = (info[1] & (1 << 16)) != 0;
+		}
+		if (avx512 && avx512State)
+			return SIMDLevel::AVX512;
+		if (avx && avx2 && fma && avxState)
+			return SIMDLevel::AVX2;
+		return SIMDLevel::SSE;
+	#else
+		__builtin_cpu_init();
+		if (__builtin_cpu_supports("avx512f"))
+			return SIMDLevel::AVX512;
+		if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+			return SIMDLevel::AVX2;
+		return SIMDLevel::SSE;
+	#endif
+	}
+
+#else
+
+	SIMDLevel DetectSIMDLevel()
+	{
+		return SIMDLevel::Scalar;
+	}
+
+#endif
+
+	struct Kernels
+	{
+		SIMDLevel level;
+		uint32_t laneCount;
+		ClosestKernel closest;
+		AnyKernel any;
+	};
+
+	Kernels SelectKernels()
+	{
+		switch (DetectSIMDLevel())
+		{
+	#if RT_X64
+		case SIMDLevel::AVX512: return { SIMDLevel::AVX512, 16, IntersectClosestAVX512, IntersectAnyAVX512 };
+		case SIMDLevel::AVX2:   return { SIMDLevel::AVX2, 8, IntersectClosestAVX2, IntersectAnyAVX2 };
+		case SIMDLevel::SSE:    return { SIMDLevel::SSE, 4, IntersectClosestSSE, IntersectAnySSE };
+	#endif
+		default:                return { SIMDLevel::Scalar, 4, IntersectClosestScalar, IntersectAnyScalar };
+		}
+	}
+
+	const Kernels& GetKernels()
+	{
+		static Kernels kernels = SelectKernels();
+		return kernels;
+	}
+
+}
+
+void SphereSoA::Resize(uint32_t sphereCount)
+{
+	count = sphereCount;
+	uint32_t padded = sphereCount + MaxLaneCount;
+	x.Edit().assign(padded, 0.0f);
+	y.Edit().assign(padded, 0.0f);
+	z.Edit().assign(padded, 0.0f);
+	radius2.Edit().assign(padded, 0.0f);
+	materialID.Edit().assign(padded, 0);
+}
+
+bool SphereSoA::IntersectClosest(uint32_t first, uint32_t count, const glm::vec3& origin, const glm::vec3& direction,
+	float& tMax, uint32_t& hitIndex) const
+{
+	return GetKernels().closest(*this, first, count, origin, direction, tMax, hitIndex);
+}
+
+bool SphereSoA::IntersectAny(uint32_t first, uint32_t count, const glm::vec3& origin, const glm::vec3& direction,
+	float tMin, float tMax) const
+{
+	return GetKernels().any(*this, first, count, origin, direction, tMin, tMax);
+}
+
+SIMDLevel SphereSoA::GetSIMDLevel()
+{
+	return GetKernels().level;
+}
+
+uint32_t SphereSoA::GetLaneCount()
+{
+	return GetKernels().laneCount;
+}
+
+const char* SphereSoA::GetSIMDLevelName()
+{
+	switch (GetSIMDLevel())
+	{
+	case SIMDLevel::AVX512: return "AVX-512";
+	case SIMDLevel::AVX2:   return "AVX2";
+	case SIMDLevel::SSE:    return "SSE";
+	default:                return "Scalar";
+	}
+}
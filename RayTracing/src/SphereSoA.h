@@ -0,0 +1,45 @@
+﻿#pragma once
+
+#include "Buffer.h"
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstdint>
+
+enum class SIMDLevel
+{
+	Scalar, SSE, AVX2, AVX512
+};
+
+// 球体的 SoA 布局，按 BVH 图元顺序排列，叶子直接对应一段连续下标
+// 数组尾部多留 MaxLaneCount 个元素，SIMD 读取不会越界
+struct SphereSoA
+{
+	static constexpr uint32_t MaxLaneCount = 16;
+
+	Buffer<float> x, y, z, radius2;
+	Buffer<uint32_t> materialID;
+	uint32_t count = 0;
+
+	void Resize(uint32_t sphereCount);
+	void Set(uint32_t index, const glm::vec3& position, float radius, uint32_t material)
+	{
+		x.Edit()[index] = position.x;
+		y.Edit()[index] = position.y;
+		z.Edit()[index] = position.z;
+		radius2.Edit()[index] = radius * radius;
+		materialID.Edit()[index] = material;
+	}
+
+	// [first, first + count) 中最近的 t < tMax，命中则更新 tMax 和 hitIndex
+	bool IntersectClosest(uint32_t first, uint32_t count, const glm::vec3& origin, const glm::vec3& direction,
+		float& tMax, uint32_t& hitIndex) const;
+	// 是否存在 tMin < t < tMax 的交点
+	bool IntersectAny(uint32_t first, uint32_t count, const glm::vec3& origin, const glm::vec3& direction,
+		float tMin, float tMax) const;
+
+	// 运行时检测 CPU 选择的内核，一次测试的球体数
+	static SIMDLevel GetSIMDLevel();
+	static uint32_t GetLaneCount();
+	static const char* GetSIMDLevelName();
+};
@@ -0,0 +1,222 @@
+﻿#include "TileScheduler.h"
+
+#include <algorithm>
+
+#if defined(_WIN32)
+	#define NOMINMAX
+	#include <Windows.h>
+#elif defined(__linux__)
+	#include <pthread.h>
+	#include <sched.h>
+#endif
+
+namespace {
+
+	uint32_t Part1By1(uint32_t x)
+	{
+		x &= 0x0000FFFF;
+		x = (x | (x << 8)) & 0x00FF00FF;
+		x = (x | (x << 4)) & 0x0F0F0F0F;
+		x = (x | (x << 2)) & 0x33333333;
+		x = (x | (x << 1)) & 0x55555555;
+		return x;
+	}
+
+	uint32_t MortonCode(uint32_t x, uint32_t y)
+	{
+		return Part1By1(x) | (Part1By1(y) << 1);
+	}
+
+	void PinCurrentThread(uint32_t core)
+	{
+#if defined(_WIN32)
+		SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << (core % 64));
+#elif defined(__linux__)
+		cpu_set_t cpuset;
+		CPU_ZERO(&cpuset);
+		CPU_SET(core % CPU_SETSIZE, &cpuset);
+		pthread_setaffinity_np(pthread_self(), sizeof(cpuset), &cpuset);
+#else
+		(void)core;
+#endif
+	}
+
+}
+
+TileScheduler::TileScheduler(uint32_t threadCount)
+{
+	SetThreadCount(threadCount);
+}
+
+TileScheduler::~TileScheduler()
+{
+	StopThreads();
+}
+
+void TileScheduler::SetThreadCount(uint32_t threadCount, bool pinThreads)
+{
+	if (threadCount == 0)
+		threadCount = std::max(1u, std::thread::hardware_concurrency());
+	if (threadCount == m_ThreadCount && pinThreads == m_PinThreads && m_Queues)
+		return;
+
+	StopThreads();
+	m_ThreadCount = threadCount;
+	m_PinThreads = pinThreads;
+	StartThreads();
+}
+
+void TileScheduler::SetTileSize(uint32_t tileSize)
+{
+	m_TileSize = std::max(1u, tileSize);
+	m_TilesImageWidth = m_TilesImageHeight = 0;
+}
+
+void TileScheduler::StartThreads()
+{
+	m_Queues = std::make_unique<WorkQueue[]>(m_ThreadCount);
+	m_Stop = false;
+	for (uint32_t i = 1; i < m_ThreadCount; i++)
+		m_Threads.emplace_back(&TileScheduler::WorkerLoop, this, i, m_Generation);
+}
+
+void TileScheduler::StopThreads()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Stop = true;
+	}
+	m_StartCondition.notify_all();
+	for (std::thread& thread : m_Threads)
+		thread.join();
+	m_Threads.clear();
+}
+
+void TileScheduler::BuildTiles(uint32_t width, uint32_t height)
+{
+	if (width == m_TilesImageWidth && height == m_TilesImageHeight)
+		return;
+	m_TilesImageWidth = width;
+	m_TilesImageHeight = height;
+
+	uint32_t tilesX = (width + m_TileSize - 1) / m_TileSize;
+	uint32_t tilesY = (height + m_TileSize - 1) / m_TileSize;
+
+	std::vector<std::pair<uint32_t, Tile>> ordered;
+	ordered.reserve(tilesX * tilesY);
+	for (uint32_t ty = 0; ty < tilesY; ty++)
+	{
+		for (uint32_t tx = 0; tx < tilesX; tx++)
+		{
+			Tile tile;
+			tile.x0 = tx * m_TileSize;
+			tile.y0 = ty * m_TileSize;
+			tile.x1 = std::min(width, tile.x0 + m_TileSize);
+			tile.y1 = std::min(height, tile.y0 + m_TileSize);
+			ordered.push_back({ MortonCode(tx, ty), tile });
+		}
+	}
+	std::sort(ordered.begin(), ordered.end(),
+		[](const auto& a, const auto& b) { return a.first < b.first; });
+
+	m_Tiles.resize(ordered.size());
+	for (size_t i = 0; i < ordered.size(); i++)
+		m_Tiles[i] = ordered[i].second;
+}
+
+void TileScheduler::Run(uint32_t width, uint32_t height, const TileFunc& func)
+{
+	BuildTiles(width, height);
+	if (m_Tiles.empty())
+		return;
+
+	// 每个 worker 先分到曲线上连续的一段，保证局部性
+	uint32_t tileCount = (uint32_t)m_Tiles.size();
+	for (uint32_t i = 0; i < m_ThreadCount; i++)
+	{
+		m_Queues[i].begin = (uint32_t)((uint64_t)tileCount * i / m_ThreadCount);
+		m_Queues[i].end = (uint32_t)((uint64_t)tileCount * (i + 1) / m_ThreadCount);
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Func = &func;
+		m_ActiveWorkers = m_ThreadCount - 1;
+		m_Generation++;
+	}
+	m_StartCondition.notify_all();
+
+	ProcessTiles(0);
+
+	std::unique_lock<std::mutex> lock(m_Mutex);
+	m_DoneCondition.wait(lock, [this] { return m_ActiveWorkers == 0; });
+	m_Func = nullptr;
+}
+
+void TileScheduler::WorkerLoop(uint32_t workerIndex, uint64_t generation)
+{
+	if (m_PinThreads)
+		PinCurrentThread(workerIndex);
+
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_Mutex);
+			m_StartCondition.wait(lock, [&] { return m_Stop || m_Generation != generation; });
+			if (m_Stop)
+				return;
+			generation = m_Generation;
+		}
+
+		ProcessTiles(workerIndex);
+
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_ActiveWorkers--;
+		}
+		m_DoneCondition.notify_one();
+	}
+}
+
+void TileScheduler::ProcessTiles(uint32_t workerIndex)
+{
+	uint32_t tileIndex;
+	while (PopTile(workerIndex, tileIndex) || (StealTiles(workerIndex) && PopTile(workerIndex, tileIndex)))
+		(*m_Func)(m_Tiles[tileIndex], workerIndex);
+}
+
+bool TileScheduler::PopTile(uint32_t workerIndex, uint32_t& tileIndex)
+{
+	WorkQueue& queue = m_Queues[workerIndex];
+	std::lock_guard<std::mutex> lock(queue.mutex);
+	if (queue.begin >= queue.end)
+		return false;
+	tileIndex = queue.begin++;
+	return true;
+}
+
+bool TileScheduler::StealTiles(uint32_t workerIndex)
+{
+	// 从其他 worker 的区间尾部偷走一半
+	for (uint32_t i = 1; i < m_ThreadCount; i++)
+	{
+		WorkQueue& victim = m_Queues[(workerIndex + i) % m_ThreadCount];
+		uint32_t begin, end;
+		{
+			std::lock_guard<std::mutex> lock(victim.mutex);
+			if (victim.begin >= victim.end)
+				continue;
+			uint32_t remaining = victim.end - victim.begin;
+			end = victim.end;
+			begin = end - (remaining + 1) / 2;
+			victim.end = begin;
+		}
+
+		WorkQueue& queue = m_Queues[workerIndex];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		queue.begin = begin;
+		queue.end = end;
+		return true;
+	}
+	return false;
+}
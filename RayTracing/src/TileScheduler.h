@@ -0,0 +1,73 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <vector>
+
+struct Tile
+{
+	uint32_t x0, y0; // 包含
+	uint32_t x1, y1; // 不包含
+};
+
+// 常驻工作线程 + 按 Morton 曲线排序的 tile + 区间窃取
+// 调用 Run 的线程本身作为 0 号 worker 参与渲染
+class TileScheduler
+{
+public:
+	using TileFunc = std::function<void(const Tile& tile, uint32_t workerIndex)>;
+
+	explicit TileScheduler(uint32_t threadCount = 0);
+	~TileScheduler();
+
+	TileScheduler(const TileScheduler&) = delete;
+	TileScheduler& operator=(const TileScheduler&) = delete;
+
+	// threadCount 为 0 时使用硬件线程数
+	void SetThreadCount(uint32_t threadCount, bool pinThreads = false);
+	uint32_t GetThreadCount() const { return m_ThreadCount; }
+	bool IsPinningThreads() const { return m_PinThreads; }
+
+	void SetTileSize(uint32_t tileSize);
+	uint32_t GetTileSize() const { return m_TileSize; }
+
+	// 阻塞直到所有 tile 处理完
+	void Run(uint32_t width, uint32_t height, const TileFunc& func);
+
+private:
+	struct alignas(64) WorkQueue
+	{
+		std::mutex mutex;
+		uint32_t begin = 0, end = 0; // m_Tiles 中的区间
+	};
+
+	void StartThreads();
+	void StopThreads();
+	void WorkerLoop(uint32_t workerIndex, uint64_t generation);
+	void ProcessTiles(uint32_t workerIndex);
+	bool PopTile(uint32_t workerIndex, uint32_t& tileIndex);
+	bool StealTiles(uint32_t workerIndex);
+	void BuildTiles(uint32_t width, uint32_t height);
+
+private:
+	uint32_t m_ThreadCount = 1;
+	bool m_PinThreads = false;
+	uint32_t m_TileSize = 16;
+
+	std::vector<Tile> m_Tiles;
+	uint32_t m_TilesImageWidth = 0, m_TilesImageHeight = 0;
+
+	std::vector<std::thread> m_Threads;
+	std::unique_ptr<WorkQueue[]> m_Queues;
+	const TileFunc* m_Func = nullptr;
+
+	std::mutex m_Mutex;
+	std::condition_variable m_StartCondition, m_DoneCondition;
+	uint64_t m_Generation = 0;
+	uint32_t m_ActiveWorkers = 0;
+	bool m_Stop = false;
+};
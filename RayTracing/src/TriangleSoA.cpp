@@ -0,0 +1,65 @@
+﻿#include "TriangleSoA.h"
+
+#include <cfloat>
+
+// Möller–Trumbore: p = d x e2, det = e1·p，u = s·p / det，q = s x e1，v = d·q / det，t = e2·q / det
+// 双面相交；det 接近 0 (光线与三角形平行) 不算命中
+
+namespace {
+
+	// 返回 t，未命中返回 FLT_MAX；循环体无分支写回，便于编译器向量化
+	inline float IntersectTriangle(const TriangleSoA& tri, uint32_t i, const glm::vec3& o, const glm::vec3& d)
+	{
+		glm::vec3 e1(tri.e1x[i], tri.e1y[i], tri.e1z[i]);
+		glm::vec3 e2(tri.e2x[i], tri.e2y[i], tri.e2z[i]);
+		glm::vec3 p = glm::cross(d, e2);
+		float det = glm::dot(e1, p);
+		float invDet = 1.0f / det;
+
+		glm::vec3 s(o.x - tri.v0x[i], o.y - tri.v0y[i], o.z - tri.v0z[i]);
+		float u = glm::dot(s, p) * invDet;
+		glm::vec3 q = glm::cross(s, e1);
+		float v = glm::dot(d, q) * invDet;
+		float t = glm::dot(e2, q) * invDet;
+
+		bool hit = glm::abs(det) > 1e-12f && u >= 0.0f && v >= 0.0f && u + v <= 1.0f && t >= 0.0f;
+		return hit ? t : FLT_MAX;
+	}
+
+}
+
+void TriangleSoA::Resize(uint32_t triangleCount)
+{
+	count = triangleCount;
+	for (Buffer<float>* values : { &v0x, &v0y, &v0z, &e1x, &e1y, &e1z, &e2x, &e2y, &e2z })
+		values->Edit().resize(triangleCount, 0.0f);
+}
+
+bool TriangleSoA::IntersectClosest(uint32_t first, uint32_t count, const glm::vec3& origin, const glm::vec3& direction,
+	float& tMax, uint32_t& hitIndex) const
+{
+	bool hit = false;
+	for (uint32_t i = first; i < first + count; i++)
+	{
+		float t = IntersectTriangle(*this, i, origin, direction);
+		if (t < tMax)
+		{
+			tMax = t;
+			hitIndex = i;
+			hit = true;
+		}
+	}
+	return hit;
+}
+
+bool TriangleSoA::IntersectAny(uint32_t first, uint32_t count, const glm::vec3& origin, const glm::vec3& direction,
+	float tMin, float tMax) const
+{
+	for (uint32_t i = first; i < first + count; i++)
+	{
+		float t = IntersectTriangle(*this, i, origin, direction);
+		if (t > tMin && t < tMax)
+			return true;
+	}
+	return false;
+}
@@ -0,0 +1,39 @@
+﻿#pragma once
+
+#include "Buffer.h"
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstdint>
+
+// 三角形的 SoA 布局，按 BVH 图元顺序排列，预先存好 v0 和两条边供 Möller–Trumbore 使用
+// 只存几何；材质属于引用网格的实例
+struct TriangleSoA
+{
+	Buffer<float> v0x, v0y, v0z;
+	Buffer<float> e1x, e1y, e1z;
+	Buffer<float> e2x, e2y, e2z;
+	uint32_t count = 0;
+
+	// 保留已有的三角形，新增部分填 0
+	void Resize(uint32_t triangleCount);
+	void Set(uint32_t index, const glm::vec3& a, const glm::vec3& b, const glm::vec3& c)
+	{
+		v0x.Edit()[index] = a.x; v0y.Edit()[index] = a.y; v0z.Edit()[index] = a.z;
+		e1x.Edit()[index] = b.x - a.x; e1y.Edit()[index] = b.y - a.y; e1z.Edit()[index] = b.z - a.z;
+		e2x.Edit()[index] = c.x - a.x; e2y.Edit()[index] = c.y - a.y; e2z.Edit()[index] = c.z - a.z;
+	}
+
+	// 未归一化的几何法线 e1 x e2
+	glm::vec3 GetNormal(uint32_t index) const
+	{
+		return glm::cross(glm::vec3(e1x[index], e1y[index], e1z[index]), glm::vec3(e2x[index], e2y[index], e2z[index]));
+	}
+
+	// 与 SphereSoA 相同的接口：[first, first + count) 中最近的 t < tMax
+	bool IntersectClosest(uint32_t first, uint32_t count, const glm::vec3& origin, const glm::vec3& direction,
+		float& tMax, uint32_t& hitIndex) const;
+	// 是否存在 tMin < t < tMax 的交点
+	bool IntersectAny(uint32_t first, uint32_t count, const glm::vec3& origin, const glm::vec3& direction,
+		float tMin, float tMax) const;
+};
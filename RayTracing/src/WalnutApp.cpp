@@ -2,10 +2,14 @@
 #include "Walnut/EntryPoint.h"
 
 #include "Walnut/Image.h"
-#include "Walnut/Timer.h"
 
-#include "Renderer.h"
 #include "Camera.h"
+#include "RenderThread.h"
+#include "Scenes.h"
+#include "MeshLoader.h"
+#include "SceneSerializer.h"
+#include "WalnutImageSink.h"
+#include "WalnutInputSource.h"
 
 #include <glm/gtc/type_ptr.hpp>
 
@@ -15,68 +19,121 @@ class ExampleLayer : public Walnut::Layer
 {
 public:
 	ExampleLayer()
-		: m_Camera(45.0f, 0.1f, 100.0f)
+		: m_Camera(45.0f, 0.1f, 100.0f), m_RenderThread(m_Camera)
 	{
-		// 
-		Material groundMat;
-		groundMat.albedo = { 0.2f, 0.3f, 0.1f };
-		groundMat.roughness = 0.9f;
-		uint32_t groundMatID = m_Scene.AddMaterial(groundMat);
-
-		Material sphereMat; // ͭɫ
-		sphereMat.albedo = { 0.8f, 0.5f, 0.2f };
-		sphereMat.metallic = 0.5f;
-		uint32_t sphereMatID = m_Scene.AddMaterial(sphereMat);
-
-		Material blueSphereMat; // ɫ - 
-		blueSphereMat.albedo = { 0.2f, 0.3f, 0.8f };
-		blueSphereMat.metallic = 0.9f;
-		blueSphereMat.roughness = 0.2f;
-		uint32_t blueMatID = m_Scene.AddMaterial(blueSphereMat);
-
-		// 岢
-		{
-			Sphere sphere;
-			sphere.position = { 0.0f, -101.0f, 0.0f };
-			sphere.radius = 100.0f;
-			sphere.materialID = groundMatID; // 
-			m_Scene.AddSphere(sphere);
-		}
-		{
-			Sphere sphere;  // ͭɫ
-			sphere.position = { 0.0f, 0.0f, 0.0f };
-			sphere.radius = 1.0f;
-			sphere.materialID = sphereMatID;
-			m_Scene.AddSphere(sphere);
-		}
-		{
-			Sphere sphere;  // ɫ
-			sphere.position = { 1.7f, 0.5f, 0.0f };  // Ҳλã΢
-			sphere.radius = 0.7f;  // С
-			sphere.materialID = blueMatID; // ²
-			m_Scene.AddSphere(sphere);
-		}
+		m_Scene = Scenes::CreateDefaultScene();
+		m_RenderThread.SubmitScene(m_Scene, true);
+
+		m_ImageSink = std::make_shared<WalnutImageSink>();
+		m_Camera.SetInputSource(&m_Input);
 	}
 
 	virtual void OnUpdate(float ts) override
 	{
-		m_Camera.OnUpdate(ts);
+		m_CameraMoved = m_Camera.OnUpdate(ts);
 	}
 
 	virtual void OnUIRender() override
 	{
+		// Ⱦں̨߳̽Уֻ༭ m_Request  m_Scene֡ĩһύͳɵһ֡
+		RenderSettings& settings = m_Request.settings;
+		const RenderThread::FrameStats& stats = m_FrameStats;
+		bool settingsChanged = false;
+		bool sceneChanged = false, sceneReplaced = false, saveScene = false;
+		bool geometryChanged = false; // 塢ʵ任ı߽
+
 		ImGui::Begin("Setting");
-		ImGui::DragInt("Rays Count: ", (int*)&m_Renderer.m_NumRays, 1, 1, 50);
-		ImGui::DragInt("Max Bounce Count: ", (int*)&m_Renderer.m_MaxBounceCount, 1, 1, 5);
-		ImGui::Text("Last render: %.3fms", m_LastRenderTime);
-		if (ImGui::Button("Render"))
+		settingsChanged |= ImGui::DragInt("Rays Count: ", (int*)&settings.m_NumRays, 1, 1, 50);
+		settingsChanged |= ImGui::DragInt("Max Bounce Count: ", (int*)&settings.m_MaxBounceCount, 1, 1, 64);
+		settingsChanged |= ImGui::Checkbox("Russian Roulette", &settings.m_RussianRoulette);
+		if (settings.m_RussianRoulette)
+			settingsChanged |= ImGui::DragInt("Roulette Start Bounce: ", (int*)&settings.m_RouletteStartBounce, 1, 1, 16);
+		settingsChanged |= ImGui::DragInt("Light Samples: ", (int*)&settings.m_LightSamples, 1, 1, SurfaceSample::MaxLightSamples);
+		ImGui::Text("Last render: %.3fms", stats.renderTime);
+		//  Rays Count ÿ֡ޣʱԤ㽵ͷֱ
+		settingsChanged |= ImGui::Checkbox("Frame Budget", &m_Request.frameBudget);
+		if (m_Request.frameBudget)
 		{
-			Render();
+			ImGui::DragFloat("Target Frame Time (ms)", &m_Request.targetFrameTime, 0.5f, 4.0f, 1000.0f);
+			ImGui::DragFloat("Min Resolution Scale", &m_Request.minScale, 0.01f, 0.1f, 1.0f);
+			ImGui::Text("Render resolution: %ux%u (%.0f%%), %u spp", stats.width, stats.height,
+				stats.plan.scale * 100.0f, stats.plan.samplesPerPixel);
 		}
-		ImGui::Checkbox("IsRendering", &m_IsRendering);
-		ImGui::Checkbox("JustDiffuse", &m_Renderer.m_JustDiffuse);
+		ImGui::Text("Accumulated frames: %u", stats.accumulatedFrames);
+		ImGui::Text("Cancelled frames: %u", stats.cancelledFrames);
+		ImGui::Text("BVH: %u nodes, build %.3fms, refit %.3fms", stats.sphereBVHNodes,
+			stats.sphereBVHBuildTime, stats.sphereBVHRefitTime);
+		ImGui::Text("Sphere kernel: %s", SphereSoA::GetSIMDLevelName());
+		ImGui::Text("Light tree: %u point lights, build %.3fms", stats.pointLightCount, stats.lightTreeBuildTime);
+		m_Request.renderOnce = ImGui::Button("Render");
+		ImGui::Checkbox("IsRendering", &m_Request.continuous);
+		settingsChanged |= ImGui::Checkbox("JustDiffuse", &settings.m_JustDiffuse);
+		settingsChanged |= ImGui::Checkbox("Jitter (AA)", &settings.m_JitterPrimaryRays);
+		// ֻ󽻣
+		ImGui::Checkbox("Cache Primary Hits", &settings.m_CachePrimaryHits);
+		if (settings.m_CachePrimaryHits)
+			ImGui::Text("Primary hits: %s", stats.reusingPrimaryHits ? "cached" : "traced");
+		settingsChanged |= ImGui::Checkbox("Adaptive Sampling", &settings.m_Adaptive);
+		if (settings.m_Adaptive)
+		{
+			settingsChanged |= ImGui::DragFloat("Error Threshold", &settings.m_AdaptiveThreshold, 0.0005f, 0.0005f, 0.1f, "%.4f");
+			ImGui::Text("Converged pixels: %u / %u", stats.convergedPixels, stats.width * stats.height);
+		}
+		ImGui::Checkbox("Show Sample Counts", &settings.m_ShowSampleCounts);
+		ImGui::Text("Samples: %.2f per pixel", stats.width * stats.height > 0 ?
+			(double)stats.totalSamples / (stats.width * stats.height) : 0.0);
+		// ֻʾغ͵ζضۻ
+		ImGui::Checkbox("Denoise", &settings.m_Denoise);
+		if (settings.m_Denoise)
+		{
+			DenoiseSettings& denoiser = m_Request.denoise;
+			ImGui::DragInt("Denoise Iterations", (int*)&denoiser.m_Iterations, 1, 0, Denoiser::MaxIterations);
+			ImGui::DragFloat("Color Sigma", &denoiser.m_ColorSigma, 0.1f, 0.1f, 64.0f);
+			ImGui::DragFloat("Depth Sigma", &denoiser.m_DepthSigma, 0.05f, 0.05f, 16.0f);
+			ImGui::DragFloat("Albedo Sigma", &denoiser.m_AlbedoSigma, 0.01f, 0.01f, 4.0f);
+			ImGui::Text("Denoise: %.3fms", stats.denoiseTime);
+		}
+		ImGui::Checkbox("Accumulate", &settings.m_Accumulate);
+		// ģʽͬлʱضۻ
+		ImGui::Combo("Render Mode", (int*)&settings.m_Mode, "Recursive\0Wavefront\0");
+		if (settings.m_Mode == RenderMode::Wavefront)
+			ImGui::Combo("Wavefront Sort", (int*)&settings.m_WavefrontSort, "None\0Material\0Direction\0");
+		if (ImGui::Button("Reset"))
+			settingsChanged = true;
 		ImGui::End();
 
+		// ֻж RT_PROFILE ʱ
+		if (Profiler::Enabled)
+		{
+			ImGui::Begin("Profiler");
+			const ProfileFrameStats& profile = stats.profile;
+			ImGui::Text("Frame: %.3fms (stage times are summed over threads)", profile.frameMs);
+			double stageTotal = 0.0;
+			for (uint32_t s = 0; s < (uint32_t)ProfileStage::Count; s++)
+				stageTotal += profile.stageMs[s];
+			for (uint32_t s = 0; s < (uint32_t)ProfileStage::Count; s++)
+			{
+				ImGui::Text("%-12s %9.3fms %5.1f%%", Profiler::GetStageName((ProfileStage)s), profile.stageMs[s],
+					stageTotal > 0.0 ? profile.stageMs[s] / stageTotal * 100.0 : 0.0);
+			}
+			const RayCounts& rays = stats.rays;
+			uint64_t rayCount = rays.primary + rays.secondary + rays.shadow;
+			ImGui::Text("Rays: %llu primary, %llu secondary, %llu shadow", (unsigned long long)rays.primary,
+				(unsigned long long)rays.secondary, (unsigned long long)rays.shadow);
+			for (uint32_t c = 0; c < (uint32_t)ProfileCounter::Count; c++)
+			{
+				ImGui::Text("%s: %llu (%.1f per ray)", Profiler::GetCounterName((ProfileCounter)c),
+					(unsigned long long)profile.counters[c], rayCount > 0 ? (double)profile.counters[c] / rayCount : 0.0);
+			}
+			ImGui::Checkbox("Show Pixel Cost", &settings.m_ShowPixelCost);
+			ImGui::InputText("Trace Path", m_TracePath, sizeof(m_TracePath));
+			if (stats.capturingTrace)
+				ImGui::Text("Capturing trace...");
+			else if (ImGui::Button("Capture Trace (30 frames)"))
+				m_RenderThread.CaptureTrace(30, m_TracePath);
+			ImGui::End();
+		}
+
 
 		ImGui::Begin("Scene");
 
@@ -88,8 +145,13 @@ public:
 			Material& material = m_Scene.GetMaterial(sphere.materialID);
 
 			ImGui::Text("Sphere %zu", i);
-			ImGui::DragFloat3("Position", glm::value_ptr(sphere.position), 0.01f);
-			ImGui::DragFloat("Radius", &sphere.radius, 0.01f, 0.01f);
+			bool sphereMoved = ImGui::DragFloat3("Position", glm::value_ptr(sphere.position), 0.01f);
+			sphereMoved |= ImGui::DragFloat("Radius", &sphere.radius, 0.01f, 0.01f);
+			if (sphereMoved)
+			{
+				m_Scene.MarkSphereChanged((uint32_t)i);
+				sceneChanged = geometryChanged = true;
+			}
 
 			// ѡ
 			ImGui::Text("Material ID: %u", sphere.materialID);
@@ -101,6 +163,8 @@ public:
 					if (ImGui::Selectable(("Material " + std::to_string(matID)).c_str(), isSelected))
 					{
 						sphere.materialID = matID;
+						m_Scene.MarkSphereMaterialChanged((uint32_t)i);
+						sceneChanged = true;
 					}
 					if (isSelected)
 					{
@@ -114,6 +178,73 @@ public:
 			ImGui::PopID();
 		}
 
+		// 񼸺Σÿжʵ
+		ImGui::Separator();
+		ImGui::Text("Meshes");
+		for (size_t i = 0; i < m_Scene.meshes.size(); i++)
+		{
+			ImGui::PushID(static_cast<int>(i) + 20000);
+			ImGui::Text("Mesh %zu: %u triangles", i, m_Scene.meshes[i].triangleCount);
+			ImGui::SameLine();
+			if (ImGui::Button("Add Instance"))
+			{
+				MeshInstance instance;
+				instance.meshID = (uint32_t)i;
+				m_Scene.AddInstance(instance);
+				sceneChanged = geometryChanged = true;
+			}
+			ImGui::PopID();
+		}
+		ImGui::InputText("Mesh Path", m_MeshPath, sizeof(m_MeshPath));
+		if (ImGui::Button("Load Mesh"))
+		{
+			MeshData mesh;
+			if (MeshLoader::Load(m_MeshPath, mesh))
+			{
+				MeshInstance instance;
+				instance.meshID = m_Scene.AddMesh(mesh.positions, mesh.indices);
+				m_Scene.AddInstance(instance);
+				sceneChanged = geometryChanged = true;
+			}
+		}
+
+		// ʵбı任ֲֻ Refit  BVH
+		ImGui::Separator();
+		ImGui::Text("Instances: TLAS build %.3fms, refit %.3fms", stats.instanceBVHBuildTime, stats.instanceBVHRefitTime);
+		for (size_t i = 0; i < m_Scene.instances.size(); i++)
+		{
+			ImGui::PushID(static_cast<int>(i) + 30000);
+			MeshInstance& instance = m_Scene.instances[i];
+
+			ImGui::Text("Instance %zu of mesh %u", i, instance.meshID);
+			bool instanceMoved = ImGui::DragFloat3("Position", glm::value_ptr(instance.position), 0.01f);
+			instanceMoved |= ImGui::DragFloat3("Rotation", glm::value_ptr(instance.rotation), 0.5f);
+			instanceMoved |= ImGui::DragFloat3("Scale", glm::value_ptr(instance.scale), 0.01f, 0.01f);
+			if (instanceMoved)
+			{
+				m_Scene.MarkInstanceChanged((uint32_t)i);
+				sceneChanged = geometryChanged = true;
+			}
+			int materialID = (int)instance.materialID;
+			if (ImGui::SliderInt("Material", &materialID, 0, (int)m_Scene.materials.size() - 1))
+			{
+				instance.materialID = (uint32_t)materialID;
+				sceneChanged = true;
+			}
+
+			ImGui::Separator();
+			ImGui::PopID();
+		}
+
+		// ļ.rtscene Ϊƣ.json Ϊı
+		ImGui::Separator();
+		ImGui::InputText("Scene Path", m_ScenePath, sizeof(m_ScenePath));
+		// Ⱦ߳ǷݳٽṹѾ
+		saveScene = ImGui::Button("Save Scene");
+		ImGui::SameLine();
+		if (ImGui::Button("Load Scene") && SceneSerializer::Load(m_ScenePath, m_Scene, &m_Camera))
+			sceneChanged = sceneReplaced = geometryChanged = true;
+
 		// б
 		ImGui::Separator();
 		for (size_t i = 0; i < m_Scene.materials.size(); i++)
@@ -122,11 +253,11 @@ public:
 			Material& material = m_Scene.materials[i];
 
 			ImGui::Text("Material %zu", i);
-			ImGui::ColorEdit3("Albedo##global", glm::value_ptr(material.albedo));
-			ImGui::DragFloat("Metallic##global", &material.metallic, 0.01f, 0.0f, 1.0f);
-			ImGui::DragFloat("Roughness##global", &material.roughness, 0.01f, 0.0f, 1.0f);
-			ImGui::ColorEdit3("Emission Color##global", glm::value_ptr(material.emissionColor));
-			ImGui::DragFloat("Emission Power##global", &material.emissionPower, 0.01f, 0.0f);
+			sceneChanged |= ImGui::ColorEdit3("Albedo##global", glm::value_ptr(material.albedo));
+			sceneChanged |= ImGui::DragFloat("Metallic##global", &material.metallic, 0.01f, 0.0f, 1.0f);
+			sceneChanged |= ImGui::DragFloat("Roughness##global", &material.roughness, 0.01f, 0.0f, 1.0f);
+			sceneChanged |= ImGui::ColorEdit3("Emission Color##global", glm::value_ptr(material.emissionColor));
+			sceneChanged |= ImGui::DragFloat("Emission Power##global", &material.emissionPower, 0.01f, 0.0f);
 
 			ImGui::Separator();
 			ImGui::PopID();
@@ -135,27 +266,29 @@ public:
 		// Դ
 		ImGui::Text("Directional Light");
 		ImGui::Separator();
-		ImGui::SliderFloat3("Direction", glm::value_ptr(m_Scene.directionalLight.direction), -1.0f, 1.0f);
-		ImGui::ColorEdit3("Color", glm::value_ptr(m_Scene.directionalLight.color));
-		ImGui::SliderFloat("Intensity", &m_Scene.directionalLight.intensity, 0.0f, 10.0f);
+		sceneChanged |= ImGui::SliderFloat3("Direction", glm::value_ptr(m_Scene.directionalLight.direction), -1.0f, 1.0f);
+		sceneChanged |= ImGui::ColorEdit3("Color", glm::value_ptr(m_Scene.directionalLight.color));
+		sceneChanged |= ImGui::SliderFloat("Intensity", &m_Scene.directionalLight.intensity, 0.0f, 10.0f);
 
 		// Դб
 		ImGui::Separator();
 		ImGui::Text("Point Lights");
+		bool lightsChanged = false;
 		for (size_t i = 0; i < m_Scene.pointLights.size(); i++)
 		{
 			ImGui::PushID(static_cast<int>(i) + 10000);
 			PointLight& light = m_Scene.pointLights[i];
 
 			ImGui::Text("Point Light %zu", i);
-			ImGui::DragFloat3("Position", glm::value_ptr(light.position), 0.1f);
-			ImGui::ColorEdit3("Color", glm::value_ptr(light.color));
-			ImGui::SliderFloat("Intensity", &light.intensity, 0.0f, 100.0f);
-			ImGui::SliderFloat("Range", &light.range, 0.1f, 50.0f);
+			lightsChanged |= ImGui::DragFloat3("Position", glm::value_ptr(light.position), 0.1f);
+			lightsChanged |= ImGui::ColorEdit3("Color", glm::value_ptr(light.color));
+			lightsChanged |= ImGui::SliderFloat("Intensity", &light.intensity, 0.0f, 100.0f);
+			lightsChanged |= ImGui::SliderFloat("Range", &light.range, 0.1f, 50.0f);
 
 			if (ImGui::Button("Remove"))
 			{
 				m_Scene.pointLights.erase(m_Scene.pointLights.begin() + i);
+				lightsChanged = true;
 				ImGui::PopID();
 				break;
 			}
@@ -166,55 +299,72 @@ public:
 
 		if (ImGui::Button("Add Point Light"))
 		{
-			m_Scene.pointLights.push_back({
-				glm::vec3(0.0f, 3.0f, 0.0f),
-				glm::vec3(1.0f),
-				5.0f,
-				10.0f
-				});
+			m_Scene.AddPointLight(glm::vec3(0.0f, 3.0f, 0.0f), glm::vec3(1.0f), 5.0f, 10.0f);
+			lightsChanged = true;
+		}
+
+		if (lightsChanged)
+		{
+			m_Scene.MarkPointLightsChanged();
+			sceneChanged = true;
 		}
 
 		ImGui::End();
 
+		if (sceneChanged)
+			m_RenderThread.SubmitScene(m_Scene, sceneReplaced);
+		if (saveScene)
+		{
+			std::string path = m_ScenePath;
+			m_RenderThread.Post([path](Scene& scene, const Camera& camera) { SceneSerializer::Save(path, scene, &camera); });
+		}
+		m_Interacting = m_CameraMoved || settingsChanged || sceneChanged;
+		// ֻ˲ʡԴȾʱ߽㲻䣬֡Ԥ㱣ֱַʣֻ
+		m_ShadingOnly = m_Interacting && !m_CameraMoved && !geometryChanged;
+
 
 		ImGui::PushStyleVar(ImGuiStyleVar_WindowPadding, ImVec2(0.0f, 0.0f));
 		ImGui::Begin("Viewport");
 		m_ViewportWidth = ImGui::GetContentRegionAvail().x;
 		m_ViewportHeight = ImGui::GetContentRegionAvail().y;
-		std::shared_ptr<Walnut::Image> image = m_Renderer.GetFinalImage();
+		m_RenderThread.Present(*m_ImageSink, m_FrameStats);
+		std::shared_ptr<Walnut::Image> image = m_ImageSink->GetImage();
 		if (image)
 		{
+			// ֱȾͼ쵽ӿ
 			ImGui::Image(image->GetDescriptorSet(),
-				{ (float)image->GetWidth(), (float)image->GetHeight() },
+				{ (float)m_ViewportWidth, (float)m_ViewportHeight },
 				ImVec2(0, 1), ImVec2(1, 0));
 		}
 		ImGui::End();
 		ImGui::PopStyleVar();
 
-		if (m_IsRendering)
-			Render();
-	}
-
-	void Render()
-	{
-		Timer timer;
-
-		m_Camera.OnResize(m_ViewportWidth, m_ViewportHeight);
-		m_Renderer.OnResize(m_ViewportWidth, m_ViewportHeight);
-		m_Renderer.Render(m_Scene, m_Camera);
-
-		m_LastRenderTime = timer.ElapsedMillis();
+		m_Request.viewportWidth = m_ViewportWidth;
+		m_Request.viewportHeight = m_ViewportHeight;
+		m_Request.interacting = m_Interacting;
+		m_Request.shadingOnly = m_ShadingOnly;
+		m_Request.restart = m_Interacting;
+		m_RenderThread.Submit(m_Request, m_Camera);
 	}
 
 private:
-	Renderer m_Renderer;
 	Scene m_Scene;
 	Camera m_Camera;
+	RenderThread::Request m_Request;
+	RenderThread::FrameStats m_FrameStats;
+
+	std::shared_ptr<WalnutImageSink> m_ImageSink;
+	WalnutInputSource m_Input;
 	
 	uint32_t m_ViewportWidth = 0, m_ViewportHeight = 0;
+	bool m_CameraMoved = false, m_Interacting = false, m_ShadingOnly = false;
+
+	char m_MeshPath[260] = "";
+	char m_ScenePath[260] = "scene.rtscene";
+	char m_TracePath[260] = "trace.json";
 
-	float m_LastRenderTime = 0;
-	bool m_IsRendering = false;
+	// 졢߳ͣºԱ
+	RenderThread m_RenderThread;
 };
 
 Walnut::Application* Walnut::CreateApplication(int argc, char** argv)
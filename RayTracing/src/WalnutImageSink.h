@@ -0,0 +1,35 @@
+#pragma once
+
+#include "ImageSink.h"
+
+#include "Walnut/Image.h"
+
+#include <memory>
+
+class WalnutImageSink : public ImageSink
+{
+public:
+	virtual void OnResize(uint32_t width, uint32_t height) override
+	{
+		if (m_Image)
+		{
+			if (width == m_Image->GetWidth() && height == m_Image->GetHeight())
+				return;
+			m_Image->Resize(width, height);
+		}
+		else
+		{
+			m_Image = std::make_shared<Walnut::Image>(width, height, Walnut::ImageFormat::RGBA);
+		}
+	}
+
+	virtual void SetData(const uint32_t* rgba) override
+	{
+		m_Image->SetData(rgba);
+	}
+
+	std::shared_ptr<Walnut::Image> GetImage() const { return m_Image; }
+
+private:
+	std::shared_ptr<Walnut::Image> m_Image;
+};
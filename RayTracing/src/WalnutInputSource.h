@@ -0,0 +1,38 @@
+#pragma once
+
+#include "InputSource.h"
+
+#include "Walnut/Input/Input.h"
+
+class WalnutInputSource : public InputSource
+{
+public:
+	virtual glm::vec2 GetMousePosition() const override
+	{
+		return Walnut::Input::GetMousePosition();
+	}
+
+	virtual bool IsLookActive() const override
+	{
+		return Walnut::Input::IsMouseButtonDown(Walnut::MouseButton::Right);
+	}
+
+	virtual bool IsKeyDown(CameraKey key) const override
+	{
+		switch (key)
+		{
+		case CameraKey::Forward:  return Walnut::Input::IsKeyDown(Walnut::KeyCode::W);
+		case CameraKey::Backward: return Walnut::Input::IsKeyDown(Walnut::KeyCode::S);
+		case CameraKey::Left:     return Walnut::Input::IsKeyDown(Walnut::KeyCode::A);
+		case CameraKey::Right:    return Walnut::Input::IsKeyDown(Walnut::KeyCode::D);
+		case CameraKey::Down:     return Walnut::Input::IsKeyDown(Walnut::KeyCode::Q);
+		case CameraKey::Up:       return Walnut::Input::IsKeyDown(Walnut::KeyCode::E);
+		}
+		return false;
+	}
+
+	virtual void SetCursorLocked(bool locked) override
+	{
+		Walnut::Input::SetCursorMode(locked ? Walnut::CursorMode::Locked : Walnut::CursorMode::Normal);
+	}
+};
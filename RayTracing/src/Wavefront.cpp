@@ -0,0 +1,258 @@
+﻿#include "Renderer.h"
+#include "Random.h"
+
+#include <algorithm>
+
+// wavefront 模式：一个 tile 的 (像素 x 采样) 条路径一起推进，
+// 每个阶段是对 SoA 队列的一个紧凑循环，阶段之间压缩掉已结束的路径。
+// 着色复用 ShadeHit，随机数消耗顺序和递归版本一致，结果只有浮点舍入差异。
+
+void Renderer::RenderTileWavefront(const Tile& tile, WavefrontQueue& queue, RayCounts& rays)
+{
+	uint32_t tileWidth = tile.x1 - tile.x0;
+	uint32_t pixelCount = tileWidth * (tile.y1 - tile.y0);
+
+	// 自适应模式下每个像素的样本数不同
+	queue.pixelPaths.resize(pixelCount + 1);
+	uint32_t pathCount = 0;
+	for (uint32_t p = 0; p < pixelCount; p++)
+	{
+		queue.pixelPaths[p] = pathCount;
+		pathCount += GetPixelSampleCount(tile.x0 + p % tileWidth + (tile.y0 + p / tileWidth) * m_Width);
+	}
+	queue.pixelPaths[pixelCount] = pathCount;
+	queue.Resize(pathCount, SurfaceSample::MaxShadowConnections);
+
+	WavefrontGenerate(tile, queue);
+	for (uint32_t depth = 0; depth < m_MaxBounceCount && queue.activeCount > 0; depth++)
+	{
+		(depth == 0 ? rays.primary : rays.secondary) += queue.activeCount;
+		WavefrontExtend(queue, depth);
+		WavefrontMiss(queue, depth);
+		if (m_WavefrontSort != WavefrontSort::None)
+			WavefrontSortHits(queue);
+		WavefrontShade(queue, depth);
+		rays.shadow += queue.shadowCount;
+		WavefrontShadowConnect(queue);
+	}
+
+	// 达到最大弹射次数的路径取天空光，和递归版本的终止条件一致
+	for (uint32_t i = 0; i < queue.activeCount; i++)
+	{
+		uint32_t path = queue.active[i];
+		queue.radiance[path] += queue.throughput[path] * GetSkyLight(Ray(queue.origin[path], queue.direction[path]));
+	}
+
+	for (uint32_t p = 0; p < pixelCount; p++)
+	{
+		uint32_t x = tile.x0 + p % tileWidth;
+		uint32_t y = tile.y0 + p / tileWidth;
+		uint32_t pixelIndex = x + y * m_Width;
+		uint32_t first = queue.pixelPaths[p], samples = queue.pixelPaths[p + 1] - first;
+		if (samples == 0)
+		{
+			UpdateDisplayPixel(pixelIndex);
+			continue;
+		}
+
+		glm::vec3 color(0.0f);
+		AuxiliarySample aux;
+		for (uint32_t path = first; path < first + samples; path++)
+		{
+			RecordSample(pixelIndex, queue.radiance[path]);
+			color += queue.radiance[path];
+			aux.albedo += queue.auxAlbedo[path];
+			aux.normal += queue.auxNormal[path];
+			aux.depth += queue.auxDepth[path];
+		}
+		color /= (float)samples;
+		aux.albedo /= (float)samples;
+		aux.normal /= (float)samples;
+		aux.depth /= (float)samples;
+		AccumulatePixel(pixelIndex, color, aux, samples);
+	}
+}
+
+void Renderer::WavefrontGenerate(const Tile& tile, WavefrontQueue& queue)
+{
+	uint32_t path = 0;
+	for (uint32_t y = tile.y0; y < tile.y1; y++)
+	{
+		for (uint32_t x = tile.x0; x < tile.x1; x++)
+		{
+			uint32_t pixelIndex = x + y * m_Width;
+			uint32_t samples = GetPixelSampleCount(pixelIndex);
+			for (uint32_t s = 1; s <= samples; s++, path++)
+			{
+				uint32_t seed = Utils::InitSeed(pixelIndex, m_FrameCount, s, m_Seed);
+				Ray ray = GeneratePrimaryRay(x, y, seed);
+				queue.origin[path] = ray.origin;
+				queue.direction[path] = ray.direction;
+				queue.throughput[path] = glm::vec3(1.0f);
+				queue.radiance[path] = glm::vec3(0.0f);
+				queue.seed[path] = seed;
+				queue.bsdfPdf[path] = 0.0f;
+				queue.auxAlbedo[path] = glm::vec3(0.0f);
+				queue.auxNormal[path] = glm::vec3(0.0f);
+				queue.auxDepth[path] = 0.0f;
+				PrimaryHit* slot = GetPrimaryHitSlot(pixelIndex, s - 1);
+				queue.primaryHitSlot[path] = slot ? (uint32_t)(slot - m_PrimaryHitCache.hits.data()) : WavefrontQueue::NoHit;
+				queue.active[path] = path;
+			}
+		}
+	}
+	queue.activeCount = path;
+}
+
+void Renderer::WavefrontExtend(WavefrontQueue& queue, uint32_t depth)
+{
+	RT_PROFILE_STAGE(Intersect);
+	const Scene& scene = *m_Scene;
+	bool readPrimaryHits = depth == 0 && m_PrimaryHitMode == PrimaryHitMode::Read;
+	bool writePrimaryHits = depth == 0 && m_PrimaryHitMode == PrimaryHitMode::Write;
+	for (uint32_t i = 0; i < queue.activeCount; i++)
+	{
+		uint32_t path = queue.active[i];
+		uint32_t slot = queue.primaryHitSlot[path];
+		if (readPrimaryHits && slot != WavefrontQueue::NoHit)
+		{
+			const PrimaryHit& hit = m_PrimaryHitCache.hits[slot];
+			queue.hitT[path] = hit.t;
+			queue.hitIndex[path] = hit.primitive;
+			queue.hitInstance[path] = hit.instance;
+			continue;
+		}
+
+		const glm::vec3& origin = queue.origin[path];
+		const glm::vec3& direction = queue.direction[path];
+
+		float tMax = FLT_MAX;
+		uint32_t primitive = WavefrontQueue::NoHit, instance = 0;
+		IntersectScene(scene, origin, direction, tMax, primitive, instance);
+		if (writePrimaryHits && slot != WavefrontQueue::NoHit)
+		{
+			// 法线在着色阶段写入
+			PrimaryHit& hit = m_PrimaryHitCache.hits[slot];
+			hit.t = tMax;
+			hit.primitive = primitive;
+			hit.instance = instance;
+		}
+		queue.hitT[path] = tMax;
+		queue.hitIndex[path] = primitive;
+		queue.hitInstance[path] = instance;
+	}
+}
+
+void Renderer::WavefrontMiss(WavefrontQueue& queue, uint32_t depth)
+{
+	// 未命中的路径取天空光后结束，命中的压缩进 hits
+	uint32_t hitCount = 0;
+	for (uint32_t i = 0; i < queue.activeCount; i++)
+	{
+		uint32_t path = queue.active[i];
+		if (queue.hitIndex[path] == WavefrontQueue::NoHit)
+		{
+			glm::vec3 sky = GetSkyLight(Ray(queue.origin[path], queue.direction[path]));
+			queue.radiance[path] += queue.throughput[path] * sky;
+			if (depth == 0)
+				queue.auxAlbedo[path] = glm::clamp(sky, glm::vec3(0.0f), glm::vec3(1.0f));
+		}
+		else
+			queue.hits[hitCount++] = path;
+	}
+	queue.hitCount = hitCount;
+}
+
+void Renderer::WavefrontSortHits(WavefrontQueue& queue)
+{
+	// 计数排序，保持同一个桶内的原始顺序
+	uint32_t bucketCount = 8; // 方向按分量符号分成 8 个卦限
+	if (m_WavefrontSort == WavefrontSort::Material)
+	{
+		bucketCount = (uint32_t)m_Scene->materials.size();
+		if (bucketCount <= 1)
+			return;
+		for (uint32_t i = 0; i < queue.hitCount; i++)
+		{
+			uint32_t path = queue.hits[i];
+			queue.sortKeys[i] = std::min(m_Scene->GetPrimitiveMaterial(queue.hitIndex[path], queue.hitInstance[path]), bucketCount - 1);
+		}
+	}
+	else
+	{
+		for (uint32_t i = 0; i < queue.hitCount; i++)
+		{
+			const glm::vec3& d = queue.direction[queue.hits[i]];
+			queue.sortKeys[i] = (d.x < 0.0f ? 1u : 0u) | (d.y < 0.0f ? 2u : 0u) | (d.z < 0.0f ? 4u : 0u);
+		}
+	}
+
+	queue.sortOffsets.assign(bucketCount + 1, 0);
+	for (uint32_t i = 0; i < queue.hitCount; i++)
+		queue.sortOffsets[queue.sortKeys[i] + 1]++;
+	for (uint32_t b = 0; b < bucketCount; b++)
+		queue.sortOffsets[b + 1] += queue.sortOffsets[b];
+	for (uint32_t i = 0; i < queue.hitCount; i++)
+		queue.sortScratch[queue.sortOffsets[queue.sortKeys[i]]++] = queue.hits[i];
+	std::swap(queue.hits, queue.sortScratch);
+}
+
+void Renderer::WavefrontShade(WavefrontQueue& queue, uint32_t depth)
+{
+	Scene& scene = *m_Scene;
+
+	uint32_t activeCount = 0, shadowCount = 0;
+	for (uint32_t i = 0; i < queue.hitCount; i++)
+	{
+		uint32_t path = queue.hits[i];
+		Ray ray(queue.origin[path], queue.direction[path]);
+		HitInfo hitInfo = MakeHitInfo(scene, ray, queue.hitT[path], queue.hitIndex[path], queue.hitInstance[path]);
+
+		if (depth == 0)
+		{
+			queue.auxAlbedo[path] = scene.GetMaterial(hitInfo.materialID).albedo;
+			queue.auxNormal[path] = hitInfo.normal;
+			queue.auxDepth[path] = hitInfo.dist;
+			uint32_t slot = queue.primaryHitSlot[path];
+			if (m_PrimaryHitMode == PrimaryHitMode::Write && slot != WavefrontQueue::NoHit)
+				m_PrimaryHitCache.hits[slot].normal = hitInfo.normal;
+		}
+
+		SurfaceSample sample = ShadeHit(scene, ray, hitInfo, queue.bsdfPdf[path], depth + 1 == m_MaxBounceCount, queue.seed[path]);
+		glm::vec3 throughput = queue.throughput[path];
+		queue.radiance[path] += throughput * sample.emission;
+
+		for (uint32_t s = 0; s < sample.shadowCount; s++)
+		{
+			const ShadowConnection& shadow = sample.shadows[s];
+			queue.shadowOrigin[shadowCount] = shadow.ray.origin;
+			queue.shadowDirection[shadowCount] = shadow.ray.direction;
+			queue.shadowMaxDistance[shadowCount] = shadow.maxDistance;
+			queue.shadowContribution[shadowCount] = throughput * shadow.contribution;
+			queue.shadowPath[shadowCount] = path;
+			shadowCount++;
+		}
+
+		// 权重为零或轮盘赌淘汰的路径直接结束
+		throughput *= sample.indirectWeight;
+		if (!ContinuePath(throughput, depth, queue.seed[path]))
+			continue;
+		queue.throughput[path] = throughput;
+		queue.origin[path] = sample.nextRay.origin;
+		queue.direction[path] = sample.nextRay.direction;
+		queue.bsdfPdf[path] = sample.pdf;
+		queue.active[activeCount++] = path;
+	}
+	queue.activeCount = activeCount;
+	queue.shadowCount = shadowCount;
+}
+
+void Renderer::WavefrontShadowConnect(WavefrontQueue& queue)
+{
+	Scene& scene = *m_Scene;
+	for (uint32_t i = 0; i < queue.shadowCount; i++)
+	{
+		float visibility = TraceShadowRay(scene, Ray(queue.shadowOrigin[i], queue.shadowDirection[i]), queue.shadowMaxDistance[i]);
+		queue.radiance[queue.shadowPath[i]] += queue.shadowContribution[i] * visibility;
+	}
+}
@@ -0,0 +1,81 @@
+﻿#pragma once
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstdint>
+
+enum class RenderMode
+{
+	Recursive, // 每条路径递归追踪到底
+	Wavefront  // 一个 tile 的所有路径按阶段批量推进
+};
+
+// shade 之前对存活路径重新排序，让相同材质或相近方向的光线连续处理
+enum class WavefrontSort
+{
+	None, Material, Direction
+};
+
+// 一个 tile 内全部路径的 SoA 状态，每个 worker 一份，跨帧复用
+struct WavefrontQueue
+{
+	static constexpr uint32_t NoHit = UINT32_MAX;
+
+	// 按路径下标
+	std::vector<glm::vec3> origin, direction;
+	std::vector<glm::vec3> throughput, radiance;
+	std::vector<uint32_t> seed;
+	std::vector<float> bsdfPdf; // 采样当前 direction 的概率密度，见 SurfaceSample::pdf
+	std::vector<float> hitT;
+	std::vector<uint32_t> hitIndex; // Scene 图元编号，未命中为 NoHit
+	std::vector<uint32_t> hitInstance; // 命中三角形时的实例编号
+	std::vector<glm::vec3> auxAlbedo, auxNormal; // 主光线第一次命中的信息，见 AuxiliarySample
+	std::vector<float> auxDepth;
+	std::vector<uint32_t> primaryHitSlot; // 主光线交点在 Renderer 缓存中的位置，不使用缓存为 NoHit
+
+	// shade 产生的阴影光线，按生成顺序
+	std::vector<glm::vec3> shadowOrigin, shadowDirection, shadowContribution;
+	std::vector<float> shadowMaxDistance;
+	std::vector<uint32_t> shadowPath;
+	uint32_t shadowCount = 0;
+
+	// tile 内第 p 个像素的路径为 [pixelPaths[p], pixelPaths[p + 1])
+	std::vector<uint32_t> pixelPaths;
+
+	// 存活路径的下标，每个阶段之间压缩
+	std::vector<uint32_t> active, hits, sortKeys, sortScratch, sortOffsets;
+	uint32_t activeCount = 0, hitCount = 0;
+
+	void Resize(uint32_t pathCount, uint32_t shadowsPerPath)
+	{
+		uint32_t shadowCapacity = pathCount * shadowsPerPath;
+		if (shadowOrigin.size() < shadowCapacity)
+		{
+			shadowOrigin.resize(shadowCapacity);
+			shadowDirection.resize(shadowCapacity);
+			shadowContribution.resize(shadowCapacity);
+			shadowMaxDistance.resize(shadowCapacity);
+			shadowPath.resize(shadowCapacity);
+		}
+
+		if (origin.size() >= pathCount)
+			return;
+		origin.resize(pathCount);
+		direction.resize(pathCount);
+		throughput.resize(pathCount);
+		radiance.resize(pathCount);
+		seed.resize(pathCount);
+		bsdfPdf.resize(pathCount);
+		hitT.resize(pathCount);
+		hitIndex.resize(pathCount);
+		hitInstance.resize(pathCount);
+		auxAlbedo.resize(pathCount);
+		auxNormal.resize(pathCount);
+		auxDepth.resize(pathCount);
+		primaryHitSlot.resize(pathCount);
+		active.resize(pathCount);
+		hits.resize(pathCount);
+		sortKeys.resize(pathCount);
+		sortScratch.resize(pathCount);
+	}
+};
@@ -0,0 +1,369 @@
+﻿#include "Renderer.h"
+#include "Camera.h"
+#include "Scenes.h"
+#include "Json.h"
+#include "MappedFile.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+// 固定的程序化场景、固定的种子和分辨率，结果写成 JSON；
+// 给出基准文件时按场景和线程数比较每帧耗时，变慢超过容差即视为回退，返回非零退出码
+namespace {
+
+	using Clock = std::chrono::high_resolution_clock;
+
+	struct BenchmarkScene
+	{
+		const char* name;
+		std::function<Scene()> create;
+		uint32_t maxBounceCount;
+		uint32_t pointLightCount;
+		bool overview; // 从斜上方俯视球场，否则用相机默认位置
+	};
+
+	struct Options
+	{
+		uint32_t width = 640;
+		uint32_t height = 360;
+		uint32_t warmupFrames = 2;
+		uint32_t frames = 8;
+		std::vector<uint32_t> threadCounts; // 为空时 1, 2, 4 ... 直到硬件线程数
+		std::vector<std::string> sceneNames; // 为空时全部
+		RenderMode mode = RenderMode::Recursive;
+		std::string outputPath = "benchmark.json";
+		std::string baselinePath;
+		float tolerance = 0.1f;
+	};
+
+	struct RunResult
+	{
+		uint32_t threads = 0;
+		double msPerFrame = 0.0; // 中位数
+		double minMsPerFrame = 0.0;
+		double primaryRaysPerSec = 0.0, secondaryRaysPerSec = 0.0, shadowRaysPerSec = 0.0;
+		double speedup = 1.0; // 相对第一个线程数
+	};
+
+	struct SceneResult
+	{
+		std::string name;
+		size_t sphereCount = 0;
+		uint32_t maxBounceCount = 0;
+		double bvhBuildMs = 0.0, lightTreeBuildMs = 0.0;
+		std::vector<RunResult> runs;
+	};
+
+	const std::vector<BenchmarkScene>& GetBenchmarkScenes()
+	{
+		static const std::vector<BenchmarkScene> scenes = {
+			{ "default", [] { return Scenes::CreateDefaultScene(); }, 2, 0, false },
+			{ "spheres-1k", [] { return Scenes::CreateRandomSpheresScene(1000, 1); }, 4, 16, true },
+			{ "spheres-100k", [] { return Scenes::CreateRandomSpheresScene(100000, 1); }, 4, 16, true },
+			{ "glossy", [] { return Scenes::CreateGlossyScene(1000, 1); }, 8, 16, true },
+		};
+		return scenes;
+	}
+
+	void PrintUsage(const char* exe)
+	{
+		printf("Usage: %s [options]\n"
+			"  --width <n>      image width (default 640)\n"
+			"  --height <n>     image height (default 360)\n"
+			"  --frames <n>     measured frames per run, 1 spp each (default 8)\n"
+			"  --warmup <n>     frames rendered before measuring (default 2)\n"
+			"  --threads <list> comma separated thread counts (default 1, 2, 4 ... up to all hardware threads)\n"
+			"  --scenes <list>  comma separated subset of: default, spheres-1k, spheres-100k, glossy\n"
+			"  --mode <m>       recursive | wavefront (default recursive)\n"
+			"  --output <path>  JSON results, - for stdout (default benchmark.json)\n"
+			"  --baseline <path>  compare against a previous JSON result, exit with 2 on regressions\n"
+			"  --tolerance <f>  allowed ms/frame increase over the baseline (default 0.1 = 10%%)\n", exe);
+	}
+
+	std::vector<std::string> SplitList(const std::string& text)
+	{
+		std::vector<std::string> items;
+		size_t begin = 0;
+		while (begin <= text.size())
+		{
+			size_t end = text.find(',', begin);
+			if (end == std::string::npos)
+				end = text.size();
+			if (end > begin)
+				items.push_back(text.substr(begin, end - begin));
+			begin = end + 1;
+		}
+		return items;
+	}
+
+	bool ParseOptions(int argc, char** argv, Options& options)
+	{
+		for (int i = 1; i < argc; i++)
+		{
+			std::string arg = argv[i];
+			bool hasValue = i + 1 < argc;
+			if (arg == "--width" && hasValue)
+				options.width = (uint32_t)atoi(argv[++i]);
+			else if (arg == "--height" && hasValue)
+				options.height = (uint32_t)atoi(argv[++i]);
+			else if (arg == "--frames" && hasValue)
+				options.frames = (uint32_t)atoi(argv[++i]);
+			else if (arg == "--warmup" && hasValue)
+				options.warmupFrames = (uint32_t)atoi(argv[++i]);
+			else if (arg == "--threads" && hasValue)
+			{
+				for (const std::string& item : SplitList(argv[++i]))
+					options.threadCounts.push_back((uint32_t)atoi(item.c_str()));
+			}
+			else if (arg == "--scenes" && hasValue)
+				options.sceneNames = SplitList(argv[++i]);
+			else if (arg == "--mode" && hasValue)
+			{
+				std::string mode = argv[++i];
+				if (mode == "recursive")
+					options.mode = RenderMode::Recursive;
+				else if (mode == "wavefront")
+					options.mode = RenderMode::Wavefront;
+				else
+					return false;
+			}
+			else if ((arg == "--output" || arg == "-o") && hasValue)
+				options.outputPath = argv[++i];
+			else if (arg == "--baseline" && hasValue)
+				options.baselinePath = argv[++i];
+			else if (arg == "--tolerance" && hasValue)
+				options.tolerance = (float)atof(argv[++i]);
+			else
+				return false;
+		}
+		if (options.threadCounts.empty())
+		{
+			uint32_t hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+			for (uint32_t threads = 1; threads < hardwareThreads; threads *= 2)
+				options.threadCounts.push_back(threads);
+			options.threadCounts.push_back(hardwareThreads);
+		}
+		for (uint32_t threads : options.threadCounts)
+			if (threads == 0)
+				return false;
+		return options.width > 0 && options.height > 0 && options.frames > 0;
+	}
+
+	double ElapsedMs(Clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	}
+
+	RunResult RunScene(Scene& scene, const BenchmarkScene& benchmark, uint32_t threads, const Options& options)
+	{
+		Camera camera(45.0f, 0.1f, 100.0f);
+		if (benchmark.overview)
+		{
+			camera.SetPosition(glm::vec3(0.0f, 3.0f, 4.0f));
+			camera.SetDirection(glm::vec3(0.0f, -0.35f, -1.0f));
+		}
+		camera.OnResize(options.width, options.height);
+
+		Renderer renderer;
+		renderer.OnResize(options.width, options.height);
+		renderer.m_NumRays = 1;
+		renderer.m_MaxBounceCount = benchmark.maxBounceCount;
+		renderer.m_Mode = options.mode;
+		// 缓存只在第一帧写入，关掉让每一帧的工作量相同
+		renderer.m_CachePrimaryHits = false;
+		renderer.GetScheduler().SetThreadCount(threads);
+
+		for (uint32_t i = 0; i < options.warmupFrames; i++)
+			renderer.Render(scene, camera);
+
+		std::vector<double> frameTimes;
+		RayCounts total;
+		for (uint32_t i = 0; i < options.frames; i++)
+		{
+			auto start = Clock::now();
+			renderer.Render(scene, camera);
+			frameTimes.push_back(ElapsedMs(start));
+			const RayCounts& rays = renderer.GetRayCounts();
+			total.primary += rays.primary;
+			total.secondary += rays.secondary;
+			total.shadow += rays.shadow;
+		}
+
+		RunResult result;
+		result.threads = renderer.GetScheduler().GetThreadCount();
+		double totalSeconds = 0.0;
+		for (double ms : frameTimes)
+			totalSeconds += ms * 0.001;
+		std::sort(frameTimes.begin(), frameTimes.end());
+		result.msPerFrame = frameTimes[frameTimes.size() / 2];
+		result.minMsPerFrame = frameTimes.front();
+		result.primaryRaysPerSec = total.primary / totalSeconds;
+		result.secondaryRaysPerSec = total.secondary / totalSeconds;
+		result.shadowRaysPerSec = total.shadow / totalSeconds;
+		return result;
+	}
+
+	bool WriteResults(const std::string& path, const Options& options, const std::vector<SceneResult>& results)
+	{
+		FILE* file = path == "-" ? stdout : fopen(path.c_str(), "w");
+		if (!file)
+			return false;
+		fprintf(file, "{\n");
+		fprintf(file, "  \"version\": 1,\n");
+		fprintf(file, "  \"width\": %u,\n  \"height\": %u,\n  \"frames\": %u,\n", options.width, options.height, options.frames);
+		fprintf(file, "  \"mode\": \"%s\",\n", options.mode == RenderMode::Wavefront ? "wavefront" : "recursive");
+		fprintf(file, "  \"simd\": \"%s\",\n", SphereSoA::GetSIMDLevelName());
+		fprintf(file, "  \"hardwareThreads\": %u,\n", std::thread::hardware_concurrency());
+		fprintf(file, "  \"scenes\": [\n");
+		for (size_t s = 0; s < results.size(); s++)
+		{
+			const SceneResult& scene = results[s];
+			fprintf(file, "    {\n");
+			fprintf(file, "      \"name\": \"%s\",\n", EscapeJSON(scene.name).c_str());
+			fprintf(file, "      \"spheres\": %zu,\n      \"maxBounceCount\": %u,\n", scene.sphereCount, scene.maxBounceCount);
+			fprintf(file, "      \"bvhBuildMs\": %.4f,\n      \"lightTreeBuildMs\": %.4f,\n", scene.bvhBuildMs, scene.lightTreeBuildMs);
+			fprintf(file, "      \"runs\": [\n");
+			for (size_t r = 0; r < scene.runs.size(); r++)
+			{
+				const RunResult& run = scene.runs[r];
+				fprintf(file, "        { \"threads\": %u, \"msPerFrame\": %.4f, \"minMsPerFrame\": %.4f, "
+					"\"primaryRaysPerSec\": %.0f, \"secondaryRaysPerSec\": %.0f, \"shadowRaysPerSec\": %.0f, \"speedup\": %.3f }%s\n",
+					run.threads, run.msPerFrame, run.minMsPerFrame, run.primaryRaysPerSec, run.secondaryRaysPerSec,
+					run.shadowRaysPerSec, run.speedup, r + 1 < scene.runs.size() ? "," : "");
+			}
+			fprintf(file, "      ]\n");
+			fprintf(file, "    }%s\n", s + 1 < results.size() ? "," : "");
+		}
+		fprintf(file, "  ]\n}\n");
+		if (file != stdout)
+			fclose(file);
+		return true;
+	}
+
+	// 返回回退的数量，读取失败返回 -1
+	int CompareWithBaseline(const std::string& path, const Options& options, const std::vector<SceneResult>& results, FILE* log)
+	{
+		MappedFile file;
+		JsonValue root;
+		if (!file.Open(path) || !JsonParser(file.GetData(), file.GetData() + file.GetSize()).Parse(root)
+			|| root.type != JsonValue::Type::Object)
+		{
+			fprintf(stderr, "Failed to read baseline %s\n", path.c_str());
+			return -1;
+		}
+		if ((uint32_t)root.GetFloat("width", 0.0f) != options.width || (uint32_t)root.GetFloat("height", 0.0f) != options.height)
+			fprintf(log, "warning: baseline was measured at a different resolution\n");
+		const JsonValue* mode = root.Find("mode");
+		if (mode && mode->string != (options.mode == RenderMode::Wavefront ? "wavefront" : "recursive"))
+			fprintf(log, "warning: baseline was measured in %s mode\n", mode->string.c_str());
+
+		const JsonValue* baselineScenes = root.Find("scenes");
+		if (!baselineScenes || baselineScenes->type != JsonValue::Type::Array)
+			return 0;
+		int regressions = 0;
+		fprintf(log, "\nComparison with %s (tolerance %.0f%%):\n", path.c_str(), options.tolerance * 100.0f);
+		for (const SceneResult& scene : results)
+		{
+			const JsonValue* baselineRuns = nullptr;
+			for (const JsonValue& value : baselineScenes->array)
+			{
+				const JsonValue* name = value.Find("name");
+				if (name && name->string == scene.name)
+					baselineRuns = value.Find("runs");
+			}
+			if (!baselineRuns)
+				continue;
+			for (const RunResult& run : scene.runs)
+			{
+				for (const JsonValue& value : baselineRuns->array)
+				{
+					if ((uint32_t)value.GetFloat("threads", 0.0f) != run.threads)
+						continue;
+					double baselineMs = value.GetFloat("msPerFrame", 0.0f);
+					if (baselineMs <= 0.0)
+						continue;
+					double change = run.msPerFrame / baselineMs - 1.0;
+					bool regressed = change > options.tolerance;
+					regressions += regressed ? 1 : 0;
+					fprintf(log, "  %-14s %3u threads: %9.3fms -> %9.3fms (%+6.1f%%)%s\n", scene.name.c_str(), run.threads,
+						baselineMs, run.msPerFrame, change * 100.0, regressed ? "  REGRESSION" : "");
+				}
+			}
+		}
+		return regressions;
+	}
+
+}
+
+int main(int argc, char** argv)
+{
+	Options options;
+	if (!ParseOptions(argc, argv, options))
+	{
+		PrintUsage(argv[0]);
+		return 1;
+	}
+	// JSON 写到标准输出时，进度信息改写到标准错误
+	FILE* log = options.outputPath == "-" ? stderr : stdout;
+
+	std::vector<SceneResult> results;
+	for (const BenchmarkScene& benchmark : GetBenchmarkScenes())
+	{
+		if (!options.sceneNames.empty()
+			&& std::find(options.sceneNames.begin(), options.sceneNames.end(), benchmark.name) == options.sceneNames.end())
+			continue;
+
+		Scene scene = benchmark.create();
+		Scenes::AddRandomPointLights(scene, benchmark.pointLightCount, 1);
+		scene.UpdateBVH();
+		scene.UpdateLightTree();
+
+		SceneResult result;
+		result.name = benchmark.name;
+		result.sphereCount = scene.spheres.size();
+		result.maxBounceCount = benchmark.maxBounceCount;
+		result.bvhBuildMs = scene.sphereBVH.GetBuildTime();
+		result.lightTreeBuildMs = scene.pointLightTree.GetBuildTime();
+		fprintf(log, "%s: %zu spheres, %u bounces, BVH build %.3fms, light tree build %.3fms\n", benchmark.name,
+			result.sphereCount, result.maxBounceCount, result.bvhBuildMs, result.lightTreeBuildMs);
+
+		for (uint32_t threads : options.threadCounts)
+		{
+			RunResult run = RunScene(scene, benchmark, threads, options);
+			run.speedup = result.runs.empty() ? 1.0 : result.runs.front().msPerFrame / run.msPerFrame;
+			fprintf(log, "  %3u threads: %9.3fms/frame (min %.3fms), %7.2f M primary, %7.2f M secondary, %7.2f M shadow rays/s, %.2fx\n",
+				run.threads, run.msPerFrame, run.minMsPerFrame, run.primaryRaysPerSec * 1e-6, run.secondaryRaysPerSec * 1e-6,
+				run.shadowRaysPerSec * 1e-6, run.speedup);
+			result.runs.push_back(run);
+		}
+		results.push_back(std::move(result));
+	}
+
+	if (!WriteResults(options.outputPath, options, results))
+	{
+		fprintf(stderr, "Failed to write %s\n", options.outputPath.c_str());
+		return 1;
+	}
+	if (options.outputPath != "-")
+		fprintf(log, "Wrote %s\n", options.outputPath.c_str());
+
+	if (!options.baselinePath.empty())
+	{
+		int regressions = CompareWithBaseline(options.baselinePath, options, results, log);
+		if (regressions < 0)
+			return 1;
+		if (regressions > 0)
+		{
+			fprintf(log, "%d regression(s) over %.0f%%\n", regressions, options.tolerance * 100.0f);
+			return 2;
+		}
+		fprintf(log, "No regressions\n");
+	}
+	return 0;
+}
@@ -0,0 +1,53 @@
+project "RayTracingHeadless"
+   kind "ConsoleApp"
+   language "C++"
+   cppdialect "C++17"
+   staticruntime "off"
+
+   -- 只编译核心渲染器，Walnut 相关文件 (Walnut*.h / WalnutApp.cpp) 排除在外
+   files
+   {
+      "src/**.h",
+      "src/**.cpp",
+      "../RayTracing/src/**.h",
+      "../RayTracing/src/**.cpp",
+   }
+
+   removefiles
+   {
+      "../RayTracing/src/Walnut*",
+   }
+
+   includedirs
+   {
+      "../Walnut/vendor/glm",
+
+      "../RayTracing/src",
+   }
+
+   targetdir ("../bin/" .. outputdir .. "/%{prj.name}")
+   objdir ("../bin-int/" .. outputdir .. "/%{prj.name}")
+
+   filter "system:windows"
+      systemversion "latest"
+      links { "ws2_32" }
+
+   filter "system:linux"
+      links { "pthread" }
+
+   filter "configurations:Debug"
+      runtime "Debug"
+      symbols "On"
+
+   filter "configurations:Release"
+      runtime "Release"
+      optimize "On"
+      symbols "On"
+
+   filter "configurations:Dist"
+      runtime "Release"
+      optimize "On"
+      symbols "Off"
+
+   filter "options:profile"
+      defines { "RT_PROFILE=1" }
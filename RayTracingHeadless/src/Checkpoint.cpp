@@ -0,0 +1,257 @@
+﻿#include "Checkpoint.h"
+#include "SphereSoA.h"
+
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <type_traits>
+
+#if defined(_WIN32)
+	#include <io.h>
+#else
+	#include <unistd.h>
+#endif
+
+namespace Checkpoint {
+
+	namespace {
+
+		static_assert(std::is_trivially_copyable<Renderer::PixelStats>::value, "PixelStats is written as raw bytes");
+
+		constexpr uint32_t FileMagic = 0x4b435452; // "RTCK"
+		constexpr uint32_t FileVersion = 2; // 2: GGX 着色与 MIS，旧版本的累积结果不能接着渲染
+
+		struct FileHeader
+		{
+			uint32_t magic;
+			uint32_t version;
+			uint64_t fingerprint;
+			uint32_t width, height;
+			uint32_t frameCount;
+			uint32_t reserved;
+			uint64_t totalSamples;
+		};
+
+		// FNV-1a
+		struct Hash
+		{
+			uint64_t value = 0xcbf29ce484222325ull;
+
+			void Add(const void* data, size_t size)
+			{
+				const uint8_t* bytes = (const uint8_t*)data;
+				for (size_t i = 0; i < size; i++)
+					value = (value ^ bytes[i]) * 0x100000001b3ull;
+			}
+
+			template<typename T>
+			void Add(const T& value) { Add(&value, sizeof(T)); }
+
+			template<typename T>
+			void AddArray(const T* data, size_t count) { Add(&count, sizeof(count)); Add(data, sizeof(T) * count); }
+		};
+
+		template<typename T>
+		bool WriteArray(FILE* file, const std::vector<T>& values)
+		{
+			return values.empty() || fwrite(values.data(), sizeof(T), values.size(), file) == values.size();
+		}
+
+		template<typename T>
+		bool ReadArray(FILE* file, std::vector<T>& values, size_t count)
+		{
+			values.resize(count);
+			return count == 0 || fread(values.data(), sizeof(T), count, file) == count;
+		}
+
+		// 数据确实到达磁盘后才改名，断电也不会留下指向不完整内容的检查点
+		bool FlushToDisk(FILE* file)
+		{
+			if (fflush(file) != 0)
+				return false;
+#if defined(_WIN32)
+			return _commit(_fileno(file)) == 0;
+#else
+			return fsync(fileno(file)) == 0;
+#endif
+		}
+
+	}
+
+	uint64_t Fingerprint(const RenderSettings& settings, const Scene& scene, const Camera& camera,
+		uint32_t width, uint32_t height)
+	{
+		// 只取影响结果的参数；线程数和 tile 大小不改变图像。
+		// 渲染模式和 SIMD 级别只带来浮点舍入的差别，但续渲承诺逐位相同，也要一致
+		Hash hash;
+		hash.Add(width);
+		hash.Add(height);
+		hash.Add(settings.m_Seed);
+		hash.Add(settings.m_Mode);
+		hash.Add(SphereSoA::GetSIMDLevel());
+		hash.Add(settings.m_NumRays);
+		hash.Add(settings.m_MaxBounceCount);
+		hash.Add(settings.m_RussianRoulette);
+		hash.Add(settings.m_RouletteStartBounce);
+		hash.Add(settings.m_JustDiffuse);
+		hash.Add(settings.m_LightSamples);
+		hash.Add(settings.m_JitterPrimaryRays);
+		hash.Add(settings.m_Adaptive);
+		hash.Add(settings.m_AdaptiveThreshold);
+		hash.Add(settings.m_AdaptiveMinFrames);
+		hash.Add(settings.m_AdaptiveMaxBoost);
+
+		hash.Add(camera.GetPosition());
+		hash.Add(camera.GetDirection());
+		hash.Add(camera.GetVerticalFOV());
+
+		hash.AddArray(scene.materials.data(), scene.materials.size());
+		hash.AddArray(scene.spheres.data(), scene.spheres.size());
+		hash.AddArray(scene.vertices.data(), scene.vertices.size());
+		hash.AddArray(scene.indices.data(), scene.indices.size());
+		hash.AddArray(scene.meshes.data(), scene.meshes.size());
+		hash.AddArray(scene.instances.data(), scene.instances.size());
+		hash.Add(scene.directionalLight);
+		hash.AddArray(scene.pointLights.data(), scene.pointLights.size());
+		return hash.value;
+	}
+
+	bool Write(const std::string& path, uint64_t fingerprint, const Renderer::AccumulationState& state)
+	{
+		std::string temporaryPath = path + ".tmp";
+		FILE* file = fopen(temporaryPath.c_str(), "wb");
+		if (!file)
+			return false;
+
+		FileHeader header = { FileMagic, FileVersion, fingerprint, state.width, state.height, state.frameCount, 0,
+			state.totalSamples };
+		bool ok = fwrite(&header, sizeof(header), 1, file) == 1 && WriteArray(file, state.accumulation) &&
+			WriteArray(file, state.albedoDepth) && WriteArray(file, state.normal) && WriteArray(file, state.pixelStats) &&
+			FlushToDisk(file);
+		ok = fclose(file) == 0 && ok;
+
+		std::error_code error;
+		if (ok)
+			std::filesystem::rename(temporaryPath, path, error);
+		if (!ok || error)
+		{
+			std::filesystem::remove(temporaryPath, error);
+			return false;
+		}
+		return true;
+	}
+
+	bool Read(const std::string& path, uint64_t fingerprint, Renderer::AccumulationState& state, std::string& error)
+	{
+		FILE* file = fopen(path.c_str(), "rb");
+		if (!file)
+		{
+			error = "cannot open the file";
+			return false;
+		}
+
+		FileHeader header = {};
+		bool ok = fread(&header, sizeof(header), 1, file) == 1;
+		if (!ok || header.magic != FileMagic || header.version != FileVersion)
+			error = "not a checkpoint file";
+		else if (header.fingerprint != fingerprint)
+			error = "the scene, camera, render settings or SIMD level differ from the checkpointed render";
+		else
+		{
+			size_t pixelCount = (size_t)header.width * header.height;
+			state.width = header.width;
+			state.height = header.height;
+			state.frameCount = header.frameCount;
+			state.totalSamples = header.totalSamples;
+			if (!ReadArray(file, state.accumulation, pixelCount) || !ReadArray(file, state.albedoDepth, pixelCount) ||
+				!ReadArray(file, state.normal, pixelCount) || !ReadArray(file, state.pixelStats, pixelCount))
+				error = "the file is truncated";
+		}
+		fclose(file);
+		return error.empty();
+	}
+
+	Writer::Writer(const std::string& path, uint64_t fingerprint)
+		: m_Path(path), m_Fingerprint(fingerprint)
+	{
+		m_Thread = std::thread(&Writer::WriterLoop, this);
+	}
+
+	Writer::~Writer()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_Stop = true;
+		}
+		m_Condition.notify_all();
+		m_Thread.join();
+	}
+
+	bool Writer::Submit(const Renderer& renderer)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			if (m_Pending)
+				return false;
+		}
+		// 写出线程空闲时不碰 m_State
+		auto start = std::chrono::high_resolution_clock::now();
+		renderer.SaveAccumulation(m_State);
+		m_LastCaptureTime = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+		m_TotalCaptureTime += m_LastCaptureTime;
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_Pending = true;
+		}
+		m_Condition.notify_all();
+		return true;
+	}
+
+	void Writer::Wait()
+	{
+		std::unique_lock<std::mutex> lock(m_Mutex);
+		m_Condition.wait(lock, [this] { return !m_Pending; });
+	}
+
+	void Writer::Remove()
+	{
+		Wait();
+		std::error_code error;
+		std::filesystem::remove(m_Path, error);
+	}
+
+	uint32_t Writer::GetWrittenCount() const
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		return m_Written;
+	}
+
+	uint32_t Writer::GetFailedCount() const
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		return m_Failed;
+	}
+
+	void Writer::WriterLoop()
+	{
+		std::unique_lock<std::mutex> lock(m_Mutex);
+		while (true)
+		{
+			// 结束前写完已经提交的检查点
+			m_Condition.wait(lock, [this] { return m_Pending || m_Stop; });
+			if (!m_Pending)
+				return;
+
+			lock.unlock();
+			bool ok = Write(m_Path, m_Fingerprint, m_State);
+			if (!ok)
+				fprintf(stderr, "Failed to write checkpoint %s\n", m_Path.c_str());
+			lock.lock();
+
+			(ok ? m_Written : m_Failed)++;
+			m_Pending = false;
+			m_Condition.notify_all();
+		}
+	}
+
+}
@@ -0,0 +1,65 @@
+﻿#pragma once
+
+#include "Renderer.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// 长时间累积渲染的断点续渲：定期把 Renderer::AccumulationState 存到磁盘，进程被杀或节点被抢占后
+// 用 --resume 从保存的帧接着渲染，结果与不中断时逐位相同；换了渲染模式或 SIMD 级别不同的机器时拒绝续渲。
+// 文件是文件头 + 各缓冲的原始内存，只能在相同字节序的机器之间使用；先写 path.tmp 再改名，
+// 任何时刻磁盘上要么是旧的完整检查点，要么是新的完整检查点
+namespace Checkpoint {
+
+	// 场景、相机和影响结果的渲染参数的摘要，继续渲染前核对检查点是否属于同一次渲染
+	uint64_t Fingerprint(const RenderSettings& settings, const Scene& scene, const Camera& camera,
+		uint32_t width, uint32_t height);
+
+	bool Write(const std::string& path, uint64_t fingerprint, const Renderer::AccumulationState& state);
+	bool Read(const std::string& path, uint64_t fingerprint, Renderer::AccumulationState& state, std::string& error);
+
+	// 在后台线程写文件。渲染线程只在两帧之间复制一次状态，不等待磁盘
+	class Writer
+	{
+	public:
+		Writer(const std::string& path, uint64_t fingerprint);
+		~Writer();
+
+		Writer(const Writer&) = delete;
+		Writer& operator=(const Writer&) = delete;
+
+		// 上一个检查点还在写时跳过本次并返回 false
+		bool Submit(const Renderer& renderer);
+		// 等待正在写的检查点落盘
+		void Wait();
+		// 渲染完成后删除检查点文件
+		void Remove();
+
+		uint32_t GetWrittenCount() const;
+		uint32_t GetFailedCount() const;
+		// Submit 中复制状态的耗时 (毫秒)，这是检查点对渲染的全部开销
+		float GetLastCaptureTime() const { return m_LastCaptureTime; }
+		float GetTotalCaptureTime() const { return m_TotalCaptureTime; }
+
+	private:
+		void WriterLoop();
+
+	private:
+		std::string m_Path;
+		uint64_t m_Fingerprint;
+		Renderer::AccumulationState m_State;
+
+		std::thread m_Thread;
+		mutable std::mutex m_Mutex;
+		std::condition_variable m_Condition;
+		bool m_Pending = false;  // m_State 已经填好，等待写出
+		bool m_Stop = false;
+		uint32_t m_Written = 0, m_Failed = 0;
+
+		float m_LastCaptureTime = 0.0f, m_TotalCaptureTime = 0.0f;
+	};
+
+}
@@ -0,0 +1,549 @@
+﻿#include "Distributed.h"
+#include "Socket.h"
+#include "SceneSerializer.h"
+#include "SphereSoA.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <thread>
+#include <type_traits>
+
+#if defined(_WIN32)
+	#define NOMINMAX
+	#include <Windows.h>
+#else
+	#include <spawn.h>
+	#include <sys/wait.h>
+	extern char** environ;
+#endif
+
+namespace Distributed {
+
+	namespace {
+
+		static_assert(std::is_trivially_copyable<FrameSettings>::value, "FrameSettings is sent as raw bytes");
+
+		constexpr uint32_t ProtocolMagic = 0x31575452; // "RTW1"
+		constexpr uint32_t JobsInFlight = 2;
+		constexpr uint32_t ReceiveTimeout = 60000;  // 毫秒，只作用于已经开始到达的消息
+		constexpr uint64_t MaxMessageSize = 1ull << 36;
+
+		enum class MessageType : uint32_t
+		{
+			Hello,    // worker -> coordinator: HelloMessage
+			Setup,    // coordinator -> worker: FrameSettings + .rtscene 文件内容
+			Job,      // coordinator -> worker: JobMessage
+			Result,   // worker -> coordinator: JobMessage + 累积、反照率深度、法线 (vec4) + 方差 (float)，按行排列
+			Shutdown  // coordinator -> worker
+		};
+
+		struct MessageHeader
+		{
+			uint32_t type;
+			uint32_t reserved;
+			uint64_t size; // 不含消息头
+		};
+
+		struct HelloMessage
+		{
+			uint32_t magic;
+			uint32_t settingsSize; // 粗略检查两端是否为同一份程序
+			uint32_t simdLevel;    // SphereSoA::GetSIMDLevel()，不同级别的求交 kernel 结果不逐位相同
+		};
+
+		struct JobMessage
+		{
+			uint32_t jobID;
+			Tile region;
+		};
+
+		struct Payload
+		{
+			const void* data;
+			size_t size;
+		};
+
+		bool WriteMessage(Socket& socket, MessageType type, std::initializer_list<Payload> parts)
+		{
+			MessageHeader header = { (uint32_t)type, 0, 0 };
+			for (const Payload& part : parts)
+				header.size += part.size;
+			if (!socket.SendAll(&header, sizeof(header)))
+				return false;
+			for (const Payload& part : parts)
+			{
+				if (part.size > 0 && !socket.SendAll(part.data, part.size))
+					return false;
+			}
+			return true;
+		}
+
+		bool ReadMessage(Socket& socket, MessageType& type, std::vector<char>& payload)
+		{
+			MessageHeader header;
+			if (!socket.ReceiveAll(&header, sizeof(header)) || header.size > MaxMessageSize)
+				return false;
+			type = (MessageType)header.type;
+			payload.resize((size_t)header.size);
+			return header.size == 0 || socket.ReceiveAll(payload.data(), payload.size());
+		}
+
+		std::filesystem::path MakeTempScenePath()
+		{
+			std::random_device random;
+			char name[64];
+			snprintf(name, sizeof(name), "rt-distributed-%08x%08x.rtscene", random(), random());
+			return std::filesystem::temp_directory_path() / name;
+		}
+
+		// 借用 .rtscene 格式：BVH 随场景发送，worker 映射后直接使用
+		bool SerializeScene(Scene& scene, const Camera& camera, std::vector<char>& data)
+		{
+			std::filesystem::path path = MakeTempScenePath();
+			bool saved = SceneSerializer::SaveBinary(path.string(), scene, &camera);
+			if (saved)
+			{
+				std::ifstream file(path, std::ios::binary | std::ios::ate);
+				data.resize((size_t)file.tellg());
+				file.seekg(0);
+				saved = (bool)file.read(data.data(), data.size());
+			}
+			std::error_code error;
+			std::filesystem::remove(path, error);
+			return saved;
+		}
+
+		struct Process
+		{
+#if defined(_WIN32)
+			HANDLE handle = nullptr;
+#else
+			pid_t pid = 0;
+#endif
+		};
+
+		bool SpawnProcess(const std::string& executable, const std::vector<std::string>& arguments, Process& process)
+		{
+#if defined(_WIN32)
+			std::string commandLine = "\"" + executable + "\"";
+			for (const std::string& argument : arguments)
+				commandLine += " \"" + argument + "\"";
+			STARTUPINFOA startup = { sizeof(startup) };
+			PROCESS_INFORMATION info = {};
+			if (!CreateProcessA(nullptr, commandLine.data(), nullptr, nullptr, FALSE, 0, nullptr, nullptr, &startup, &info))
+				return false;
+			CloseHandle(info.hThread);
+			process.handle = info.hProcess;
+			return true;
+#else
+			std::vector<char*> argv;
+			argv.push_back(const_cast<char*>(executable.c_str()));
+			for (const std::string& argument : arguments)
+				argv.push_back(const_cast<char*>(argument.c_str()));
+			argv.push_back(nullptr);
+			return posix_spawnp(&process.pid, executable.c_str(), nullptr, nullptr, argv.data(), environ) == 0;
+#endif
+		}
+
+		void WaitProcess(Process& process)
+		{
+#if defined(_WIN32)
+			WaitForSingleObject(process.handle, INFINITE);
+			CloseHandle(process.handle);
+#else
+			int status;
+			waitpid(process.pid, &status, 0);
+#endif
+		}
+
+		void CopyRegion(const Tile& region, uint32_t imageWidth, const char*& source, void* destination, size_t pixelSize)
+		{
+			uint32_t regionWidth = region.x1 - region.x0;
+			for (uint32_t y = region.y0; y < region.y1; y++)
+			{
+				memcpy((char*)destination + ((size_t)y * imageWidth + region.x0) * pixelSize, source, regionWidth * pixelSize);
+				source += regionWidth * pixelSize;
+			}
+		}
+
+		bool ReceiveHello(Socket& socket, std::vector<char>& payload)
+		{
+			MessageType type;
+			HelloMessage hello;
+			if (!ReadMessage(socket, type, payload) || type != MessageType::Hello || payload.size() != sizeof(hello))
+				return false;
+			memcpy(&hello, payload.data(), sizeof(hello));
+			if (hello.magic != ProtocolMagic || hello.settingsSize != sizeof(FrameSettings))
+				return false;
+			if (hello.simdLevel != (uint32_t)SphereSoA::GetSIMDLevel())
+			{
+				fprintf(stderr, "Rejected a worker using a different SIMD level than the coordinator (%s)\n",
+					SphereSoA::GetSIMDLevelName());
+				return false;
+			}
+			return true;
+		}
+
+		size_t GetResultSize(const Tile& region)
+		{
+			size_t pixelCount = (size_t)(region.x1 - region.x0) * (region.y1 - region.y0);
+			return sizeof(JobMessage) + pixelCount * (3 * sizeof(glm::vec4) + sizeof(float));
+		}
+
+	}
+
+	bool RunCoordinator(const CoordinatorOptions& options, Scene& scene, const Camera& camera,
+		const FrameSettings& frame, FrameBuffers& result)
+	{
+		if (!Socket::Initialize())
+			return false;
+
+		std::vector<char> sceneData;
+		if (!SerializeScene(scene, camera, sceneData))
+		{
+			fprintf(stderr, "Failed to serialize the scene\n");
+			return false;
+		}
+
+		Socket listener;
+		if (!listener.Listen(options.port))
+		{
+			fprintf(stderr, "Failed to listen on port %u\n", options.port);
+			return false;
+		}
+		uint16_t port = listener.GetLocalPort();
+		printf("Coordinator listening on port %u, scene %.1f MB\n", port, sceneData.size() / (1024.0 * 1024.0));
+
+		std::vector<Process> processes;
+		for (uint32_t i = 0; i < options.spawnWorkers; i++)
+		{
+			std::vector<std::string> arguments = { "--worker", "127.0.0.1:" + std::to_string(port) };
+			arguments.insert(arguments.end(), options.workerArguments.begin(), options.workerArguments.end());
+			Process process;
+			if (!SpawnProcess(options.executable, arguments, process))
+			{
+				fprintf(stderr, "Failed to start worker %u\n", i);
+				continue;
+			}
+			processes.push_back(process);
+		}
+
+		struct Job
+		{
+			Tile region;
+			uint32_t assigned = 0; // 正在处理它的 worker 数
+			bool done = false;
+		};
+		std::vector<Job> jobs;
+		uint32_t jobTileSize = std::max(options.jobTileSize, 1u);
+		for (uint32_t y = 0; y < frame.height; y += jobTileSize)
+		{
+			for (uint32_t x = 0; x < frame.width; x += jobTileSize)
+			{
+				Job job;
+				job.region = { x, y, std::min(x + jobTileSize, frame.width), std::min(y + jobTileSize, frame.height) };
+				jobs.push_back(job);
+			}
+		}
+		std::deque<uint32_t> pending;
+		for (uint32_t i = 0; i < (uint32_t)jobs.size(); i++)
+			pending.push_back(i);
+
+		size_t pixelCount = (size_t)frame.width * frame.height;
+		result.accumulation.assign(pixelCount, glm::vec4(0.0f));
+		result.albedoDepth.assign(pixelCount, glm::vec4(0.0f));
+		result.normal.assign(pixelCount, glm::vec4(0.0f));
+		result.variance.assign(pixelCount, -1.0f);
+
+		struct Worker
+		{
+			Socket socket;
+			uint32_t id = 0;
+			std::vector<uint32_t> jobs; // 已发出未返回的任务
+			uint32_t completed = 0;
+		};
+		std::vector<std::unique_ptr<Worker>> workers;
+		std::vector<uint32_t> completedPerWorker;
+		uint32_t completedJobs = 0, requeuedJobs = 0, duplicatedJobs = 0, lostWorkers = 0;
+
+		auto dropWorker = [&](size_t index)
+		{
+			Worker& worker = *workers[index];
+			for (uint32_t jobID : worker.jobs)
+			{
+				Job& job = jobs[jobID];
+				job.assigned--;
+				if (!job.done && job.assigned == 0)
+				{
+					pending.push_front(jobID);
+					requeuedJobs++;
+				}
+			}
+			fprintf(stderr, "Worker %u disconnected, %zu jobs re-queued\n", worker.id, worker.jobs.size());
+			lostWorkers++;
+			workers.erase(workers.begin() + index);
+		};
+
+		// 先发排队的任务；队列空后重复发出别的 worker 仍在处理的任务，避免最后被慢的 worker 拖住
+		auto dispatch = [&](Worker& worker) -> bool
+		{
+			while (worker.jobs.size() < JobsInFlight)
+			{
+				uint32_t jobID = UINT32_MAX;
+				if (!pending.empty())
+				{
+					jobID = pending.front();
+					pending.pop_front();
+				}
+				else
+				{
+					for (uint32_t i = 0; i < (uint32_t)jobs.size() && jobID == UINT32_MAX; i++)
+					{
+						if (!jobs[i].done && jobs[i].assigned == 1
+							&& std::find(worker.jobs.begin(), worker.jobs.end(), i) == worker.jobs.end())
+						{
+							jobID = i;
+							duplicatedJobs++;
+						}
+					}
+					if (jobID == UINT32_MAX)
+						return true;
+				}
+
+				jobs[jobID].assigned++;
+				worker.jobs.push_back(jobID);
+				JobMessage message = { jobID, jobs[jobID].region };
+				if (!WriteMessage(worker.socket, MessageType::Job, { { &message, sizeof(message) } }))
+					return false;
+			}
+			return true;
+		};
+
+		auto lastWorkerTime = std::chrono::steady_clock::now();
+		std::vector<char> payload;
+		while (completedJobs < jobs.size())
+		{
+			if (!workers.empty())
+				lastWorkerTime = std::chrono::steady_clock::now();
+			else if (std::chrono::steady_clock::now() - lastWorkerTime > std::chrono::seconds(options.workerWaitSeconds))
+			{
+				fprintf(stderr, "No workers connected for %u s, giving up with %u of %zu jobs done\n",
+					options.workerWaitSeconds, completedJobs, jobs.size());
+				break;
+			}
+
+			std::vector<Socket*> sockets = { &listener };
+			for (auto& worker : workers)
+				sockets.push_back(&worker->socket);
+			std::vector<bool> readable;
+			if (!Socket::WaitReadable(sockets, 1000, readable))
+				continue;
+
+			// worker 从后往前处理，断开时可以直接删除
+			for (size_t i = workers.size(); i-- > 0;)
+			{
+				if (!readable[i + 1])
+					continue;
+				Worker& worker = *workers[i];
+				MessageType type;
+				JobMessage message;
+				if (!ReadMessage(worker.socket, type, payload) || type != MessageType::Result || payload.size() < sizeof(message))
+				{
+					dropWorker(i);
+					continue;
+				}
+				memcpy(&message, payload.data(), sizeof(message));
+				auto it = std::find(worker.jobs.begin(), worker.jobs.end(), message.jobID);
+				if (it == worker.jobs.end() || payload.size() != GetResultSize(jobs[message.jobID].region))
+				{
+					dropWorker(i);
+					continue;
+				}
+				worker.jobs.erase(it);
+				Job& job = jobs[message.jobID];
+				job.assigned--;
+				if (job.done)
+					continue; // 重复发出的任务，另一份已经返回
+				job.done = true;
+				completedJobs++;
+				worker.completed++;
+				completedPerWorker[worker.id]++;
+
+				const char* data = payload.data() + sizeof(message);
+				CopyRegion(job.region, frame.width, data, result.accumulation.data(), sizeof(glm::vec4));
+				CopyRegion(job.region, frame.width, data, result.albedoDepth.data(), sizeof(glm::vec4));
+				CopyRegion(job.region, frame.width, data, result.normal.data(), sizeof(glm::vec4));
+				CopyRegion(job.region, frame.width, data, result.variance.data(), sizeof(float));
+			}
+
+			if (readable[0])
+			{
+				auto worker = std::make_unique<Worker>();
+				if (listener.Accept(worker->socket))
+				{
+					worker->socket.SetReceiveTimeout(ReceiveTimeout);
+					if (ReceiveHello(worker->socket, payload) && WriteMessage(worker->socket, MessageType::Setup,
+						{ { &frame, sizeof(frame) }, { sceneData.data(), sceneData.size() } }))
+					{
+						worker->id = (uint32_t)completedPerWorker.size();
+						completedPerWorker.push_back(0);
+						workers.push_back(std::move(worker));
+					}
+				}
+			}
+
+			for (size_t i = workers.size(); i-- > 0;)
+			{
+				if (!dispatch(*workers[i]))
+					dropWorker(i);
+			}
+		}
+
+		for (auto& worker : workers)
+			WriteMessage(worker->socket, MessageType::Shutdown, {});
+		workers.clear();
+		for (Process& process : processes)
+			WaitProcess(process);
+
+		printf("Distributed %zu jobs of %ux%u over %zu workers:", jobs.size(), jobTileSize, jobTileSize, completedPerWorker.size());
+		for (uint32_t count : completedPerWorker)
+			printf(" %u", count);
+		printf(" (%u re-queued, %u duplicated, %u workers lost)\n", requeuedJobs, duplicatedJobs, lostWorkers);
+		return completedJobs == jobs.size();
+	}
+
+	int RunWorker(const std::string& address, uint32_t threadCount, bool pinThreads, uint32_t tileSize)
+	{
+		size_t colon = address.rfind(':');
+		if (colon == std::string::npos)
+		{
+			fprintf(stderr, "Expected host:port, got %s\n", address.c_str());
+			return 1;
+		}
+		std::string host = address.substr(0, colon);
+		uint16_t port = (uint16_t)atoi(address.c_str() + colon + 1);
+		if (!Socket::Initialize())
+			return 1;
+
+		// coordinator 可能还没开始监听
+		Socket socket;
+		for (int attempt = 0; !socket.Connect(host, port); attempt++)
+		{
+			if (attempt == 50)
+			{
+				fprintf(stderr, "Failed to connect to %s\n", address.c_str());
+				return 1;
+			}
+			std::this_thread::sleep_for(std::chrono::milliseconds(200));
+		}
+		HelloMessage hello = { ProtocolMagic, (uint32_t)sizeof(FrameSettings), (uint32_t)SphereSoA::GetSIMDLevel() };
+		if (!WriteMessage(socket, MessageType::Hello, { { &hello, sizeof(hello) } }))
+			return 1;
+
+		Renderer renderer;
+		renderer.GetScheduler().SetThreadCount(threadCount, pinThreads);
+		renderer.GetScheduler().SetTileSize(tileSize);
+		Camera camera(45.0f, 0.1f, 100.0f);
+		Scene scene;
+		FrameSettings frame;
+		std::filesystem::path scenePath;
+		bool ready = false;
+		uint32_t jobCount = 0;
+
+		std::vector<char> payload, result;
+		MessageType type;
+		while (ReadMessage(socket, type, payload))
+		{
+			if (type == MessageType::Shutdown)
+				break;
+
+			if (type == MessageType::Setup && payload.size() > sizeof(frame))
+			{
+				memcpy(&frame, payload.data(), sizeof(frame));
+				// 写成文件再映射，大数组不复制
+				scenePath = MakeTempScenePath();
+				{
+					std::ofstream file(scenePath, std::ios::binary);
+					file.write(payload.data() + sizeof(frame), payload.size() - sizeof(frame));
+				}
+				if (!SceneSerializer::LoadBinary(scenePath.string(), scene, &camera))
+				{
+					fprintf(stderr, "Failed to load the scene sent by the coordinator\n");
+					break;
+				}
+				renderer.ApplySettings(frame.settings);
+				renderer.m_NumRays = 1;
+				renderer.m_Adaptive = false;
+				renderer.m_Denoise = false;
+				camera.OnResize(frame.width, frame.height);
+				renderer.OnResize(frame.width, frame.height);
+				ready = true;
+				continue;
+			}
+
+			JobMessage job;
+			if (type != MessageType::Job || !ready || payload.size() != sizeof(job))
+			{
+				fprintf(stderr, "Unexpected message from the coordinator\n");
+				break;
+			}
+			memcpy(&job, payload.data(), sizeof(job));
+			const Tile& region = job.region;
+			if (region.x0 >= region.x1 || region.y0 >= region.y1 || region.x1 > frame.width || region.y1 > frame.height)
+			{
+				fprintf(stderr, "Job %u is outside the image\n", job.jobID);
+				break;
+			}
+
+			// 与单进程渲染相同：从第 1 帧开始，每帧 1 个样本
+			renderer.SetRegion(region);
+			renderer.ResetFrameCount();
+			for (uint32_t i = 0; i < frame.samplesPerPixel; i++)
+				renderer.Render(scene, camera);
+
+			uint32_t regionWidth = region.x1 - region.x0;
+			result.resize(GetResultSize(region));
+			char* out = result.data();
+			memcpy(out, &job, sizeof(job));
+			out += sizeof(job);
+			for (const glm::vec4* buffer : { renderer.GetAccumulationData(), renderer.GetAlbedoDepthData(), renderer.GetNormalData() })
+			{
+				for (uint32_t y = region.y0; y < region.y1; y++)
+				{
+					memcpy(out, buffer + (size_t)y * frame.width + region.x0, regionWidth * sizeof(glm::vec4));
+					out += regionWidth * sizeof(glm::vec4);
+				}
+			}
+			for (uint32_t y = region.y0; y < region.y1; y++)
+			{
+				for (uint32_t x = region.x0; x < region.x1; x++)
+				{
+					float variance = renderer.GetPixelVariance(x + y * frame.width);
+					memcpy(out, &variance, sizeof(variance));
+					out += sizeof(variance);
+				}
+			}
+			if (!WriteMessage(socket, MessageType::Result, { { result.data(), result.size() } }))
+				break;
+			jobCount++;
+		}
+
+		printf("Worker finished %u jobs\n", jobCount);
+		// 先释放映射再删除文件
+		scene = Scene();
+		if (!scenePath.empty())
+		{
+			std::error_code error;
+			std::filesystem::remove(scenePath, error);
+		}
+		return 0;
+	}
+
+}
@@ -0,0 +1,53 @@
+﻿#pragma once
+
+#include "Renderer.h"
+#include "Camera.h"
+#include "Scene.h"
+
+#include <glm/glm.hpp>
+#include <string>
+#include <vector>
+
+// 多进程分布式渲染：coordinator 把图像切成 tile 任务，连同场景 (.rtscene 格式) 和渲染参数经 TCP 发给 worker；
+// worker 对一个 tile 渲染全部样本后返回浮点累积结果，coordinator 拼成整幅图像。
+// 空闲的 worker 领取下一个任务 (每个 worker 同时持有 JobsInFlight 个，隐藏往返延迟)；
+// 断开的 worker 手上的任务重新排队，队列空后把仍在进行的任务再发给空闲的 worker，先返回的结果有效。
+// 每个 tile 都从第 1 帧开始按整幅图像的像素编号取随机数，结果与单进程渲染逐位相同；
+// 不同 SIMD 级别的求交结果不逐位相同，握手时拒绝与 coordinator SIMD 级别不同的 worker。
+// 消息按内存布局传输，两端必须是同一份可执行文件
+namespace Distributed {
+
+	struct FrameSettings
+	{
+		uint32_t width = 0, height = 0;
+		uint32_t samplesPerPixel = 1; // 每帧 1 个样本，累积这么多帧
+		RenderSettings settings;
+	};
+
+	struct CoordinatorOptions
+	{
+		uint16_t port = 0;            // 0 由系统分配
+		uint32_t spawnWorkers = 0;    // 在本机启动的 worker 进程数，也可以另外用 --worker 连接
+		std::string executable;       // 启动 worker 用的可执行文件
+		std::vector<std::string> workerArguments; // 附加给本机 worker 的参数 (--threads 等)
+		uint32_t jobTileSize = 64;    // 任务 tile 的边长
+		uint32_t workerWaitSeconds = 30; // 没有任何 worker 连接时最多等待这么久
+	};
+
+	// 与 Renderer 的缓冲含义相同，均为 width * height 个像素
+	struct FrameBuffers
+	{
+		std::vector<glm::vec4> accumulation;
+		std::vector<glm::vec4> albedoDepth;
+		std::vector<glm::vec4> normal;
+		std::vector<float> variance;
+	};
+
+	// scene 会先更新 BVH 再序列化，worker 加载后不必重建
+	bool RunCoordinator(const CoordinatorOptions& options, Scene& scene, const Camera& camera,
+		const FrameSettings& frame, FrameBuffers& result);
+
+	// 连接 host:port 并处理任务直到 coordinator 结束；threadCount、tileSize 是本进程的调度参数
+	int RunWorker(const std::string& address, uint32_t threadCount, bool pinThreads, uint32_t tileSize);
+
+}
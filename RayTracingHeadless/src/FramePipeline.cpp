@@ -0,0 +1,113 @@
+﻿#include "FramePipeline.h"
+#include "ImageWriter.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+namespace {
+
+	// 与 Renderer 的显示转换相同
+	uint32_t ToRGBA(const glm::vec4& color)
+	{
+		glm::vec4 clamped = glm::clamp(color, glm::vec4(0.0f), glm::vec4(1.0f));
+		return (uint32_t)(uint8_t)(clamped.r * 255.0f) | ((uint32_t)(uint8_t)(clamped.g * 255.0f) << 8) |
+			((uint32_t)(uint8_t)(clamped.b * 255.0f) << 16) | ((uint32_t)(uint8_t)(clamped.a * 255.0f) << 24);
+	}
+
+}
+
+FramePipeline::FramePipeline(uint32_t width, uint32_t height, uint32_t writerThreads, uint32_t bufferCount)
+	: m_Width(width), m_Height(height)
+{
+	writerThreads = std::max(writerThreads, 1u);
+	m_Images.resize(std::max(bufferCount, writerThreads + 1));
+	for (FrameImage& image : m_Images)
+	{
+		image.hdr.resize((size_t)width * height);
+		image.rgba.resize((size_t)width * height);
+		m_Free.push_back(&image);
+	}
+	for (uint32_t i = 0; i < writerThreads; i++)
+		m_Writers.emplace_back(&FramePipeline::WriterLoop, this);
+}
+
+FramePipeline::~FramePipeline()
+{
+	Finish();
+}
+
+FramePipeline::FrameImage* FramePipeline::Acquire()
+{
+	auto start = std::chrono::high_resolution_clock::now();
+	std::unique_lock<std::mutex> lock(m_Mutex);
+	m_FreeCondition.wait(lock, [this] { return !m_Free.empty(); });
+	FrameImage* image = m_Free.back();
+	m_Free.pop_back();
+	m_StallTime += std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	return image;
+}
+
+void FramePipeline::Submit(FrameImage* image)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Pending.push_back(image);
+	}
+	m_PendingCondition.notify_one();
+}
+
+bool FramePipeline::Finish()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Finishing = true;
+	}
+	m_PendingCondition.notify_all();
+	for (std::thread& writer : m_Writers)
+		writer.join();
+	m_Writers.clear();
+	return m_FailedFrames == 0;
+}
+
+void FramePipeline::WriterLoop()
+{
+	while (true)
+	{
+		FrameImage* image;
+		{
+			std::unique_lock<std::mutex> lock(m_Mutex);
+			m_PendingCondition.wait(lock, [this] { return !m_Pending.empty() || m_Finishing; });
+			// 结束前先把已提交的帧写完
+			if (m_Pending.empty())
+				return;
+			image = m_Pending.front();
+			m_Pending.pop_front();
+		}
+
+		Write(*image);
+
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_Free.push_back(image);
+		}
+		m_FreeCondition.notify_one();
+	}
+}
+
+void FramePipeline::Write(FrameImage& image)
+{
+	size_t pixelCount = (size_t)m_Width * m_Height;
+	for (size_t i = 0; i < pixelCount; i++)
+	{
+		if (image.accumulated)
+			image.hdr[i] /= image.hdr[i].w;
+		image.rgba[i] = ToRGBA(image.hdr[i]);
+	}
+	if (ImageWriter::Write(image.path, m_Width, m_Height, image.rgba.data(), image.hdr.data()))
+		return;
+
+	fprintf(stderr, "Failed to write frame %u to %s\n", image.frame, image.path.c_str());
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	m_FailedFrames++;
+}
@@ -0,0 +1,64 @@
+﻿#pragma once
+
+#include <glm/glm.hpp>
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// 序列渲染的输出流水线：渲染线程把一帧的 HDR 结果复制进缓冲后交出去，立即开始下一帧；
+// 写出线程负责归一化、转 8 位、编码和写文件。缓冲池大小固定，写出跟不上时 Acquire 阻塞渲染线程，
+// 内存占用有上限
+class FramePipeline
+{
+public:
+	struct FrameImage
+	{
+		uint32_t frame = 0;
+		std::string path;
+		std::vector<glm::vec4> hdr;
+		bool accumulated = false;   // hdr 是累积和 (w 为样本数)，写出前除以 w
+		std::vector<uint32_t> rgba;
+	};
+
+	// bufferCount 至少为 writerThreads + 1，渲染线程才不会一直等写出
+	FramePipeline(uint32_t width, uint32_t height, uint32_t writerThreads, uint32_t bufferCount);
+	~FramePipeline();
+
+	FramePipeline(const FramePipeline&) = delete;
+	FramePipeline& operator=(const FramePipeline&) = delete;
+
+	// 取一个空闲缓冲，全部在用时等待；返回的缓冲必须交给 Submit
+	FrameImage* Acquire();
+	void Submit(FrameImage* image);
+
+	// 等待已提交的帧全部写完并结束写出线程；有帧写失败时返回 false
+	bool Finish();
+
+	// 渲染线程在 Acquire 里等待的总时间，接近 0 说明写出完全被渲染掩盖
+	float GetStallTime() const { return m_StallTime; }
+	uint32_t GetFailedFrameCount() const { return m_FailedFrames; }
+
+private:
+	void WriterLoop();
+	void Write(FrameImage& image);
+
+private:
+	uint32_t m_Width, m_Height;
+	std::vector<FrameImage> m_Images;
+	std::vector<std::thread> m_Writers;
+
+	std::mutex m_Mutex;
+	std::condition_variable m_FreeCondition;
+	std::condition_variable m_PendingCondition;
+	std::vector<FrameImage*> m_Free;
+	std::deque<FrameImage*> m_Pending;
+	bool m_Finishing = false;
+
+	float m_StallTime = 0.0f;
+	uint32_t m_FailedFrames = 0;
+};
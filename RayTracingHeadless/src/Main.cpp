@@ -0,0 +1,664 @@
+﻿#include "Renderer.h"
+#include "Camera.h"
+#include "Scenes.h"
+#include "ImageWriter.h"
+#include "MeshLoader.h"
+#include "SceneSerializer.h"
+#include "Distributed.h"
+#include "Sequence.h"
+#include "FramePipeline.h"
+#include "Checkpoint.h"
+
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+	struct Options
+	{
+		uint32_t width = 1280;
+		uint32_t height = 720;
+		uint32_t samplesPerPixel = 16;
+		uint32_t maxBounceCount = 2;
+		bool russianRoulette = true;
+		uint32_t rouletteStart = 3;
+		bool justDiffuse = false;
+		bool jitter = true;
+		bool cachePrimaryHits = true;
+		float adaptiveThreshold = 0.0f;
+		bool showSampleCounts = false;
+		bool showPixelCost = false;
+		std::string tracePath;
+		bool denoise = false;
+		uint32_t denoiseIterations = 5;
+		uint32_t threadCount = 0;
+		bool pinThreads = false;
+		uint32_t tileSize = 16;
+		uint32_t seed = 0;
+		uint32_t pointLightCount = 0;
+		uint32_t instanceCount = 1;
+		uint32_t lightSamples = 1;
+		RenderMode mode = RenderMode::Recursive;
+		WavefrontSort wavefrontSort = WavefrontSort::None;
+		std::string outputPath = "output.png";
+		std::vector<std::string> meshPaths;
+		std::string scenePath;
+		std::string saveScenePath;
+
+		// 分布式渲染，见 Distributed.h
+		std::string workerAddress;
+		bool coordinator = false;
+		uint16_t coordinatorPort = 0;
+		uint32_t spawnWorkers = 0;
+		uint32_t jobTileSize = 64;
+
+		// 序列渲染，见 Sequence.h
+		std::string sequencePath;
+		uint32_t firstFrame = 0;
+		uint32_t lastFrame = UINT32_MAX;
+		uint32_t writerThreads = 2;
+
+		// 断点续渲，见 Checkpoint.h
+		std::string checkpointPath;
+		float checkpointInterval = 60.0f; // 秒
+		bool resume = false;
+	};
+
+	// SIGINT / SIGTERM (抢占) 时在当前帧结束后保存检查点再退出
+	volatile std::sig_atomic_t s_StopRequested = 0;
+
+	void OnStopSignal(int)
+	{
+		s_StopRequested = 1;
+	}
+
+	void PrintUsage(const char* exe)
+	{
+		printf("Usage: %s [options]\n"
+			"  --width <n>      image width (default 1280)\n"
+			"  --height <n>     image height (default 720)\n"
+			"  --spp <n>        samples per pixel (default 16)\n"
+			"  --bounces <n>    max bounce count (default 2)\n"
+			"  --roulette-start <n>  first bounce that may be ended by Russian roulette (default 3)\n"
+			"  --no-roulette    trace every path to the bounce limit\n"
+			"  --diffuse        shade every surface as Lambert diffuse\n"
+			"  --no-jitter      one fixed primary ray per pixel (no anti-aliasing)\n"
+			"  --no-primary-cache  intersect primary rays every frame instead of reusing cached hits\n"
+			"  --adaptive <e>   adaptive sampling, stop pixels whose standard error drops below e (e.g. 0.01)\n"
+			"  --show-sample-counts  write the per-pixel sample count heat map instead of the image\n"
+			"  --show-pixel-cost  write the last frame's per-pixel render time heat map (RT_PROFILE builds)\n"
+			"  --trace <path>   write a Chrome/Perfetto trace of every frame (RT_PROFILE builds)\n"
+			"  --denoise        run the edge-aware a-trous denoiser on the final image\n"
+			"  --denoise-iterations <n>  a-trous iterations, 0-6 (default 5)\n"
+			"  --threads <n>    render threads (default: all hardware threads)\n"
+			"  --pin            pin render threads to cores\n"
+			"  --tile-size <n>  tile edge in pixels (default 16)\n"
+			"  --seed <n>       sampling seed, same seed gives identical output (default 0)\n"
+			"  --scene <path>   load a .rtscene / .json scene instead of the default scene\n"
+			"  --save-scene <path>  save the final scene (.rtscene / .json) before rendering\n"
+			"  --mesh <path>    add a .obj / .ply mesh to the scene, may be repeated\n"
+			"  --instances <n>  instance each --mesh n times on a grid (default 1)\n"
+			"  --point-lights <n>  add n random point lights to the scene (default 0)\n"
+			"  --light-samples <n> point lights sampled per shading point, 1-4 (default 1)\n"
+			"  --mode <m>       recursive | wavefront (default recursive)\n"
+			"  --wavefront-sort <s>  none | material | direction (default none)\n"
+			"  --output <path>  .ppm / .png / .exr (default output.png); for --sequence, #### is replaced by the frame number\n"
+			"  --sequence <path>  render the keyframed animation in a .json sequence file\n"
+			"  --frames <a>[-<b>]  render only frames a to b of the sequence (default all)\n"
+			"  --writer-threads <n>  threads encoding and writing sequence frames (default 2)\n"
+			"  --checkpoint <path>  periodically save the render progress to path\n"
+			"  --checkpoint-interval <s>  seconds between checkpoints (default 60)\n"
+			"  --resume         continue from the --checkpoint file if it exists\n"
+			"  --coordinator <port>  render through worker processes, listening on port (0 picks a free port)\n"
+			"  --spawn-workers <n>   start n local worker processes for --coordinator (default 0)\n"
+			"  --job-tile <n>   edge of the tiles handed to workers (default 64)\n"
+			"  --worker <host:port>  run as a worker for the coordinator at host:port\n", exe);
+	}
+
+	bool ParseOptions(int argc, char** argv, Options& options)
+	{
+		for (int i = 1; i < argc; i++)
+		{
+			std::string arg = argv[i];
+			bool hasValue = i + 1 < argc;
+			if (arg == "--width" && hasValue)
+				options.width = (uint32_t)atoi(argv[++i]);
+			else if (arg == "--height" && hasValue)
+				options.height = (uint32_t)atoi(argv[++i]);
+			else if (arg == "--spp" && hasValue)
+				options.samplesPerPixel = (uint32_t)atoi(argv[++i]);
+			else if (arg == "--bounces" && hasValue)
+				options.maxBounceCount = (uint32_t)atoi(argv[++i]);
+			else if ((arg == "--output" || arg == "-o") && hasValue)
+				options.outputPath = argv[++i];
+			else if (arg == "--adaptive" && hasValue)
+				options.adaptiveThreshold = (float)atof(argv[++i]);
+			else if (arg == "--show-sample-counts")
+				options.showSampleCounts = true;
+			else if (arg == "--show-pixel-cost")
+				options.showPixelCost = true;
+			else if (arg == "--trace" && hasValue)
+				options.tracePath = argv[++i];
+			else if (arg == "--denoise")
+				options.denoise = true;
+			else if (arg == "--denoise-iterations" && hasValue)
+				options.denoiseIterations = (uint32_t)atoi(argv[++i]);
+			else if (arg == "--roulette-start" && hasValue)
+				options.rouletteStart = (uint32_t)atoi(argv[++i]);
+			else if (arg == "--no-roulette")
+				options.russianRoulette = false;
+			else if (arg == "--no-jitter")
+				options.jitter = false;
+			else if (arg == "--no-primary-cache")
+				options.cachePrimaryHits = false;
+			else if (arg == "--diffuse")
+				options.justDiffuse = true;
+			else if (arg == "--threads" && hasValue)
+				options.threadCount = (uint32_t)atoi(argv[++i]);
+			else if (arg == "--pin")
+				options.pinThreads = true;
+			else if (arg == "--tile-size" && hasValue)
+				options.tileSize = (uint32_t)atoi(argv[++i]);
+			else if (arg == "--seed" && hasValue)
+				options.seed = (uint32_t)strtoul(argv[++i], nullptr, 10);
+			else if (arg == "--scene" && hasValue)
+				options.scenePath = argv[++i];
+			else if (arg == "--save-scene" && hasValue)
+				options.saveScenePath = argv[++i];
+			else if (arg == "--mesh" && hasValue)
+				options.meshPaths.push_back(argv[++i]);
+			else if (arg == "--instances" && hasValue)
+				options.instanceCount = (uint32_t)atoi(argv[++i]);
+			else if (arg == "--point-lights" && hasValue)
+				options.pointLightCount = (uint32_t)atoi(argv[++i]);
+			else if (arg == "--light-samples" && hasValue)
+				options.lightSamples = (uint32_t)atoi(argv[++i]);
+			else if (arg == "--coordinator" && hasValue)
+			{
+				options.coordinator = true;
+				options.coordinatorPort = (uint16_t)atoi(argv[++i]);
+			}
+			else if (arg == "--spawn-workers" && hasValue)
+				options.spawnWorkers = (uint32_t)atoi(argv[++i]);
+			else if (arg == "--job-tile" && hasValue)
+				options.jobTileSize = (uint32_t)atoi(argv[++i]);
+			else if (arg == "--worker" && hasValue)
+				options.workerAddress = argv[++i];
+			else if (arg == "--sequence" && hasValue)
+				options.sequencePath = argv[++i];
+			else if (arg == "--frames" && hasValue)
+			{
+				std::string range = argv[++i];
+				size_t dash = range.find('-');
+				options.firstFrame = (uint32_t)strtoul(range.c_str(), nullptr, 10);
+				options.lastFrame = dash == std::string::npos ? options.firstFrame : (uint32_t)strtoul(range.c_str() + dash + 1, nullptr, 10);
+				if (options.lastFrame < options.firstFrame)
+					return false;
+			}
+			else if (arg == "--writer-threads" && hasValue)
+				options.writerThreads = (uint32_t)atoi(argv[++i]);
+			else if (arg == "--checkpoint" && hasValue)
+				options.checkpointPath = argv[++i];
+			else if (arg == "--checkpoint-interval" && hasValue)
+				options.checkpointInterval = (float)atof(argv[++i]);
+			else if (arg == "--resume")
+				options.resume = true;
+			else if (arg == "--mode" && hasValue)
+			{
+				std::string mode = argv[++i];
+				if (mode == "recursive")
+					options.mode = RenderMode::Recursive;
+				else if (mode == "wavefront")
+					options.mode = RenderMode::Wavefront;
+				else
+					return false;
+			}
+			else if (arg == "--wavefront-sort" && hasValue)
+			{
+				std::string sort = argv[++i];
+				if (sort == "none")
+					options.wavefrontSort = WavefrontSort::None;
+				else if (sort == "material")
+					options.wavefrontSort = WavefrontSort::Material;
+				else if (sort == "direction")
+					options.wavefrontSort = WavefrontSort::Direction;
+				else
+					return false;
+			}
+			else
+				return false;
+		}
+		return options.width > 0 && options.height > 0 && options.samplesPerPixel > 0;
+	}
+
+	// 每帧 1 spp，靠累积缓冲收敛
+	RenderSettings MakeRenderSettings(const Options& options)
+	{
+		RenderSettings settings;
+		settings.m_NumRays = 1;
+		settings.m_MaxBounceCount = options.maxBounceCount;
+		settings.m_RussianRoulette = options.russianRoulette;
+		settings.m_RouletteStartBounce = options.rouletteStart;
+		settings.m_JustDiffuse = options.justDiffuse;
+		settings.m_JitterPrimaryRays = options.jitter;
+		settings.m_CachePrimaryHits = options.cachePrimaryHits;
+		settings.m_Adaptive = options.adaptiveThreshold > 0.0f;
+		settings.m_AdaptiveThreshold = options.adaptiveThreshold;
+		settings.m_ShowSampleCounts = options.showSampleCounts;
+		settings.m_ShowPixelCost = options.showPixelCost;
+		settings.m_Seed = options.seed;
+		settings.m_LightSamples = options.lightSamples;
+		settings.m_Mode = options.mode;
+		settings.m_WavefrontSort = options.wavefrontSort;
+		return settings;
+	}
+
+	uint32_t ToRGBA(const glm::vec4& color)
+	{
+		glm::vec4 clamped = glm::clamp(color, glm::vec4(0.0f), glm::vec4(1.0f));
+		return (uint32_t)(uint8_t)(clamped.r * 255.0f) | ((uint32_t)(uint8_t)(clamped.g * 255.0f) << 8) |
+			((uint32_t)(uint8_t)(clamped.b * 255.0f) << 16) | ((uint32_t)(uint8_t)(clamped.a * 255.0f) << 24);
+	}
+
+	// 由 worker 进程渲染，本进程只拼接结果、降噪和写文件；结果与单进程渲染相同
+	int RenderDistributed(const Options& options, const char* executable, Scene& scene, const Camera& camera,
+		const RenderSettings& settings)
+	{
+		Distributed::CoordinatorOptions coordinator;
+		coordinator.port = options.coordinatorPort;
+		coordinator.spawnWorkers = options.spawnWorkers;
+		coordinator.executable = executable;
+		coordinator.jobTileSize = options.jobTileSize;
+		// 本机的 worker 默认平分硬件线程
+		uint32_t workerThreads = options.threadCount;
+		if (workerThreads == 0 && options.spawnWorkers > 0)
+			workerThreads = std::max(1u, std::thread::hardware_concurrency() / options.spawnWorkers);
+		coordinator.workerArguments = { "--threads", std::to_string(workerThreads), "--tile-size", std::to_string(options.tileSize) };
+		if (options.pinThreads)
+			coordinator.workerArguments.push_back("--pin");
+
+		Distributed::FrameSettings frame;
+		frame.width = options.width;
+		frame.height = options.height;
+		frame.samplesPerPixel = options.samplesPerPixel;
+		frame.settings = settings;
+
+		auto start = std::chrono::high_resolution_clock::now();
+		Distributed::FrameBuffers buffers;
+		if (!Distributed::RunCoordinator(coordinator, scene, camera, frame, buffers))
+			return 1;
+		float renderTime = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+		printf("Rendered %ux%u, %u spp, %u bounces, %s mode on worker processes in %.3fms (%.3fms/spp)\n",
+			options.width, options.height, options.samplesPerPixel, options.maxBounceCount,
+			options.mode == RenderMode::Wavefront ? "wavefront" : "recursive", renderTime, renderTime / options.samplesPerPixel);
+
+		uint32_t pixelCount = options.width * options.height;
+		std::vector<glm::vec4> hdr(pixelCount);
+		if (options.denoise)
+		{
+			TileScheduler scheduler(options.threadCount);
+			Denoiser denoiser;
+			denoiser.m_Iterations = options.denoiseIterations;
+			DenoiseInput input;
+			input.width = options.width;
+			input.height = options.height;
+			input.color = buffers.accumulation.data();
+			input.albedoDepth = buffers.albedoDepth.data();
+			input.normal = buffers.normal.data();
+			input.variance = buffers.variance.data();
+			denoiser.Denoise(input, hdr.data(), scheduler);
+			printf("Denoised in %.3fms\n", denoiser.GetDenoiseTime());
+		}
+		else
+		{
+			for (uint32_t i = 0; i < pixelCount; i++)
+				hdr[i] = buffers.accumulation[i] / buffers.accumulation[i].w;
+		}
+
+		std::vector<uint32_t> rgba(pixelCount);
+		for (uint32_t i = 0; i < pixelCount; i++)
+			rgba[i] = ToRGBA(hdr[i]);
+		if (!ImageWriter::Write(options.outputPath, options.width, options.height, rgba.data(), hdr.data()))
+		{
+			fprintf(stderr, "Failed to write %s\n", options.outputPath.c_str());
+			return 1;
+		}
+		printf("Wrote %s\n", options.outputPath.c_str());
+		return 0;
+	}
+
+	// 把路径中连续的 # 换成补零的帧号 (shot_####.png)；没有 # 时在扩展名前加 _0000
+	std::string FormatFramePath(const std::string& pattern, uint32_t frame)
+	{
+		size_t first = pattern.find('#');
+		if (first == std::string::npos)
+		{
+			size_t dot = pattern.find_last_of('.');
+			size_t slash = pattern.find_last_of("/\\");
+			if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+				dot = pattern.size();
+			return FormatFramePath(pattern.substr(0, dot) + "_####" + pattern.substr(dot), frame);
+		}
+		size_t last = pattern.find_first_not_of('#', first);
+		size_t digits = (last == std::string::npos ? pattern.size() : last) - first;
+		char number[16];
+		snprintf(number, sizeof(number), "%0*u", (int)digits, frame);
+		return pattern.substr(0, first) + number + (last == std::string::npos ? "" : pattern.substr(last));
+	}
+
+	// 帧 N 在写出线程上转换、编码、写文件时，本线程已经在渲染帧 N+1。
+	// 场景、BVH 和渲染器缓冲在帧之间复用，关键帧只触发 Refit；相机不动时主光线交点缓存也跨帧有效
+	int RenderSequence(const Options& options, Renderer& renderer, Scene& scene, Camera& camera)
+	{
+		Sequence sequence;
+		if (!sequence.Load(options.sequencePath) || !sequence.Bind(scene, camera))
+		{
+			fprintf(stderr, "Failed to load %s: %s\n", options.sequencePath.c_str(), sequence.GetError().c_str());
+			return 1;
+		}
+		uint32_t lastFrame = std::min(options.lastFrame, sequence.GetFrameCount() - 1);
+		if (options.firstFrame > lastFrame)
+		{
+			fprintf(stderr, "--frames is outside the sequence (%u frames)\n", sequence.GetFrameCount());
+			return 1;
+		}
+
+		// 多两个缓冲，渲染线程交出一帧时不必等写出线程空闲
+		FramePipeline pipeline(options.width, options.height, options.writerThreads, options.writerThreads + 2);
+		uint32_t pixelCount = options.width * options.height;
+		auto start = std::chrono::high_resolution_clock::now();
+		for (uint32_t frame = options.firstFrame; frame <= lastFrame; frame++)
+		{
+			auto frameStart = std::chrono::high_resolution_clock::now();
+			sequence.Apply(frame, scene, camera);
+			renderer.ResetFrameCount();
+			for (uint32_t i = 0; i < options.samplesPerPixel; i++)
+			{
+				renderer.m_Denoise = options.denoise && i + 1 == options.samplesPerPixel;
+				renderer.Render(scene, camera);
+			}
+
+			FramePipeline::FrameImage* image = pipeline.Acquire();
+			image->frame = frame;
+			std::string path = FormatFramePath(options.outputPath, frame);
+			image->path = path;
+			image->accumulated = renderer.GetDenoisedData() == nullptr;
+			const glm::vec4* source = image->accumulated ? renderer.GetAccumulationData() : renderer.GetDenoisedData();
+			std::copy(source, source + pixelCount, image->hdr.begin());
+			pipeline.Submit(image);
+
+			float frameTime = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - frameStart).count();
+			printf("Frame %u rendered in %.3fms -> %s\n", frame, frameTime, path.c_str());
+		}
+		bool written = pipeline.Finish();
+		float totalTime = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+		uint32_t frameCount = lastFrame - options.firstFrame + 1;
+		printf("Rendered %u frames %ux%u, %u spp on %u threads + %u writer threads in %.3fms (%.3fms/frame), render waited %.3fms for writers\n",
+			frameCount, options.width, options.height, options.samplesPerPixel, renderer.GetScheduler().GetThreadCount(),
+			std::max(options.writerThreads, 1u), totalTime, totalTime / frameCount, pipeline.GetStallTime());
+		if (!written)
+		{
+			fprintf(stderr, "%u frames failed to write\n", pipeline.GetFailedFrameCount());
+			return 1;
+		}
+		return 0;
+	}
+
+}
+
+int main(int argc, char** argv)
+{
+	Options options;
+	if (!ParseOptions(argc, argv, options))
+	{
+		PrintUsage(argv[0]);
+		return 1;
+	}
+	// 场景和参数都来自 coordinator
+	if (!options.workerAddress.empty())
+		return Distributed::RunWorker(options.workerAddress, options.threadCount, options.pinThreads, options.tileSize);
+	if (options.coordinator && (options.adaptiveThreshold > 0.0f || options.showSampleCounts || options.showPixelCost ||
+		!options.tracePath.empty()))
+	{
+		fprintf(stderr, "--coordinator does not support --adaptive, --show-sample-counts, --show-pixel-cost or --trace\n");
+		return 1;
+	}
+	if (!options.sequencePath.empty() && (options.coordinator || options.showSampleCounts || options.showPixelCost ||
+		!options.tracePath.empty()))
+	{
+		fprintf(stderr, "--sequence does not support --coordinator, --show-sample-counts, --show-pixel-cost or --trace\n");
+		return 1;
+	}
+	if ((!options.checkpointPath.empty() || options.resume) && (options.coordinator || !options.sequencePath.empty()))
+	{
+		fprintf(stderr, "--checkpoint and --resume only apply to single-process still images\n");
+		return 1;
+	}
+	if (options.resume && options.checkpointPath.empty())
+	{
+		fprintf(stderr, "--resume needs --checkpoint <path>\n");
+		return 1;
+	}
+
+	Camera camera(45.0f, 0.1f, 100.0f);
+	Scene scene;
+	if (options.scenePath.empty())
+		scene = Scenes::CreateDefaultScene();
+	else
+	{
+		auto loadStart = std::chrono::high_resolution_clock::now();
+		if (!SceneSerializer::Load(options.scenePath, scene, &camera))
+		{
+			fprintf(stderr, "Failed to load %s\n", options.scenePath.c_str());
+			return 1;
+		}
+		float loadTime = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - loadStart).count();
+		printf("Loaded %s: %zu spheres, %u triangles in %.3fms\n", options.scenePath.c_str(),
+			scene.spheres.size(), scene.GetTriangleCount(), loadTime);
+	}
+	Scenes::AddRandomPointLights(scene, options.pointLightCount, options.seed);
+	for (const std::string& meshPath : options.meshPaths)
+	{
+		auto loadStart = std::chrono::high_resolution_clock::now();
+		MeshData mesh;
+		if (!MeshLoader::Load(meshPath, mesh))
+		{
+			fprintf(stderr, "Failed to load %s\n", meshPath.c_str());
+			return 1;
+		}
+		float loadTime = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - loadStart).count();
+		printf("Loaded %s: %zu vertices, %zu triangles in %.3fms\n", meshPath.c_str(),
+			mesh.positions.size(), mesh.indices.size() / 3, loadTime);
+		uint32_t meshID = scene.AddMesh(mesh.positions, mesh.indices);
+		if (options.instanceCount == 1)
+		{
+			MeshInstance instance;
+			instance.meshID = meshID;
+			scene.AddInstance(instance);
+		}
+		else
+			Scenes::AddInstanceGrid(scene, meshID, 0, options.instanceCount, options.seed);
+	}
+	if (!options.saveScenePath.empty())
+	{
+		if (!SceneSerializer::Save(options.saveScenePath, scene, &camera))
+		{
+			fprintf(stderr, "Failed to write %s\n", options.saveScenePath.c_str());
+			return 1;
+		}
+		printf("Wrote %s\n", options.saveScenePath.c_str());
+	}
+	RenderSettings settings = MakeRenderSettings(options);
+	if (options.coordinator)
+		return RenderDistributed(options, argv[0], scene, camera, settings);
+
+	Renderer renderer;
+	camera.OnResize(options.width, options.height);
+	renderer.OnResize(options.width, options.height);
+	renderer.ApplySettings(settings);
+	if ((options.showPixelCost || !options.tracePath.empty()) && !Profiler::Enabled)
+		fprintf(stderr, "warning: --show-pixel-cost and --trace need a build with RT_PROFILE=1\n");
+	renderer.GetDenoiser().m_Iterations = options.denoiseIterations;
+	renderer.GetScheduler().SetThreadCount(options.threadCount, options.pinThreads);
+	renderer.GetScheduler().SetTileSize(options.tileSize);
+	if (!options.sequencePath.empty())
+		return RenderSequence(options, renderer, scene, camera);
+
+	uint32_t firstFrame = 0;
+	std::unique_ptr<Checkpoint::Writer> checkpoint;
+	if (!options.checkpointPath.empty())
+	{
+		uint64_t fingerprint = Checkpoint::Fingerprint(settings, scene, camera, options.width, options.height);
+		if (options.resume && !std::filesystem::exists(options.checkpointPath))
+			printf("No checkpoint at %s, starting from the first frame\n", options.checkpointPath.c_str());
+		else if (options.resume)
+		{
+			Renderer::AccumulationState state;
+			std::string error;
+			if (!Checkpoint::Read(options.checkpointPath, fingerprint, state, error) || !renderer.LoadAccumulation(state))
+			{
+				fprintf(stderr, "Cannot resume from %s: %s\n", options.checkpointPath.c_str(),
+					error.empty() ? "the image size differs" : error.c_str());
+				return 1;
+			}
+			// 可以用更大的 --spp 继续一次已经完成的累积
+			firstFrame = renderer.GetFrameCount() - 1;
+			if (firstFrame >= options.samplesPerPixel)
+			{
+				fprintf(stderr, "%s already holds %u spp\n", options.checkpointPath.c_str(), firstFrame);
+				return 1;
+			}
+			printf("Resumed from %s after %u of %u spp\n", options.checkpointPath.c_str(), firstFrame, options.samplesPerPixel);
+		}
+		checkpoint = std::make_unique<Checkpoint::Writer>(options.checkpointPath, fingerprint);
+		std::signal(SIGINT, OnStopSignal);
+		std::signal(SIGTERM, OnStopSignal);
+	}
+	if (!options.tracePath.empty())
+		renderer.GetProfiler().StartCapture(options.samplesPerPixel - firstFrame);
+
+	// 只在最后一帧降噪
+	auto start = std::chrono::high_resolution_clock::now();
+	auto lastCheckpoint = start;
+	for (uint32_t i = firstFrame; i < options.samplesPerPixel; i++)
+	{
+		renderer.m_Denoise = options.denoise && i + 1 == options.samplesPerPixel;
+		renderer.Render(scene, camera);
+		if (!checkpoint || i + 1 == options.samplesPerPixel)
+			continue;
+
+		// 复制状态是检查点唯一的同步开销，两次检查点之间至少渲染它的 100 倍时间，开销不超过 1%
+		bool stop = s_StopRequested != 0;
+		auto now = std::chrono::high_resolution_clock::now();
+		float sinceCheckpoint = std::chrono::duration<float>(now - lastCheckpoint).count();
+		if (stop || (sinceCheckpoint >= options.checkpointInterval && sinceCheckpoint * 1000.0f >= checkpoint->GetLastCaptureTime() * 100.0f))
+		{
+			if (stop)
+				checkpoint->Wait();
+			if (checkpoint->Submit(renderer))
+				lastCheckpoint = now;
+		}
+		if (stop)
+		{
+			checkpoint->Wait();
+			if (checkpoint->GetFailedCount() > 0)
+				return 1;
+			printf("Stopped after %u of %u spp, progress saved to %s (continue with --resume)\n", i + 1,
+				options.samplesPerPixel, options.checkpointPath.c_str());
+			return 2;
+		}
+	}
+	float renderTime = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	uint32_t renderedFrames = options.samplesPerPixel - firstFrame;
+
+	printf("Rendered %ux%u, %u spp, %u bounces, %s mode on %u threads (%s) in %.3fms (%.3fms/spp)\n",
+		options.width, options.height, options.samplesPerPixel, options.maxBounceCount,
+		options.mode == RenderMode::Wavefront ? "wavefront" : "recursive", renderer.GetScheduler().GetThreadCount(), SphereSoA::GetSIMDLevelName(), renderTime, renderTime / renderedFrames);
+	if (checkpoint)
+		printf("Wrote %u checkpoints, copying state took %.3fms (%.3f%% of render time)\n", checkpoint->GetWrittenCount(),
+			checkpoint->GetTotalCaptureTime(), checkpoint->GetTotalCaptureTime() / renderTime * 100.0f);
+
+	if (!scene.instances.empty())
+	{
+		uint32_t blasNodeCount = 0;
+		float blasBuildTime = 0.0f;
+		for (const BVH& blas : scene.meshBVHs)
+		{
+			blasNodeCount += blas.GetNodeCount();
+			blasBuildTime += blas.GetBuildTime();
+		}
+		printf("Mesh BLAS: %u nodes for %u triangles in %zu meshes, build %.3fms\n", blasNodeCount,
+			scene.GetTriangleCount(), scene.meshes.size(), blasBuildTime);
+		printf("Instance TLAS: %u nodes for %zu instances, build %.3fms\n", scene.instanceBVH.GetNodeCount(),
+			scene.instances.size(), scene.instanceBVH.GetBuildTime());
+	}
+
+	if (renderer.GetDenoisedData())
+		printf("Denoised in %.3fms\n", renderer.GetDenoiser().GetDenoiseTime());
+
+	if (Profiler::Enabled)
+	{
+		// 最后一帧的分阶段耗时 (所有线程之和) 和计数
+		const ProfileFrameStats& stats = renderer.GetProfiler().GetFrameStats();
+		printf("Last frame %.3fms:", stats.frameMs);
+		for (uint32_t s = 0; s < (uint32_t)ProfileStage::Count; s++)
+			printf(" %s %.3fms%s", Profiler::GetStageName((ProfileStage)s), stats.stageMs[s], s + 1 < (uint32_t)ProfileStage::Count ? "," : "\n");
+		const RayCounts& rays = renderer.GetRayCounts();
+		printf("  %llu primary, %llu secondary, %llu shadow rays", (unsigned long long)rays.primary,
+			(unsigned long long)rays.secondary, (unsigned long long)rays.shadow);
+		for (uint32_t c = 0; c < (uint32_t)ProfileCounter::Count; c++)
+			printf(", %llu %s", (unsigned long long)stats.counters[c], Profiler::GetCounterName((ProfileCounter)c));
+		printf("\n");
+	}
+	if (!options.tracePath.empty() && Profiler::Enabled)
+	{
+		if (!renderer.GetProfiler().WriteTrace(options.tracePath))
+		{
+			fprintf(stderr, "Failed to write %s\n", options.tracePath.c_str());
+			return 1;
+		}
+		printf("Wrote %s\n", options.tracePath.c_str());
+	}
+
+	uint32_t pixelCount = options.width * options.height;
+	printf("Traced %llu primary samples (%.2f per pixel)", (unsigned long long)renderer.GetTotalSampleCount(),
+		(double)renderer.GetTotalSampleCount() / pixelCount);
+	if (renderer.m_Adaptive)
+		printf(", %u of %u pixels converged", renderer.GetConvergedPixelCount(), pixelCount);
+	printf("\n");
+
+	// 调试视图只有 8 位图像，HDR 输出也用它
+	std::vector<glm::vec4> hdr(pixelCount);
+	for (size_t i = 0; i < hdr.size(); i++)
+	{
+		const glm::vec4& accumulated = renderer.GetAccumulationData()[i];
+		uint32_t rgba = renderer.GetImageData()[i];
+		if (options.showSampleCounts || (options.showPixelCost && Profiler::Enabled))
+			hdr[i] = glm::vec4((float)(rgba & 0xff), (float)((rgba >> 8) & 0xff), (float)((rgba >> 16) & 0xff), 255.0f) / 255.0f;
+		else if (renderer.GetDenoisedData())
+			hdr[i] = renderer.GetDenoisedData()[i];
+		else
+			hdr[i] = accumulated / accumulated.w;
+	}
+
+	if (!ImageWriter::Write(options.outputPath, options.width, options.height, renderer.GetImageData(), hdr.data()))
+	{
+		fprintf(stderr, "Failed to write %s\n", options.outputPath.c_str());
+		return 1;
+	}
+	printf("Wrote %s\n", options.outputPath.c_str());
+	// 图像已经写出，检查点不再需要
+	if (checkpoint)
+		checkpoint->Remove();
+	return 0;
+}
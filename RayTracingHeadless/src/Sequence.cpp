@@ -0,0 +1,256 @@
+﻿#include "Sequence.h"
+#include "MappedFile.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+	// 返回 frame 两侧的关键帧和插值系数；frame 在首尾关键帧之外时取端点
+	void FindKeys(const JsonValue& keys, float frame, const JsonValue*& a, const JsonValue*& b, float& t)
+	{
+		const std::vector<JsonValue>& array = keys.array;
+		size_t next = 0;
+		while (next < array.size() && array[next].GetFloat("frame", 0.0f) <= frame)
+			next++;
+		a = &array[next == 0 ? 0 : next - 1];
+		b = &array[std::min(next, array.size() - 1)];
+		float frameA = a->GetFloat("frame", 0.0f), frameB = b->GetFloat("frame", 0.0f);
+		t = frameB > frameA ? (frame - frameA) / (frameB - frameA) : 0.0f;
+	}
+
+	struct KeySample
+	{
+		const JsonValue* a;
+		const JsonValue* b;
+		float t;
+
+		KeySample(const JsonValue& keys, uint32_t frame) { FindKeys(keys, (float)frame, a, b, t); }
+
+		float Float(const char* name, float base) const
+		{
+			return glm::mix(a->GetFloat(name, base), b->GetFloat(name, base), t);
+		}
+
+		glm::vec3 Vec3(const char* name, const glm::vec3& base) const
+		{
+			return glm::mix(a->GetVec3(name, base), b->GetVec3(name, base), t);
+		}
+
+		// 方向插值后重新归一化，两端相反时退回较近的关键帧
+		glm::vec3 Direction(const char* name, const glm::vec3& base) const
+		{
+			glm::vec3 direction = Vec3(name, base);
+			if (glm::dot(direction, direction) < 1e-12f)
+				return glm::normalize(t < 0.5f ? a->GetVec3(name, base) : b->GetVec3(name, base));
+			return glm::normalize(direction);
+		}
+	};
+
+	template<typename T>
+	bool Assign(T& target, const T& value)
+	{
+		if (target == value)
+			return false;
+		target = value;
+		return true;
+	}
+
+}
+
+bool Sequence::Load(const std::string& path)
+{
+	MappedFile file;
+	if (!file.Open(path))
+	{
+		m_Error = "cannot open " + path;
+		return false;
+	}
+	JsonParser parser(file.GetData(), file.GetData() + file.GetSize());
+	if (!parser.Parse(m_Root) || m_Root.type != JsonValue::Type::Object)
+	{
+		m_Error = path + " is not a JSON object";
+		return false;
+	}
+
+	m_CameraKeys = m_Root.Find("camera");
+	m_DirectionalLightKeys = m_Root.Find("directionalLight");
+	if ((m_CameraKeys && !CheckKeys(*m_CameraKeys, "camera")) ||
+		(m_DirectionalLightKeys && !CheckKeys(*m_DirectionalLightKeys, "directionalLight")) ||
+		!ReadTracks("spheres", m_Spheres) || !ReadTracks("instances", m_Instances) ||
+		!ReadTracks("pointLights", m_PointLights) || !ReadTracks("materials", m_Materials))
+		return false;
+
+	// 没有写 frameCount 时到最后一个关键帧为止
+	float lastKey = 0.0f;
+	auto growLastKey = [&](const JsonValue* keys)
+		{
+			if (keys)
+				lastKey = std::max(lastKey, keys->array.back().GetFloat("frame", 0.0f));
+		};
+	growLastKey(m_CameraKeys);
+	growLastKey(m_DirectionalLightKeys);
+	for (const std::vector<Track>* tracks : { &m_Spheres, &m_Instances, &m_PointLights, &m_Materials })
+		for (const Track& track : *tracks)
+			growLastKey(track.keys);
+	m_FrameCount = (uint32_t)m_Root.GetFloat("frameCount", std::floor(lastKey) + 1.0f);
+	if (m_FrameCount == 0)
+	{
+		m_Error = "frameCount must be positive";
+		return false;
+	}
+	return true;
+}
+
+bool Sequence::CheckKeys(const JsonValue& keys, const char* name)
+{
+	if (keys.type != JsonValue::Type::Array || keys.array.empty())
+	{
+		m_Error = std::string(name) + ": keys must be a non-empty array";
+		return false;
+	}
+	float previous = -1.0f;
+	for (const JsonValue& key : keys.array)
+	{
+		const JsonValue* frame = key.Find("frame");
+		if (key.type != JsonValue::Type::Object || !frame || frame->type != JsonValue::Type::Number ||
+			(float)frame->number <= previous)
+		{
+			m_Error = std::string(name) + ": every key needs a \"frame\", in increasing order";
+			return false;
+		}
+		previous = (float)frame->number;
+	}
+	return true;
+}
+
+bool Sequence::ReadTracks(const char* name, std::vector<Track>& tracks)
+{
+	const JsonValue* array = m_Root.Find(name);
+	if (!array)
+		return true;
+	for (const JsonValue& value : array->array)
+	{
+		Track track;
+		const JsonValue* index = value.Find("index");
+		track.keys = value.Find("keys");
+		if (!index || index->type != JsonValue::Type::Number || index->number < 0.0 || !track.keys)
+		{
+			m_Error = std::string(name) + ": every track needs an \"index\" and \"keys\"";
+			return false;
+		}
+		if (!CheckKeys(*track.keys, name))
+			return false;
+		track.index = (uint32_t)index->number;
+		tracks.push_back(track);
+	}
+	return true;
+}
+
+bool Sequence::Bind(const Scene& scene, const Camera& camera)
+{
+	auto checkIndices = [&](const std::vector<Track>& tracks, size_t count, const char* name)
+		{
+			for (const Track& track : tracks)
+			{
+				if (track.index >= count)
+				{
+					m_Error = std::string(name) + " track refers to index " + std::to_string(track.index) +
+						", the scene has " + std::to_string(count);
+					return false;
+				}
+			}
+			return true;
+		};
+	if (!checkIndices(m_Spheres, scene.spheres.size(), "spheres") ||
+		!checkIndices(m_Instances, scene.instances.size(), "instances") ||
+		!checkIndices(m_PointLights, scene.pointLights.size(), "pointLights") ||
+		!checkIndices(m_Materials, scene.materials.size(), "materials"))
+		return false;
+
+	m_BaseCameraPosition = camera.GetPosition();
+	m_BaseCameraDirection = camera.GetDirection();
+	m_BaseCameraFOV = camera.GetVerticalFOV();
+	m_BaseDirectionalLight = scene.directionalLight;
+	m_BaseSpheres = scene.spheres;
+	m_BaseInstances = scene.instances;
+	m_BasePointLights = scene.pointLights;
+	m_BaseMaterials = scene.materials;
+	return true;
+}
+
+void Sequence::Apply(uint32_t frame, Scene& scene, Camera& camera) const
+{
+	// 只在值真的变化时标记修改，没有动的几何保留缓存的主光线交点
+	if (m_CameraKeys)
+	{
+		KeySample sample(*m_CameraKeys, frame);
+		glm::vec3 position = sample.Vec3("position", m_BaseCameraPosition);
+		glm::vec3 direction = sample.Direction("direction", m_BaseCameraDirection);
+		float verticalFOV = sample.Float("verticalFOV", m_BaseCameraFOV);
+		if (position != camera.GetPosition())
+			camera.SetPosition(position);
+		if (direction != camera.GetDirection())
+			camera.SetDirection(direction);
+		if (verticalFOV != camera.GetVerticalFOV())
+			camera.SetVerticalFOV(verticalFOV);
+	}
+
+	if (m_DirectionalLightKeys)
+	{
+		KeySample sample(*m_DirectionalLightKeys, frame);
+		DirectionalLight& light = scene.directionalLight;
+		light.direction = sample.Direction("direction", m_BaseDirectionalLight.direction);
+		light.color = sample.Vec3("color", m_BaseDirectionalLight.color);
+		light.intensity = sample.Float("intensity", m_BaseDirectionalLight.intensity);
+	}
+
+	for (const Track& track : m_Spheres)
+	{
+		KeySample sample(*track.keys, frame);
+		const Sphere& base = m_BaseSpheres[track.index];
+		Sphere& sphere = scene.spheres[track.index];
+		bool changed = Assign(sphere.position, sample.Vec3("position", base.position));
+		changed |= Assign(sphere.radius, sample.Float("radius", base.radius));
+		if (changed)
+			scene.MarkSphereChanged(track.index);
+	}
+
+	for (const Track& track : m_Instances)
+	{
+		KeySample sample(*track.keys, frame);
+		const MeshInstance& base = m_BaseInstances[track.index];
+		MeshInstance& instance = scene.instances[track.index];
+		bool changed = Assign(instance.position, sample.Vec3("position", base.position));
+		changed |= Assign(instance.rotation, sample.Vec3("rotation", base.rotation));
+		changed |= Assign(instance.scale, sample.Vec3("scale", base.scale));
+		if (changed)
+			scene.MarkInstanceChanged(track.index);
+	}
+
+	for (const Track& track : m_PointLights)
+	{
+		KeySample sample(*track.keys, frame);
+		const PointLight& base = m_BasePointLights[track.index];
+		PointLight& light = scene.pointLights[track.index];
+		bool changed = Assign(light.position, sample.Vec3("position", base.position));
+		changed |= Assign(light.color, sample.Vec3("color", base.color));
+		changed |= Assign(light.intensity, sample.Float("intensity", base.intensity));
+		changed |= Assign(light.range, sample.Float("range", base.range));
+		if (changed)
+			scene.MarkPointLightsChanged();
+	}
+
+	// 材质在着色时读取，改了不需要标记
+	for (const Track& track : m_Materials)
+	{
+		KeySample sample(*track.keys, frame);
+		const Material& base = m_BaseMaterials[track.index];
+		Material& material = scene.materials[track.index];
+		material.albedo = sample.Vec3("albedo", base.albedo);
+		material.metallic = sample.Float("metallic", base.metallic);
+		material.roughness = sample.Float("roughness", base.roughness);
+		material.emissionColor = sample.Vec3("emissionColor", base.emissionColor);
+		material.emissionPower = sample.Float("emissionPower", base.emissionPower);
+	}
+}
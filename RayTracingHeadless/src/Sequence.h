@@ -0,0 +1,64 @@
+﻿#pragma once
+
+#include "Scene.h"
+#include "Camera.h"
+#include "Json.h"
+
+#include <string>
+#include <vector>
+
+// 关键帧动画 (JSON)：相机路径和球体、实例、点光源、材质、方向光的逐帧参数，关键帧之间线性插值。
+//
+// {
+//   "frameCount": 120,
+//   "camera": [ { "frame": 0, "position": [0, 1, 6], "direction": [0, 0, -1], "verticalFOV": 45 }, ... ],
+//   "spheres": [ { "index": 0, "keys": [ { "frame": 0, "position": [0, 0, 0], "radius": 1 }, ... ] } ],
+//   "instances": [ { "index": 0, "keys": [ { "frame": 0, "position": [...], "rotation": [...], "scale": [...] } ] } ],
+//   "pointLights": [ { "index": 0, "keys": [ { "frame": 0, "position": [...], "color": [...], "intensity": 1 } ] } ],
+//   "materials": [ { "index": 0, "keys": [ { "frame": 0, "albedo": [...], "roughness": 0.5, "emissionPower": 0 } ] } ],
+//   "directionalLight": [ { "frame": 0, "direction": [...], "color": [...], "intensity": 1.5 } ]
+// }
+//
+// 关键帧按 frame 升序；缺少的字段取场景原来的值。每帧的参数只由帧号决定，与之前渲染过哪些帧无关，
+// 所以任意一段帧都能单独渲染。几何只改位置、半径和变换，BVH 逐帧 Refit 而不重建
+class Sequence
+{
+public:
+	bool Load(const std::string& path);
+
+	// 记下场景和相机的初始值，并检查轨道引用的编号；之后 Apply 只修改有轨道的对象
+	bool Bind(const Scene& scene, const Camera& camera);
+
+	void Apply(uint32_t frame, Scene& scene, Camera& camera) const;
+
+	uint32_t GetFrameCount() const { return m_FrameCount; }
+	const std::string& GetError() const { return m_Error; }
+
+private:
+	struct Track
+	{
+		uint32_t index = 0;
+		const JsonValue* keys = nullptr;
+	};
+
+	bool ReadTracks(const char* name, std::vector<Track>& tracks);
+	bool CheckKeys(const JsonValue& keys, const char* name);
+
+private:
+	JsonValue m_Root;
+	uint32_t m_FrameCount = 0;
+	std::string m_Error;
+
+	const JsonValue* m_CameraKeys = nullptr;
+	const JsonValue* m_DirectionalLightKeys = nullptr;
+	std::vector<Track> m_Spheres, m_Instances, m_PointLights, m_Materials;
+
+	// Bind 时的初始值，关键帧缺少的字段用它们
+	glm::vec3 m_BaseCameraPosition{ 0.0f }, m_BaseCameraDirection{ 0.0f, 0.0f, -1.0f };
+	float m_BaseCameraFOV = 45.0f;
+	DirectionalLight m_BaseDirectionalLight;
+	std::vector<Sphere> m_BaseSpheres;
+	std::vector<MeshInstance> m_BaseInstances;
+	std::vector<PointLight> m_BasePointLights;
+	std::vector<Material> m_BaseMaterials;
+};
@@ -0,0 +1,228 @@
+﻿#include "Socket.h"
+
+#if defined(_WIN32)
+	#define NOMINMAX
+	#include <winsock2.h>
+	#include <ws2tcpip.h>
+	using SocketHandle = SOCKET;
+	using SocketLength = int;
+	#define poll WSAPoll
+#else
+	#include <arpa/inet.h>
+	#include <netdb.h>
+	#include <netinet/in.h>
+	#include <netinet/tcp.h>
+	#include <poll.h>
+	#include <sys/socket.h>
+	#include <unistd.h>
+	using SocketHandle = int;
+	using SocketLength = socklen_t;
+#endif
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+	// 对方已经断开时 send 不触发 SIGPIPE
+#if defined(MSG_NOSIGNAL)
+	constexpr int SendFlags = MSG_NOSIGNAL;
+#else
+	constexpr int SendFlags = 0;
+#endif
+
+	SocketHandle ToHandle(intptr_t handle) { return (SocketHandle)handle; }
+
+	void CloseSocketHandle(intptr_t handle)
+	{
+#if defined(_WIN32)
+		closesocket(ToHandle(handle));
+#else
+		close(ToHandle(handle));
+#endif
+	}
+
+	// 结果消息较大，关闭 Nagle 避免小的任务消息被攒着不发
+	void SetNoDelay(intptr_t handle)
+	{
+		int enable = 1;
+		setsockopt(ToHandle(handle), IPPROTO_TCP, TCP_NODELAY, (const char*)&enable, sizeof(enable));
+	}
+
+}
+
+Socket::~Socket()
+{
+	Close();
+}
+
+Socket::Socket(Socket&& other) noexcept
+	: m_Handle(other.m_Handle)
+{
+	other.m_Handle = -1;
+}
+
+Socket& Socket::operator=(Socket&& other) noexcept
+{
+	if (this != &other)
+	{
+		Close();
+		m_Handle = other.m_Handle;
+		other.m_Handle = -1;
+	}
+	return *this;
+}
+
+bool Socket::Initialize()
+{
+#if defined(_WIN32)
+	WSADATA data;
+	return WSAStartup(MAKEWORD(2, 2), &data) == 0;
+#else
+	return true;
+#endif
+}
+
+bool Socket::Listen(uint16_t port)
+{
+	Close();
+	SocketHandle handle = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	if (handle == (SocketHandle)-1)
+		return false;
+	m_Handle = (intptr_t)handle;
+
+	int reuse = 1;
+	setsockopt(handle, SOL_SOCKET, SO_REUSEADDR, (const char*)&reuse, sizeof(reuse));
+	sockaddr_in address = {};
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_ANY);
+	address.sin_port = htons(port);
+	if (bind(handle, (const sockaddr*)&address, sizeof(address)) != 0 || listen(handle, 64) != 0)
+	{
+		Close();
+		return false;
+	}
+	return true;
+}
+
+bool Socket::Accept(Socket& client)
+{
+	SocketHandle handle = accept(ToHandle(m_Handle), nullptr, nullptr);
+	if (handle == (SocketHandle)-1)
+		return false;
+	client.Close();
+	client.m_Handle = (intptr_t)handle;
+	SetNoDelay(client.m_Handle);
+	return true;
+}
+
+bool Socket::Connect(const std::string& host, uint16_t port)
+{
+	Close();
+	addrinfo hints = {};
+	hints.ai_family = AF_INET;
+	hints.ai_socktype = SOCK_STREAM;
+	addrinfo* result = nullptr;
+	if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &result) != 0)
+		return false;
+
+	for (addrinfo* info = result; info; info = info->ai_next)
+	{
+		SocketHandle handle = socket(info->ai_family, info->ai_socktype, info->ai_protocol);
+		if (handle == (SocketHandle)-1)
+			continue;
+		if (connect(handle, info->ai_addr, (SocketLength)info->ai_addrlen) == 0)
+		{
+			m_Handle = (intptr_t)handle;
+			break;
+		}
+		CloseSocketHandle((intptr_t)handle);
+	}
+	freeaddrinfo(result);
+	if (!IsOpen())
+		return false;
+	SetNoDelay(m_Handle);
+	return true;
+}
+
+void Socket::Close()
+{
+	if (!IsOpen())
+		return;
+	CloseSocketHandle(m_Handle);
+	m_Handle = -1;
+}
+
+bool Socket::IsOpen() const
+{
+	return m_Handle != -1;
+}
+
+uint16_t Socket::GetLocalPort() const
+{
+	sockaddr_in address = {};
+	SocketLength length = sizeof(address);
+	if (getsockname(ToHandle(m_Handle), (sockaddr*)&address, &length) != 0)
+		return 0;
+	return ntohs(address.sin_port);
+}
+
+void Socket::SetReceiveTimeout(uint32_t milliseconds)
+{
+#if defined(_WIN32)
+	DWORD timeout = milliseconds;
+#else
+	timeval timeout = {};
+	timeout.tv_sec = milliseconds / 1000;
+	timeout.tv_usec = (milliseconds % 1000) * 1000;
+#endif
+	setsockopt(ToHandle(m_Handle), SOL_SOCKET, SO_RCVTIMEO, (const char*)&timeout, sizeof(timeout));
+}
+
+bool Socket::SendAll(const void* data, size_t size)
+{
+	const char* bytes = (const char*)data;
+	while (size > 0)
+	{
+		// Winsock 的长度参数是 int
+		int chunk = (int)std::min<size_t>(size, 1 << 30);
+		int sent = (int)send(ToHandle(m_Handle), bytes, chunk, SendFlags);
+		if (sent <= 0)
+			return false;
+		bytes += sent;
+		size -= (size_t)sent;
+	}
+	return true;
+}
+
+bool Socket::ReceiveAll(void* data, size_t size)
+{
+	char* bytes = (char*)data;
+	while (size > 0)
+	{
+		int chunk = (int)std::min<size_t>(size, 1 << 30);
+		int received = (int)recv(ToHandle(m_Handle), bytes, chunk, 0);
+		if (received <= 0)
+			return false;
+		bytes += received;
+		size -= (size_t)received;
+	}
+	return true;
+}
+
+bool Socket::WaitReadable(const std::vector<Socket*>& sockets, int timeoutMilliseconds, std::vector<bool>& readable)
+{
+	std::vector<pollfd> fds(sockets.size());
+	for (size_t i = 0; i < sockets.size(); i++)
+	{
+		fds[i].fd = ToHandle(sockets[i]->m_Handle);
+		fds[i].events = POLLIN;
+	}
+	readable.assign(sockets.size(), false);
+	int count = poll(fds.data(), (unsigned long)fds.size(), timeoutMilliseconds);
+	if (count <= 0)
+		return false;
+	for (size_t i = 0; i < sockets.size(); i++)
+		readable[i] = (fds[i].revents & (POLLIN | POLLHUP | POLLERR)) != 0;
+	return true;
+}
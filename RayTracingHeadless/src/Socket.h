@@ -0,0 +1,43 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// 阻塞式 TCP 套接字的薄封装 (Winsock / BSD sockets)，只提供分布式渲染用到的操作
+class Socket
+{
+public:
+	Socket() = default;
+	~Socket();
+
+	Socket(Socket&& other) noexcept;
+	Socket& operator=(Socket&& other) noexcept;
+	Socket(const Socket&) = delete;
+	Socket& operator=(const Socket&) = delete;
+
+	// 进程内调用一次 (Windows 上初始化 Winsock)
+	static bool Initialize();
+
+	// port 为 0 时由系统分配，用 GetLocalPort 取得
+	bool Listen(uint16_t port);
+	bool Accept(Socket& client);
+	bool Connect(const std::string& host, uint16_t port);
+	void Close();
+
+	bool IsOpen() const;
+	uint16_t GetLocalPort() const;
+	// 之后的 ReceiveAll 最多等待这么久，0 为不限
+	void SetReceiveTimeout(uint32_t milliseconds);
+
+	// 发送或接收完整的 size 字节，对方关闭连接或出错时返回 false
+	bool SendAll(const void* data, size_t size);
+	bool ReceiveAll(void* data, size_t size);
+
+	// 等待任意一个套接字可读 (或已关闭)，readable 与 sockets 一一对应；超时返回 false
+	static bool WaitReadable(const std::vector<Socket*>& sockets, int timeoutMilliseconds, std::vector<bool>& readable);
+
+private:
+	intptr_t m_Handle = -1;
+};
@@ -5,6 +5,16 @@ workspace "RayTracing"
    startproject "RayTracing"
 
 outputdir = "%{cfg.buildcfg}-%{cfg.system}-%{cfg.architecture}"
+
+-- premake5 --profile vs2022：编译渲染器的计数器和计时 (RT_PROFILE)，默认关闭，关闭时没有任何开销
+newoption
+{
+   trigger = "profile",
+   description = "Build the renderer with profiling counters, timers and trace export (RT_PROFILE)"
+}
+
 include "Walnut/WalnutExternal.lua"
 
-include "RayTracing"
\ No newline at end of file
+include "RayTracing"
+include "RayTracingHeadless"
+include "RayTracingBenchmark"
\ No newline at end of file